@@ -0,0 +1,180 @@
+/**
+ * @file RPM_AddressIndex.h
+ * @author Hello007
+ * @brief Reverse lookup of code addresses to modules and functions.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ */
+#ifndef __RPM_ADDRESSINDEX_H
+#define __RPM_ADDRESSINDEX_H
+
+#include "RPM_Types.h"
+#include "RPM_Control.h"
+#include "RPM_Module.h"
+#include "RPM_ModuleListener.h"
+
+namespace rpm {
+	namespace mgr {
+		class ModuleManager;
+
+		/**
+		 * @brief Location of a code address, as resolved by AddressIndex::Lookup.
+		 */
+		struct AddressInfo {
+			rpm::Module*	Module;
+			/**
+			 * @brief Offset of the address from the start of the module's code segment.
+			 */
+			u32				CodeOffset;
+			/**
+			 * @brief Start of the function containing the address, or null if the address is not within an indexed function.
+			 */
+			u8*				Function;
+			/**
+			 * @brief Offset of the address from the start of the function.
+			 */
+			u32				FunctionOffset;
+			/**
+			 * @brief Name hash of the function, or 0 if the module had no string table when it was indexed.
+			 */
+			RPM_NAMEHASH	NameHash;
+			/**
+			 * @brief Symbol of the function, or null if it has been stripped from the module.
+			 */
+			rpm::Symbol*	Symbol;
+			/**
+			 * @brief Name of the function, or null if the module's strings have been stripped.
+			 */
+			const char*		Name;
+		};
+
+		/**
+		 * @brief Address-sorted index of the code segments of all loaded modules and their functions.
+		 *
+		 * Lookups are two binary searches, one over the modules and one over the functions of the module that was hit.
+		 * The index follows loading, unloading and fixing as a module listener, rebuilding only the tables of the affected module.
+		 *
+		 * Each indexed function takes 12 bytes, allocated as work memory of its module.
+		 * If stripped tables are retained, functions stay resolvable by address and name hash after the symbol table
+		 * has been fixed away (FixLevel::ALL_NONCODE). Otherwise, such modules are only resolved to code offsets.
+		 *
+		 * Lookups run in a read scope of the manager and may be called from any thread. The index is only modified by the
+		 * module events, which hold off readers while the ranges change.
+		 *
+		 * The index binds itself as a module listener, so it must not be destroyed while the ModuleManager is in use.
+		 */
+		class AddressIndex : public ModuleListener {
+		private:
+			/**
+			 * @brief A function of a module, relative to its code segment.
+			 */
+			struct FunctionEntry {
+				u32				Offset;
+				/**
+				 * @brief Size of the function, or 0 if it extends up to the next function.
+				 */
+				u16				Size;
+				/**
+				 * @brief Index of the function's symbol, or 0xFFFF once it has been stripped.
+				 */
+				u16				SymbolIdx;
+				RPM_NAMEHASH	Hash;
+			};
+
+			/**
+			 * @brief Functions of a module sorted by offset.
+			 */
+			struct FunctionTable {
+				u32				Count;
+				FunctionEntry	Entries[];
+			};
+
+			/**
+			 * @brief Code segment of an indexed module.
+			 */
+			struct ModuleRange {
+				u8*				Start;
+				u8*				End;
+				rpm::Module*	Module;
+				FunctionTable*	Functions;
+			};
+
+			ModuleManager*	m_Manager;
+			bool			m_RetainStripped;
+
+			/**
+			 * @brief Ranges of all indexed modules sorted by start address.
+			 */
+			ModuleRange*	m_Ranges;
+			u32				m_RangeCount;
+			u32				m_RangeCapacity;
+
+		public:
+			/**
+			 * @brief Creates an address index and indexes all modules that are already loaded.
+			 *
+			 * @param mgr The manager whose modules to index.
+			 * @param retainStripped Whether to keep the function tables of modules whose symbol tables are stripped.
+			 */
+			RPM_PUBLIC AddressIndex(ModuleManager* mgr, bool retainStripped);
+
+			/**
+			 * @brief Resolves a code address to its module and function.
+			 *
+			 * @param address The address to resolve, such as a program counter value.
+			 * @param info Output location of the address.
+			 * @return True if the address is within the code segment of a loaded module.
+			 */
+			RPM_PUBLIC bool Lookup(const void* address, AddressInfo* info);
+
+			/**
+			 * @brief Gets the number of indexed modules.
+			 */
+			INLINE u32 GetModuleCount() {
+				return m_RangeCount;
+			}
+
+			void OnEvent(rpm::mgr::ModuleManager* mgr, rpm::Module* module, ModuleEvent event) override;
+
+		private:
+			void AddModule(rpm::Module* module);
+
+			void RemoveModule(rpm::Module* module);
+
+			/**
+			 * @brief Maps the function table of a module that has just been fixed to its remaining symbols.
+			 */
+			void UpdateModule(rpm::Module* module);
+
+			/**
+			 * @brief Collects the function symbols of a module into a table sorted by offset.
+			 *
+			 * @return The table, or null if the module has no function symbols or memory ran out.
+			 */
+			FunctionTable* BuildFunctionTable(rpm::Module* module);
+
+			/**
+			 * @brief Sets the symbol indices of a function table from the current symbol table of its module.
+			 */
+			void MapFunctionSymbols(rpm::Module* module, FunctionTable* table);
+
+			/**
+			 * @brief Finds the last function starting at or before a code offset.
+			 */
+			FunctionEntry* FindFunction(FunctionTable* table, u32 offset);
+
+			/**
+			 * @brief Finds the index of the first range starting after an address.
+			 */
+			u32 FindRangeIndex(const u8* address);
+
+			ModuleRange* FindModuleRange(rpm::Module* module);
+
+			static bool IsFunctionSymbol(rpm::Symbol* sym);
+		};
+	}
+}
+
+#endif
@@ -23,7 +23,19 @@
 #include "RPM_ModuleFixLevel.h"
 #include "RPM_Module.h"
 #include "RPM_ModuleManager.h"
+#include "RPM_ModuleLoader.h"
 #include "RPM_ExternalRelocator.h"
 #include "RPM_ModuleListener.h"
+#include "RPM_ImportCache.h"
+#include "RPM_Snapshot.h"
+#include "RPM_ModuleInstance.h"
+#include "RPM_MemoryStats.h"
+#include "RPM_Trace.h"
+#include "RPM_Overlay.h"
+#include "RPM_MemoryPressureHandler.h"
+#include "RPM_PipelineLoader.h"
+#include "RPM_ProcTable.h"
+#include "RPM_ModuleSource.h"
+#include "RPM_AddressIndex.h"
 
 #endif
\ No newline at end of file
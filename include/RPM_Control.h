@@ -49,7 +49,14 @@ namespace rpm {
 		 * @brief This symbol needs to be resolved from a dependency module.
 		 */
 		RPM_SYMATTR_IMPORT = 1 << 1,
-		RPM_SYMATTR_GLOBAL = 1 << 2
+		RPM_SYMATTR_GLOBAL = 1 << 2,
+		/**
+		 * @brief This import symbol carries the index of its export in the exporter's export hash table (Symbol::ExportOrdinal).
+		 * 
+		 * The ordinal is checked against the hash at that index, and the import is bound directly if they match.
+		 * A stale ordinal falls back to searching by hash.
+		 */
+		RPM_SYMATTR_ORDINAL = 1 << 3
 	};
 
 	DEFINE_ENUM_FLAG_OPERATORS(SymbolAttr)
@@ -144,6 +151,57 @@ namespace rpm {
 	 */
 	typedef u32 RPM_NAMEHASH;
 
+	/**
+	 * @brief Pointer stored as a signed offset from its own location. An offset of 0 is a null pointer.
+	 *
+	 * Control sections link to each other only through these, so that they stay valid wherever the
+	 * header section is loaded, moved or copied to without being patched. Copying a RelPtr rebases it
+	 * to keep the target, which requires the target to be within 2 GiB of the copy.
+	 */
+	template<typename T>
+	struct RelPtr {
+		s32 Offset;
+
+		RelPtr() = default;
+
+		INLINE RelPtr(const RelPtr& other) {
+			Set(other.Get());
+		}
+
+		INLINE T* Get() const {
+			if (!Offset) {
+				return nullptr;
+			}
+			return reinterpret_cast<T*>(reinterpret_cast<intptr_t>(this) + Offset);
+		}
+
+		INLINE void Set(const T* ptr) {
+			if (!ptr) {
+				Offset = 0;
+				return;
+			}
+			Offset = static_cast<s32>(reinterpret_cast<intptr_t>(ptr) - reinterpret_cast<intptr_t>(this));
+		}
+
+		INLINE operator T*() const {
+			return Get();
+		}
+
+		INLINE T* operator->() const {
+			return Get();
+		}
+
+		INLINE RelPtr& operator=(T* ptr) {
+			Set(ptr);
+			return *this;
+		}
+
+		INLINE RelPtr& operator=(const RelPtr& other) {
+			Set(other.Get());
+			return *this;
+		}
+	};
+
 	/**
 	 * @brief Reference to an RPM symbol's location.
 	 */
@@ -165,11 +223,21 @@ namespace rpm {
 	 */
 	struct Symbol {
 		RPM_NAMEOFS	Name;
+		/**
+		 * @brief Size of the symbol. For unresolved import symbols, this is used by the loader to link the pending imports.
+		 */
 		u16			Size;
 		Address     Addr;
 		SymbolType  Type;
 		SymbolAttr  Attr;
-		u16			Reserved;
+		union {
+			u16		Reserved;
+			/**
+			 * @brief Export ordinal of an import symbol with RPM_SYMATTR_ORDINAL.
+			 * Once an import symbol is bound, this holds the index of its export in any case.
+			 */
+			u16		ExportOrdinal;
+		};
 	};
 
 	/**
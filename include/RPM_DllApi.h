@@ -25,6 +25,9 @@ namespace rpm {
 
 	namespace mgr {
 		class ModuleManager;
+		class ModuleLoader;
+		class PipelineLoader;
+		class ImportObserver;
 	}
 }
 
@@ -0,0 +1,170 @@
+/**
+ * @file RPM_ImportCache.h
+ * @author Hello007
+ * @brief Persistent cache of import resolutions between modules.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ */
+#ifndef __RPM_IMPORTCACHE_H
+#define __RPM_IMPORTCACHE_H
+
+#include "RPM_Types.h"
+#include "RPM_Module.h"
+#include "RPM_ImportObserver.h"
+#include "RPM_ModuleListener.h"
+
+/**
+ * @brief Maximum number of loaded modules whose identities an ImportCache tracks at once.
+ */
+#define RPM_IMPORTCACHE_MAX_MODULES 32
+
+namespace rpm {
+	namespace mgr {
+		/**
+		 * @brief Records which export each import has been resolved to, so that the same module set can be linked without hash searches.
+		 *
+		 * Modules are identified by a hash of their unrelocated code and symbol tables, taken when they are loaded.
+		 * Images that are registered already relocated, such as snapshot and overlay cache restores, are not hashed. They are given the identity
+		 * of the prototype that they were made from through SetModuleId instead.
+		 * The cache lives in a caller-provided buffer that can be written to persistent storage as-is and passed back on the next boot.
+		 * Entries whose modules are missing or whose export hashes no longer match are skipped, and the symbols are linked normally.
+		 *
+		 * Bind with ModuleManager::BindImportCache before loading the modules that should be cached.
+		 */
+		class ImportCache : public ImportObserver, public ModuleListener {
+		public:
+			/**
+			 * @brief A single import resolution.
+			 */
+			struct Entry {
+				u32 ImporterId;
+				u32 ExporterId;
+				u16 SymbolIdx;
+				u16 ExportIdx;
+			};
+
+			/**
+			 * @brief Header of the serialized cache.
+			 */
+			struct Header {
+				#define IMPORTCACHE_MAGIC MAGIC('R', 'I', 'C', '0')
+
+				u32 	Magic;
+				u32 	Version;
+				u32		EntryCount;
+				Entry	Entries[];
+			};
+
+		private:
+			struct ModuleId {
+				rpm::Module*	Module;
+				u32				Id;
+			};
+
+			Header*		m_Data;
+			u32			m_Capacity;
+			bool		m_Dirty;
+			bool		m_Full;
+
+			ModuleId	m_Modules[RPM_IMPORTCACHE_MAX_MODULES];
+			u32			m_UntrackedCount;
+
+		public:
+			/**
+			 * @brief Creates an import cache in a caller-provided buffer.
+			 *
+			 * @param storage Buffer holding a previously serialized cache, or arbitrary data to start with an empty cache.
+			 * @param storageSize Size of the buffer in bytes.
+			 */
+			RPM_PUBLIC ImportCache(void* storage, size_t storageSize);
+
+			/**
+			 * @brief Gets the serialized cache.
+			 */
+			INLINE const void* GetData() {
+				return m_Data;
+			}
+
+			/**
+			 * @brief Gets the size of the serialized cache in bytes.
+			 */
+			INLINE size_t GetDataSize() {
+				return sizeof(Header) + m_Data->EntryCount * sizeof(Entry);
+			}
+
+			/**
+			 * @brief Checks if entries have been added or changed since the cache was created.
+			 */
+			INLINE bool IsDirty() {
+				return m_Dirty;
+			}
+
+			/**
+			 * @brief Checks if import resolutions have been dropped because the buffer is full.
+			 */
+			INLINE bool IsFull() {
+				return m_Full;
+			}
+
+			/**
+			 * @brief Gets the number of modules that have been loaded while all RPM_IMPORTCACHE_MAX_MODULES identity slots were taken.
+			 * Imports from and to such modules are linked normally and not cached.
+			 */
+			INLINE u32 GetUntrackedModuleCount() {
+				return m_UntrackedCount;
+			}
+
+			/**
+			 * @brief Removes all entries.
+			 */
+			RPM_PUBLIC void Clear();
+
+			/**
+			 * @brief Gets the identity of a loaded module.
+			 *
+			 * @return The module's identity hash, or 0 if the module has not been loaded while the cache was bound.
+			 */
+			RPM_PUBLIC u32 GetModuleId(rpm::Module* module);
+
+			/**
+			 * @brief Sets the identity of a loaded module, replacing the one it has been given on load.
+			 *
+			 * @param module The module.
+			 * @param id The identity of the module's prototype, as calculated by CalcModuleId or returned by GetModuleId.
+			 */
+			RPM_PUBLIC void SetModuleId(rpm::Module* module, u32 id);
+
+			/**
+			 * @brief Resolves all cached imports of a module from the currently loaded modules.
+			 *
+			 * Deferred modules that symbols are imported from are activated, unless the importer is deferred itself.
+			 *
+			 * @param mgr The manager that the modules are loaded in.
+			 * @param importer The module to link. Linking must have been allowed.
+			 * @return Number of symbols imported.
+			 */
+			u32 BindCachedImports(rpm::mgr::ModuleManager* mgr, rpm::Module* importer);
+
+			void OnImport(rpm::Module* importer, u16 symIndex, rpm::Module* exporter, u16 exportIndex) override;
+
+			void OnEvent(rpm::mgr::ModuleManager* mgr, rpm::Module* module, ModuleEvent event) override;
+
+			/**
+			 * @brief Calculates the identity of a module whose code has not been relocated yet.
+			 */
+			static u32 CalcModuleId(rpm::Module* module);
+
+		private:
+			rpm::Module* FindModuleById(u32 id);
+
+			/**
+			 * @brief Finds the first entry not ordered before the given key.
+			 */
+			u32 LowerBound(u32 importerId, u16 symIndex);
+		};
+	}
+}
+
+#endif
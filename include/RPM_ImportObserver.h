@@ -0,0 +1,36 @@
+/**
+ * @file RPM_ImportObserver.h
+ * @author Hello007
+ * @brief Interface for observing resolved imports.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ */
+#ifndef __RPM_IMPORTOBSERVER_H
+#define __RPM_IMPORTOBSERVER_H
+
+#include "RPM_Types.h"
+#include "RPM_DllApi.h"
+
+namespace rpm {
+	namespace mgr {
+		/**
+		 * @brief Interface for observing import symbols being resolved during linking.
+		 */
+		class ImportObserver {
+			public:
+				/**
+				 * @brief Virtual function called after an import symbol has been resolved from another module.
+				 *
+				 * @param importer The module that imported the symbol.
+				 * @param symIndex Index of the import symbol in the importer's symbol table.
+				 * @param exporter The module that exports the symbol.
+				 * @param exportIndex Index of the symbol in the exporter's export hash table.
+				 */
+				virtual void OnImport(rpm::Module* importer, u16 symIndex, rpm::Module* exporter, u16 exportIndex) {};
+		};
+	}
+}
+
+#endif
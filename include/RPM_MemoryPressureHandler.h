@@ -0,0 +1,36 @@
+/**
+ * @file RPM_MemoryPressureHandler.h
+ * @author Hello007
+ * @brief Interface for releasing memory when the module heap runs out.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ */
+#ifndef __RPM_MEMORYPRESSUREHANDLER_H
+#define __RPM_MEMORYPRESSUREHANDLER_H
+
+#include "RPM_Types.h"
+
+namespace rpm {
+	namespace mgr {
+		class ModuleManager;
+
+		/**
+		 * @brief Interface for freeing discardable memory when an allocation from the module heap fails.
+		 */
+		class MemoryPressureHandler {
+			public:
+				/**
+				 * @brief Virtual function called when an allocation from the module heap has failed. The allocation is retried if any memory was released.
+				 *
+				 * @param mgr The manager whose heap ran out.
+				 * @param size Size of the failed allocation.
+				 * @return Number of bytes released to the module heap.
+				 */
+				virtual size_t OnMemoryPressure(rpm::mgr::ModuleManager* mgr, size_t size) { return 0; };
+		};
+	}
+}
+
+#endif
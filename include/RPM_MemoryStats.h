@@ -0,0 +1,89 @@
+/**
+ * @file RPM_MemoryStats.h
+ * @author Hello007
+ * @brief Memory usage reports of modules and module managers.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ */
+#ifndef __RPM_MEMORYSTATS_H
+#define __RPM_MEMORYSTATS_H
+
+#include "RPM_Types.h"
+
+namespace rpm {
+	namespace mgr {
+		/**
+		 * @brief Breakdown of the memory used by a loaded module, in bytes.
+		 */
+		struct ModuleMemoryStats {
+			/**
+			 * @brief The code segment, including initialized data.
+			 */
+			size_t Code;
+			size_t BSS;
+			/**
+			 * @brief The symbol table and its list of extern module names.
+			 */
+			size_t Symbols;
+			size_t ExportHashTable;
+			/**
+			 * @brief The relocation section, its relocation lists and its list of extern module names.
+			 */
+			size_t Relocations;
+			size_t Strings;
+			size_t MetaData;
+			/**
+			 * @brief The module, execution and info headers, the static initializer/destructor lists and alignment padding.
+			 */
+			size_t Headers;
+			/**
+			 * @brief Work memory allocated on behalf of the module.
+			 */
+			size_t WorkMemory;
+			/**
+			 * @brief Capacity of the module's work memory arena.
+			 */
+			size_t WorkArena;
+			/**
+			 * @brief Part of the work memory arena that is allocated, including blocks that have been freed but not reclaimed yet.
+			 */
+			size_t WorkArenaUsed;
+			/**
+			 * @brief Sum of all the above but WorkArenaUsed. Equal to the size of the module allocation(s) plus the work memory and arena.
+			 */
+			size_t Total;
+		};
+
+		/**
+		 * @brief Memory usage of a ModuleManager, in bytes.
+		 */
+		struct ManagerMemoryStats {
+			u32					ModuleCount;
+			/**
+			 * @brief Sum of the statistics of all loaded modules.
+			 */
+			ModuleMemoryStats	Modules;
+			/**
+			 * @brief Work memory that is not owned by any loaded module.
+			 */
+			size_t				UnownedWorkMemory;
+			/**
+			 * @brief Memory of all module instances.
+			 */
+			size_t				InstanceMemory;
+			/**
+			 * @brief Total memory currently held on the module heap.
+			 */
+			size_t				InUse;
+			/**
+			 * @brief Highest value of InUse since the manager was created or the peak was reset.
+			 * Modules are counted at their full size before being fixed, so this includes the overhead of loading.
+			 */
+			size_t				PeakInUse;
+		};
+	}
+}
+
+#endif
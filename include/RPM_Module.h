@@ -23,6 +23,8 @@ namespace rpm {
 #include "RPM_MetaData.h"
 #include "RPM_CpuUtil.h"
 #include "RPM_DllApi.h"
+#include "RPM_Sync.h"
+#include "RPM_ProcTable.h"
 
 namespace rpm {
 	/**
@@ -36,13 +38,26 @@ namespace rpm {
 
 			u32 			Magic;
 
-			ModuleNameList* ExternModules;
+			RelPtr<ModuleNameList>	ExternModules;
 
 			u16				FirstExportSymbolIdx;
 			u16				ExportSymbolCount;
 			u16				FirstImportSymbolIdx;
 			u16				ImportSymbolCount;
-			RPM_NAMEHASH*	ExportSymbolHashTable;
+			RelPtr<RPM_NAMEHASH>	ExportSymbolHashTable;
+			/**
+			 * @brief Name hashes of the import symbols, parallel to them. Unlike Symbol::Addr, the hashes are kept while the imports are bound.
+			 */
+			RelPtr<RPM_NAMEHASH>	ImportSymbolHashTable;
+			/**
+			 * @brief Addresses of the import symbols, parallel to them, or 0 for imports that are not bound. Zero-filled in the file.
+			 */
+			RelPtr<u32>				ImportAddressTable;
+			/**
+			 * @brief Start addresses of the modules that the import symbols are bound to, parallel to them, or 0 for imports that are not bound.
+			 * Identifies the exporter of imports bound to absolute addresses, which do not point into it. Zero-filled in the file.
+			 */
+			RelPtr<u32>				ImportModuleTable;
 
 			u32 			SymbolCount;
 			Symbol  		Symbols[];
@@ -55,10 +70,10 @@ namespace rpm {
 
 			u32 			BaseAddress;
 
-			RelocationList* InternalRelocations;
-			RelocationList* InternalImportRelocations;
-			RelocationList* ExternalRelocations;
-			ModuleNameList* ExternModules;
+			RelPtr<RelocationList> InternalRelocations;
+			RelPtr<RelocationList> InternalImportRelocations;
+			RelPtr<RelocationList> ExternalRelocations;
+			RelPtr<ModuleNameList> ExternModules;
 		};
 
 		struct StringSection {
@@ -78,28 +93,33 @@ namespace rpm {
 		struct InfoSection {
 			#define INFO_MAGIC MAGIC('I', 'N', 'F', 'O')
 
-			u32					Magic;
-			SymbolSection*		Symbols;
-			RelocationSection*	Relocations;
-			StringSection*		Strings;
-			u8*					Code;
-			u32					CodeSize;
-			FuncArrayList*		StaticInitializers;
-			FuncArrayList*		StaticDestructors;
-			MetaDataSection*	MetaValueSection;
+			u32							Magic;
+			RelPtr<SymbolSection>		Symbols;
+			RelPtr<RelocationSection>	Relocations;
+			RelPtr<StringSection>		Strings;
+			/**
+			 * @brief Offset of the code segment from the start of the module.
+			 */
+			u32							CodeOffset;
+			u32							CodeSize;
+			RelPtr<FuncArrayList>		StaticInitializers;
+			RelPtr<FuncArrayList>		StaticDestructors;
+			RelPtr<MetaDataSection>		MetaValueSection;
 		};
 
 		struct DllExec {
 			#define DLLEXEC_MAGIC MAGIC('D', 'L', 'X', 'H')
 
-			u32 		 Magic;
-			u32 		 Version;
-			InfoSection* Info;
+			u32 		 		Magic;
+			u32 		 		Version;
+			RelPtr<InfoSection>	Info;
 			u32			 BSSSize;
 			u32			 HeaderSectionSize;
 		};
 
 		friend class rpm::mgr::ModuleManager;
+		friend class rpm::mgr::ModuleLoader;
+		friend class rpm::mgr::PipelineLoader;
 
 		/**
 		 * @brief Creates a module from an intermediate allocation.
@@ -108,6 +128,37 @@ namespace rpm {
 		 */
 		RPM_PUBLIC static Module* InitModule(rpm::init::ModuleAllocation alloc);
 
+		/**
+		 * @brief Creates a module from an intermediate allocation of known layout.
+		 * 
+		 * @param alloc The allocated and loaded module data. Must be at least layout->AllocSize bytes large.
+		 * @param layout The module's layout as returned by QueryModuleLayout, or null if unknown.
+		 * @param flags RPM_LOADFLAG_ZEROED and/or RPM_LOADFLAG_PRE_EXPANDED to skip parts of the expansion.
+		 */
+		RPM_PUBLIC static Module* InitModule(rpm::init::ModuleAllocation alloc, const rpm::init::ModuleLayout* layout, rpm::init::LoadFlags flags);
+
+		/**
+		 * @brief Determines the in-memory layout of a module from the start of its file.
+		 * 
+		 * Only the RPM0 header at the very start of the file is required. If headerSize also covers the DLXH,
+		 * its BSS size is checked against the file size.
+		 * 
+		 * @param headerBytes The first bytes of the module file.
+		 * @param headerSize Number of bytes available at headerBytes.
+		 * @param fileSize Total size of the module file.
+		 * @param layout Output layout.
+		 * @return True if the header is valid and 'layout' has been filled in.
+		 */
+		RPM_PUBLIC static bool QueryModuleLayout(const void* headerBytes, size_t headerSize, size_t fileSize, rpm::init::ModuleLayout* layout);
+
+		/**
+		 * @brief Calculates the size of the persistent image of a module loaded with RPM_LOADFLAG_SPLIT_CONTROL.
+		 * 
+		 * @param alloc The loaded, not yet initialized module data.
+		 * @return Size of the code, data, BSS and execution header in bytes.
+		 */
+		RPM_PUBLIC static size_t CalcSplitImageSize(rpm::init::ModuleAllocation alloc);
+
 		/**
 		 * @brief Checks this module's version and magic constants against current libRPM implementation.
 		 * 
@@ -116,6 +167,13 @@ namespace rpm {
 		 */
 		bool Verify();
 
+		/**
+		 * @brief Checks that the exec header and info section lie within the module's image.
+		 * 
+		 * Only the image itself is read, so this is safe to call before Verify on a module that was copied from elsewhere.
+		 */
+		bool IsImageComplete();
+
 		/**
 		 * @brief Calculates the byte-size of a module after fixing.
 		 * 
@@ -124,6 +182,16 @@ namespace rpm {
 		 */
 		size_t CalcFixedSize(rpm::FixLevel fixLevel);
 
+		/**
+		 * @brief Strips control sections and moves the remaining ones together after the execution header.
+		 * 
+		 * The caller is responsible for shrinking the allocation. Not applicable to split modules, see StripSplitControl.
+		 * 
+		 * @param mask Sections to strip.
+		 * @return The size that the module can be shrunk to.
+		 */
+		size_t CompactControl(rpm::FixMask mask);
+
 		/**
 		 * @brief Interprets this module as an unassociated data type pointer.
 		 * 
@@ -167,7 +235,7 @@ namespace rpm {
 		 * @return The code segment's memory address as a char*.
 		 */
 		INLINE u8* GetCode() {
-			return (u8*) m_Exec->Info->Code;
+			return reinterpret_cast<u8*>(this) + m_Exec->Info->CodeOffset;
 		}
 
 		/**
@@ -179,6 +247,13 @@ namespace rpm {
 			return m_Exec->Info->CodeSize;
 		}
 
+		/**
+		 * @brief Gets the end of the module's BSS, which is also the end of its writable memory.
+		 */
+		INLINE u8* GetBSSEnd() {
+			return reinterpret_cast<u8*>(m_Exec); //the execution header always directly follows the BSS
+		}
+
 		/**
 		 * @brief Get the module's Symbol table section (.symtab).
 		 */
@@ -211,14 +286,14 @@ namespace rpm {
 		 * @return m_PrevModule 
 		 */
 		INLINE Module* GetPrevModule() {
-			return m_PrevModule;
+			return RPM_ATOMIC_LOAD(m_PrevModule);
 		}
 
 		/**
 		 * @brief Sets the previous loaded module in the runtime linked list.
 		 */
 		INLINE void SetPrevModule(Module* m) {
-			m_PrevModule = m;
+			RPM_ATOMIC_STORE(m_PrevModule, m);
 		}
 
 		/**
@@ -227,14 +302,14 @@ namespace rpm {
 		 * @return m_NextModule 
 		 */
 		INLINE Module* GetNextModule() {
-			return m_NextModule;
+			return RPM_ATOMIC_LOAD(m_NextModule);
 		}
 
 		/**
 		 * @brief Sets the next loaded module in the runtime linked list.
 		 */
 		INLINE void SetNextModule(Module* m) {
-			m_NextModule = m;
+			RPM_ATOMIC_STORE(m_NextModule, m);
 		}
 
 		/**
@@ -246,6 +321,65 @@ namespace rpm {
 			info->Relocations = nullptr;
 			info->Strings = nullptr;
 			info->MetaValueSection = nullptr;
+			info->StaticInitializers = nullptr;
+			info->StaticDestructors = nullptr;
+		}
+
+		/**
+		 * @brief Checks if the module's control sections are held in a separate allocation.
+		 */
+		INLINE bool IsControlSplit() {
+			return GetReserveFlag(RPM_RSVFLAG_CONTROL_SPLIT);
+		}
+
+		/**
+		 * @brief Gets the byte-size of the separate control section blocks that are still allocated.
+		 * 
+		 * @return The total size of the blocks, or 0 if the module is not split or all of its blocks have been released.
+		 */
+		INLINE size_t GetControlBlockSize() {
+			if (IsControlSplit()) {
+				return GetSplitExec()->ControlSize;
+			}
+			return 0;
+		}
+
+		/**
+		 * @brief Internal method to set the size of the control blocks after some of them have been released.
+		 * 
+		 * @param newSize The total size of the remaining blocks in bytes.
+		 */
+		INLINE void UpdateControlBlockSize(size_t newSize) {
+			GetSplitExec()->ControlSize = newSize;
+		}
+
+		/**
+		 * @brief Checks if the module has been started in deferred mode and its initializers have not been run yet.
+		 */
+		INLINE bool IsStartDeferred() {
+			//Read by lookups outside of the write lock
+			return RPM_ATOMIC_LOAD(m_ReserveFlags) & RPM_RSVFLAG_START_DEFERRED;
+		}
+
+		/**
+		 * @brief Checks if the module lives in memory owned by the caller rather than the module heap.
+		 */
+		INLINE bool IsExternalImage() {
+			return GetReserveFlag(RPM_RSVFLAG_EXTERNAL_IMAGE);
+		}
+
+		/**
+		 * @brief Checks if the module's internal relocations have been applied to its code.
+		 */
+		INLINE bool IsCodeRelocated() {
+			return GetReserveFlag(RPM_RSVFLAG_CODE_RELOCATED_INTERNAL);
+		}
+
+		/**
+		 * @brief Checks if all import symbols of the module have been resolved.
+		 */
+		INLINE bool IsFullyImported() {
+			return GetReserveFlag(RPM_RSVFLAG_ALL_IMPORTED);
 		}
 
 		void AllowLinking();
@@ -254,9 +388,10 @@ namespace rpm {
 		 * @brief Resolves mutual import/export symbols between two modules.
 		 * 
 		 * @param other The friend module to import/export from/to.
+		 * @param observer Optional observer to notify of every resolved import.
 		 * @return True if the other module was changed as a result of the linking process.
 		 */
-		bool LinkWithModule(Module* other);
+		bool LinkWithModule(Module* other, rpm::mgr::ImportObserver* observer = nullptr);
 
 		/**
 		 * @brief Unlinks mutual import/export symbols of two modules.
@@ -269,9 +404,20 @@ namespace rpm {
 		 * @brief Resolves import symbols from another module.
 		 * 
 		 * @param other The module to import symbols from.
+		 * @param observer Optional observer to notify of every resolved import.
 		 * @return Number of symbols imported from the other module.
 		 */
-		u32 ImportModule(Module* other);
+		u32 ImportModule(Module* other, rpm::mgr::ImportObserver* observer = nullptr);
+
+		/**
+		 * @brief Resolves a single import symbol from a known export of another module, without searching.
+		 * 
+		 * @param symIndex Index of the import symbol in this module's symbol table.
+		 * @param other The module to import the symbol from.
+		 * @param exportIndex Index of the symbol in the other module's export hash table.
+		 * @return True if the symbol has been imported, false if it had already been imported or the export does not match.
+		 */
+		bool ImportSymbol(u16 symIndex, Module* other, u16 exportIndex);
 
 		/**
 		 * @brief Unlinks symbols imported from another module.
@@ -282,6 +428,26 @@ namespace rpm {
 		 */
 		void UnimportModule(Module* other);
 
+		/**
+		 * @brief Checks if any of this module's resolved imports are bound to another module.
+		 * 
+		 * @param other The module to check.
+		 * @return True if at least one imported symbol has been resolved to an export of 'other'.
+		 */
+		bool ImportsFrom(Module* other);
+
+		/**
+		 * @brief Moves all imports bound to one module over to the matching exports of another, in a single pass over both hash tables.
+		 * 
+		 * Only the import relocations of symbols that have been rebound are processed again, found through their sorted order.
+		 * Imports that the new module does not export become pending.
+		 * 
+		 * @param from The module that the imports are bound to.
+		 * @param to The module to bind the imports to.
+		 * @return Number of imports rebound.
+		 */
+		u32 RebindImports(Module* from, Module* to);
+
 		/**
 		 * @brief Looks up a symbol index by name using string comparison.
 		 * 
@@ -342,6 +508,14 @@ namespace rpm {
 			return GetSymbolAddressAbsolute(FindExportSymbol(name));
 		}
 
+		/**
+		 * @brief Binds a table of function pointers to the module's exports in a single pass over the export hash table.
+		 * 
+		 * @param table The table to bind. Its bindings are sorted by hash if they have not been yet.
+		 * @return Number of bindings whose exports were not found. Their slots are set to null.
+		 */
+		RPM_PUBLIC u32 BindProcTable(ProcTable* table);
+
 		/**
 		 * @brief Gets the number of unique named modules that this module has external symbols within.
 		 * 
@@ -371,16 +545,21 @@ namespace rpm {
 		RPM_PUBLIC const char* GetRelExternModuleName(u16 index);
 	
 	private:
-		void Expand();
+		void Expand(const rpm::init::ModuleLayout* layout, rpm::init::LoadFlags flags);
+
+		void Prepare();
 
 		/**
-		 * @brief Relocates all control sections of this module.
+		 * @brief Removes all symbols that are neither exported nor called as static initializers/destructors from the symbol table.
 		 * 
-		 * A ReserveFlag is set to prevent this from being done more than once.
+		 * The order of the remaining symbols is kept, and the initializer/destructor lists are updated to the new indices.
 		 */
-		void RelocateControl();
+		void DropLocalSymbols();
 
-		void Prepare();
+		/**
+		 * @brief Removes the references to the control sections selected by a fix mask, without moving any memory.
+		 */
+		void StripControlSections(rpm::FixMask mask);
 
 		/**
 		 * @brief Performs all relocations that point to a given imported symbol.
@@ -389,24 +568,169 @@ namespace rpm {
 		 */
 		void RelocateByImportSymbol(u32 symIndex);
 
+		/**
+		 * @brief Binds an import symbol to an exported symbol of another module and relocates all references to it.
+		 * 
+		 * @param symIndex Index of the imported symbol in this module's symbol table.
+		 * @param other The exporting module.
+		 * @param extSym The exported symbol.
+		 */
+		void BindImport(u32 symIndex, Module* other, Symbol* extSym);
+
+		/**
+		 * @brief Points an import symbol and its address column entry to an exported symbol of another module, without relocating.
+		 * 
+		 * @param symIndex Index of the imported symbol in this module's symbol table.
+		 * @param other The exporting module.
+		 * @param extSym The exported symbol.
+		 */
+		void SetImportBinding(u32 symIndex, Module* other, Symbol* extSym);
+
+		/**
+		 * @brief Flags a bound import as pending again. The import worklist has to be rebuilt afterwards.
+		 * 
+		 * @param importIndex Index of the import in the import hash and address columns.
+		 */
+		void UnbindImport(u32 importIndex);
+
+		/**
+		 * @brief Calculates the address that an import symbol bound to an exported symbol holds.
+		 * 
+		 * @param other The exporting module.
+		 * @param extSym The exported symbol.
+		 */
+		static u32 CalcImportAddress(Module* other, Symbol* extSym);
+
+		/**
+		 * @brief Links all unresolved import symbols into the import worklist, in hash order.
+		 * 
+		 * The worklist head is kept in the reserve flags, and each pending import holds the offset of the next one in its Size field.
+		 * Bound imports take the size of their export again, see BindImport.
+		 */
+		void BuildImportWorklist();
+
 		/**
 		 * @brief Performs all local internal relocations.
 		 */
 		void RelocateInternal();
 
 		/**
-		 * @brief Relocates this module's DLHX-relative offset to a memory pointer.
+		 * @brief Performs a limited number of local internal relocations.
 		 * 
-		 * @param pptr Pointer to the location of the memory pointer.
+		 * @param pNext Index of the next relocation to process. Updated to the index following the last processed relocation.
+		 * @param maxCount Maximum number of relocations to process.
+		 * @return True if all internal relocations have been processed.
 		 */
-		void RelocHeaderPtr(void* pptr);
+		bool RelocateInternal(u32* pNext, u32 maxCount);
 
 		/**
-		 * @brief Relocates this module's DLXH-relative offset to a memory pointer, handling -1 and 0 as invalid null pointers.
+		 * @brief Execution header of a module loaded with separate control sections.
 		 * 
-		 * @param pptr Pointer to the location of the memory pointer.
+		 * The DllExec and InfoSection are copied next to the BSS so that the code remains addressable after the control blocks are freed.
 		 */
-		void RelocHeaderPtrNonNull(void* pptr);
+		struct SplitExec {
+			DllExec 	Exec;
+			InfoSection Info;
+			/**
+			 * @brief Total size of the control section blocks that are still allocated.
+			 */
+			u32			ControlSize;
+			/**
+			 * @brief Size of the string section, which can not be told from the section that follows it once each section has its own block.
+			 */
+			u32			StringsSize;
+		};
+
+		INLINE SplitExec* GetSplitExec() {
+			return reinterpret_cast<SplitExec*>(m_Exec);
+		}
+
+		enum ControlSectionKind {
+			CTRLSECT_INFO,
+			CTRLSECT_SYMBOLS,
+			CTRLSECT_EXPORT_HASHES,
+			CTRLSECT_RELOCATIONS,
+			CTRLSECT_STRINGS,
+			CTRLSECT_METADATA,
+			CTRLSECT_FUNC_ARRAYS
+		};
+
+		/**
+		 * @brief A control section and the pointer that references it, as moved by CompactControl.
+		 */
+		struct ControlSectionRef {
+			RelPtr<u8>*			Slot;
+			u8*					Start;
+			size_t				Size;
+			u8*					NewStart;
+			ControlSectionKind	Kind;
+		};
+
+		#define RPM_MAX_CONTROL_SECTIONS 16
+
+		/**
+		 * @brief Gathers all control sections that are currently referenced.
+		 * 
+		 * @param refs Output array of at least RPM_MAX_CONTROL_SECTIONS entries.
+		 * @param stringsEnd End of the string section, which does not store its own size.
+		 * @return Number of sections written to 'refs'.
+		 */
+		u32 CollectControlSections(ControlSectionRef* refs, u8* stringsEnd);
+
+		/**
+		 * @brief Gets the end of the memory holding the control sections of a module that is not split.
+		 */
+		u8* GetControlEnd();
+
+		/**
+		 * @brief Determines the end of the string section, which extends up to the next section.
+		 * 
+		 * @param refs Scratch array of at least RPM_MAX_CONTROL_SECTIONS entries.
+		 */
+		u8* CalcStringsEnd(ControlSectionRef* refs);
+
+		/**
+		 * @brief Sorts control sections by address. Of two sections at the same address, the larger one comes first.
+		 */
+		static void SortControlSections(ControlSectionRef* refs, u32 count);
+
+		/**
+		 * @brief Points the references to a set of control sections to their new locations.
+		 * 
+		 * References that live in one of the sections are looked up at the section's new location.
+		 * Sections without a Slot are not re-pointed, but the references within them are.
+		 */
+		static void RelinkControlSections(ControlSectionRef* refs, u32 count);
+
+		/**
+		 * @brief Turns an expanded module into a split module whose control sections have been copied to separate blocks.
+		 * 
+		 * The execution header and info section are rebuilt after the BSS, after which the module can be shrunk to GetModuleSize().
+		 * 
+		 * @param refs All control sections of the module, with NewStart set to their copies. The info section is placed by this function.
+		 * @param count Number of entries in 'refs'.
+		 * @param controlSize Total size of the control section blocks.
+		 */
+		void InitSplitControl(ControlSectionRef* refs, u32 count, size_t controlSize);
+
+		/**
+		 * @brief Strips control sections of a split module and finds the blocks that are no longer referenced.
+		 * 
+		 * @param mask Sections to strip.
+		 * @param released Output array of at least RPM_MAX_CONTROL_SECTIONS entries, receiving one section per unreferenced block.
+		 * @return Number of blocks that can be freed.
+		 */
+		u32 StripSplitControl(rpm::FixMask mask, ControlSectionRef* released);
+
+		/**
+		 * @brief Calculates the offset of the SplitExec header within a split module image.
+		 * 
+		 * @param prologSize Size of the module data preceding the original DLXH.
+		 * @param bssSize Size of the module's BSS.
+		 */
+		static INLINE size_t CalcSplitExecOffset(size_t prologSize, size_t bssSize) {
+			return (prologSize + bssSize + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+		}
 
 	private:
 		#define RPM_MAGIC MAGIC('R', 'P', 'M', '0')
@@ -420,23 +744,64 @@ namespace rpm {
 		Module*     m_NextModule;
 
 		enum ReserveFlag {
-			RPM_RSVFLAG_CONTROL_RELOCATED = 0x1,
+			/**
+			 * @brief The module has been placed and its control sections are usable.
+			 */
+			RPM_RSVFLAG_CONTROL_READY = 0x1,
 			RPM_RSVFLAG_CODE_RELOCATED_INTERNAL = 0x2,
 			RPM_RSVFLAG_MODULE_LINK_READY = 0x4,
 			RPM_RSVFLAG_ALL_IMPORTED = 0x8,
-			RPM_RSVFLAG_MODULE_STARTED = 0x10
+			RPM_RSVFLAG_MODULE_STARTED = 0x10,
+			RPM_RSVFLAG_CONTROL_SPLIT = 0x20,
+			RPM_RSVFLAG_START_DEFERRED = 0x40,
+			/**
+			 * @brief The module memory is owned by the caller, see RPM_LOADFLAG_EXTERNAL_IMAGE.
+			 */
+			RPM_RSVFLAG_EXTERNAL_IMAGE = 0x80,
+			/**
+			 * @brief FixLevel to apply once a deferred module is activated.
+			 */
+			RPM_RSVFLAG_DEFERRED_FIXLEVEL_MASK = 0xF00,
+			/**
+			 * @brief Offset of the first unresolved import symbol from FirstImportSymbolIdx. See BuildImportWorklist.
+			 */
+			RPM_RSVFLAG_IMPORT_WORKLIST_MASK = 0xFFFF0000
 		};
 
+		#define RPM_RSVFLAG_DEFERRED_FIXLEVEL_SHIFT 8
+		#define RPM_RSVFLAG_IMPORT_WORKLIST_SHIFT 16
+		#define RPM_IMPORT_WORKLIST_END 0xFFFF
+		/**
+		 * @brief Worklist head of a module whose imports have been bound individually, which breaks the links. The worklist is rebuilt on the next import.
+		 */
+		#define RPM_IMPORT_WORKLIST_STALE 0xFFFE
+
 		bool GetReserveFlag(ReserveFlag flag) {
 			return m_ReserveFlags & flag;
 		}
 
 		void SetReserveFlag(ReserveFlag flag) {
-			m_ReserveFlags |= flag;
+			RPM_ATOMIC_STORE(m_ReserveFlags, m_ReserveFlags | flag);
 		}
 
 		void ClearReserveFlag(ReserveFlag flag) {
-			m_ReserveFlags &= ~flag;
+			RPM_ATOMIC_STORE(m_ReserveFlags, m_ReserveFlags & ~flag);
+		}
+
+		void SetDeferredFixLevel(rpm::FixLevel fixLevel) {
+			RPM_ATOMIC_STORE(m_ReserveFlags, (m_ReserveFlags & ~RPM_RSVFLAG_DEFERRED_FIXLEVEL_MASK) | (fixLevel << RPM_RSVFLAG_DEFERRED_FIXLEVEL_SHIFT));
+		}
+
+		rpm::FixLevel GetDeferredFixLevel() {
+			return static_cast<rpm::FixLevel>((m_ReserveFlags & RPM_RSVFLAG_DEFERRED_FIXLEVEL_MASK) >> RPM_RSVFLAG_DEFERRED_FIXLEVEL_SHIFT);
+		}
+
+		void SetImportWorklistHead(u16 head) {
+			RPM_ATOMIC_STORE(m_ReserveFlags, (m_ReserveFlags & ~RPM_RSVFLAG_IMPORT_WORKLIST_MASK) | (static_cast<u32>(head) << RPM_RSVFLAG_IMPORT_WORKLIST_SHIFT));
+		}
+
+		u16 GetImportWorklistHead() {
+			return (m_ReserveFlags & RPM_RSVFLAG_IMPORT_WORKLIST_MASK) >> RPM_RSVFLAG_IMPORT_WORKLIST_SHIFT;
 		}
 	};
 }
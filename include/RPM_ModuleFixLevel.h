@@ -10,6 +10,8 @@
 #ifndef __RPM_MODULEFIXLEVEL_H
 #define __RPM_MODULEFIXLEVEL_H
 
+#include "exl_EnumFlagOperators.h"
+
 namespace rpm{
 	/**
 	 * @brief Level of section-stripping of a runtime module.
@@ -21,16 +23,68 @@ namespace rpm{
 		/**
 		 * @brief The module should be left in memory untouched.
 		 */
-		NONE,
+		NONE = 0,
 		/**
 		 * @brief The internal relocation table should be stripped.
 		 */
-		INTERNAL_RELOCATIONS,
+		INTERNAL_RELOCATIONS = 1,
 		/**
 		 * @brief All control data should be stripped.
 		 */
-		ALL_NONCODE
+		ALL_NONCODE = 2,
+		/**
+		 * @brief Everything but the exported symbols, their hash table and the static initializer/destructor lists should be stripped.
+		 * The module can still be looked up and imported from, but can no longer import symbols itself.
+		 * 
+		 * Strips less than ALL_NONCODE despite its higher value, which is kept for binary compatibility.
+		 */
+		EXPORTS_ONLY = 3
+	};
+
+	/**
+	 * @brief Set of control sections to strip from a runtime module.
+	 * 
+	 * Unlike FixLevel, any combination of sections may be stripped. The remaining sections are moved together
+	 * so that the freed memory can be returned to the heap regardless of where the stripped sections were placed.
+	 */
+	enum FixMask {
+		RPM_FIXMASK_NONE = 0,
+		/**
+		 * @brief The internal relocation table. Not needed once the module has been loaded.
+		 */
+		RPM_FIXMASK_INTERNAL_RELOCATIONS = 1 << 0,
+		/**
+		 * @brief The import relocation table. Symbols can no longer be imported once this is stripped.
+		 */
+		RPM_FIXMASK_IMPORT_RELOCATIONS = 1 << 1,
+		/**
+		 * @brief The external relocation table. The module can no longer be relocated by an extern relocator.
+		 */
+		RPM_FIXMASK_EXTERNAL_RELOCATIONS = 1 << 2,
+		/**
+		 * @brief The string table and the lists of extern module names.
+		 * Symbol lookups by hash keep working, but names and string metavalues become unavailable.
+		 */
+		RPM_FIXMASK_STRINGS = 1 << 3,
+		/**
+		 * @brief The metadata section.
+		 */
+		RPM_FIXMASK_METADATA = 1 << 4,
+		/**
+		 * @brief All symbols that are neither exported nor referenced by the static initializer/destructor lists.
+		 * The module can still be imported from, but can no longer import or be unimported, so its dependencies must outlive it.
+		 * Symbol indices change, so all relocation tables are stripped as well.
+		 */
+		RPM_FIXMASK_LOCAL_SYMBOLS = 1 << 5,
+
+		RPM_FIXMASK_ALL_RELOCATIONS = RPM_FIXMASK_INTERNAL_RELOCATIONS | RPM_FIXMASK_IMPORT_RELOCATIONS | RPM_FIXMASK_EXTERNAL_RELOCATIONS,
+		/**
+		 * @brief Sections stripped by FixLevel::EXPORTS_ONLY.
+		 */
+		RPM_FIXMASK_ALL_BUT_EXPORTS = RPM_FIXMASK_ALL_RELOCATIONS | RPM_FIXMASK_STRINGS | RPM_FIXMASK_METADATA | RPM_FIXMASK_LOCAL_SYMBOLS
 	};
+
+	DEFINE_ENUM_FLAG_OPERATORS(FixMask)
 }
 
 #endif
\ No newline at end of file
@@ -10,12 +10,81 @@
 #ifndef __RPM_MODULEINIT_H
 #define __RPM_MODULEINIT_H
 
+#include "RPM_Types.h"
+#include "exl_EnumFlagOperators.h"
+
 namespace rpm{
 	namespace init {
 		/**
 		 * @brief Intermediate RPM module allocation work type.
 		 */
 		typedef void* ModuleAllocation;
+
+		/**
+		 * @brief Options for placing a module prototype in memory.
+		 */
+		enum LoadFlags {
+			/**
+			 * @brief The module is expanded in place and code, BSS and control sections share a single allocation.
+			 */
+			RPM_LOADFLAG_NONE = 0,
+			/**
+			 * @brief Every control section is moved to a block of its own on the module heap.
+			 * Code, data and BSS stay in the prototype allocation, and each block is freed as a whole once its section is no longer needed.
+			 */
+			RPM_LOADFLAG_SPLIT_CONTROL = 1 << 0,
+			/**
+			 * @brief All memory of the allocation past the end of the file data is already zero-filled.
+			 */
+			RPM_LOADFLAG_ZEROED = 1 << 1,
+			/**
+			 * @brief The file data has been read according to a ModuleLayout, with the header section placed at HeaderOffset.
+			 * The BSS will not be cleared unless RPM_LOADFLAG_ZEROED is absent. Not applicable to split loading.
+			 */
+			RPM_LOADFLAG_PRE_EXPANDED = 1 << 2,
+			/**
+			 * @brief The allocation is owned by the caller, for example a fixed overlay region. It is never reallocated or freed by the manager,
+			 * so it must already be large enough for the expanded module. Not applicable to split loading.
+			 */
+			RPM_LOADFLAG_EXTERNAL_IMAGE = 1 << 3
+		};
+
+		DEFINE_ENUM_FLAG_OPERATORS(LoadFlags)
+
+		/**
+		 * @brief Recommended alignment of module allocations.
+		 */
+		#define RPM_MODULE_ALIGNMENT 8
+
+		/**
+		 * @brief In-memory placement of a module as determined from its file header.
+		 */
+		struct ModuleLayout {
+			/**
+			 * @brief Total size of the expanded module in memory.
+			 */
+			size_t AllocSize;
+			/**
+			 * @brief Required alignment of the module allocation.
+			 */
+			size_t Alignment;
+			/**
+			 * @brief Size of the module file.
+			 */
+			size_t FileSize;
+			/**
+			 * @brief Offset of the BSS within the expanded module. This is also where the header section starts in the file.
+			 */
+			size_t BSSOffset;
+			/**
+			 * @brief Size of the BSS.
+			 */
+			size_t BSSSize;
+			/**
+			 * @brief Offset of the header section within the expanded module.
+			 */
+			size_t HeaderOffset;
+		};
 	}
 }
 
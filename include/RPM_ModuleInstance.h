@@ -0,0 +1,157 @@
+/**
+ * @file RPM_ModuleInstance.h
+ * @author Hello007
+ * @brief Instances of a module that share its code.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ */
+#ifndef __RPM_MODULEINSTANCE_H
+#define __RPM_MODULEINSTANCE_H
+
+#include "RPM_Types.h"
+#include "RPM_Module.h"
+
+/**
+ * @brief Name of the INT metavalue holding the code-relative offset at which a module's instance-local data begins.
+ *
+ * Everything from this offset to the end of the BSS is copied for each instance. Everything before it is shared.
+ */
+#define RPM_METAVALUE_INSTANCE_DATA_OFFSET "InstanceDataOffset"
+
+namespace rpm {
+	namespace mgr {
+		/**
+		 * @brief A copy of a module's writable data and BSS that shares the rest of a template module.
+		 *
+		 * The shared code reaches the module's globals through absolute words (R_ARM_ABS32 literals), which act as the module's
+		 * global offset table. Each instance records where these words are, and activating an instance with
+		 * ModuleManager::ActivateModuleInstance rewrites them to point into its copy, so only one instance of a template
+		 * can run at a time. Pointers within the instance data that point at the instance data are rebased to the copy.
+		 *
+		 * Created by ModuleManager::CreateModuleInstance, which also runs the module's static initializers and DllMain for the instance.
+		 */
+		class ModuleInstance {
+		private:
+			/**
+			 * @brief A word in the shared part of the module that points at the instance data.
+			 */
+			struct Site {
+				/**
+				 * @brief Code-relative offset of the word.
+				 */
+				u32	Offset;
+				/**
+				 * @brief Offset of the word's target from the start of the instance data.
+				 */
+				u32	Target;
+			};
+
+			rpm::Module*	m_Template;
+			u8*				m_TemplateData;
+			u32				m_DataSize;
+			u8*				m_Data;
+			u32				m_SiteCount;
+			Site*			m_Sites;
+
+			friend class ModuleManager;
+
+		public:
+			/**
+			 * @brief Gets the module whose code this instance shares.
+			 */
+			INLINE rpm::Module* GetTemplate() {
+				return m_Template;
+			}
+
+			/**
+			 * @brief Gets the instance's own copy of the module data.
+			 */
+			INLINE void* GetData() {
+				return m_Data;
+			}
+
+			/**
+			 * @brief Gets the size of the instance's data, including the BSS.
+			 */
+			INLINE u32 GetDataSize() {
+				return m_DataSize;
+			}
+
+			/**
+			 * @brief Checks if the template's code currently uses this instance's data.
+			 *
+			 * Always true if the shared code does not address the instance data.
+			 */
+			INLINE bool IsActive() {
+				return GetActiveBase() == GetBase(m_Data);
+			}
+
+			/**
+			 * @brief Converts an address within the template module to the corresponding address in this instance.
+			 *
+			 * @param addr Address within the template module.
+			 * @return The instance's copy of 'addr' if it points at instance data, otherwise 'addr'.
+			 */
+			RPM_PUBLIC void* TranslateAddress(void* addr);
+
+			/**
+			 * @brief Gets the address of an exported symbol as seen by this instance.
+			 *
+			 * @param name Name of the symbol.
+			 * @return Pointer to the symbol in memory, or null if the template does not export it.
+			 */
+			RPM_PUBLIC void* GetProcAddress(const char* name);
+
+			/**
+			 * @brief Determines which part of a module is instance-local.
+			 *
+			 * A module is instanceable if it has an instance data offset, its shared part only addresses the instance data
+			 * through absolute words, and its instance data does not refer out of itself by relative relocations.
+			 * The internal relocations must still be present for the check.
+			 *
+			 * @param module The module to check.
+			 * @param pData Output for the start of the instance data within the module.
+			 * @param pSize Output for the size of the instance data.
+			 * @param pSiteCount Output for the number of words in the shared part that point at the instance data.
+			 * @return True if the module is instanceable.
+			 */
+			static bool GetInstanceData(rpm::Module* module, u8** pData, u32* pSize, u32* pSiteCount);
+
+		private:
+			/**
+			 * @brief Records the words in the shared part that point at the instance data.
+			 */
+			void CollectSites();
+
+			/**
+			 * @brief Rebases the pointers within the instance data that point at the instance data.
+			 */
+			void RebaseData();
+
+			/**
+			 * @brief Gets the 32-bit address of a copy of the instance data, as written to the shared code.
+			 */
+			static INLINE u32 GetBase(u8* data) {
+				return static_cast<u32>(reinterpret_cast<size_t>(data));
+			}
+
+			/**
+			 * @brief Gets the address of the instance data that the template's code currently uses, derived from the first recorded word.
+			 *
+			 * @return Base of the active instance, of the template's own data if none is active, or of this instance if there are no words to patch.
+			 */
+			u32 GetActiveBase();
+
+			/**
+			 * @brief Points the recorded words at a copy of the instance data.
+			 *
+			 * @param base Address of the instance data to use, or of the template's own data.
+			 */
+			void PointSitesAt(u32 base);
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,131 @@
+/**
+ * @file RPM_ModuleLoader.h
+ * @author Hello007
+ * @brief Resumable module loader for time-sliced loading.
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2026
+ */
+#ifndef __RPM_MODULELOADER_H
+#define __RPM_MODULELOADER_H
+
+#include "RPM_Types.h"
+#include "RPM_Module.h"
+#include "RPM_ModuleInit.h"
+#include "RPM_ModuleFixLevel.h"
+#include "RPM_ModuleManager.h"
+
+namespace rpm {
+	namespace mgr {
+		/**
+		 * @brief Loads and starts a module in bounded slices of work.
+		 * 
+		 * The loader performs the same operations in the same order as ModuleManager::LoadModule followed by ModuleManager::StartModule,
+		 * but can be suspended between any two units of work. One unit is a single relocation, static initializer call, module link pair
+		 * or fixed-cost stage (expansion, preparation, registration, fixing and DllMain).
+		 * 
+		 * Other modules may be unloaded between steps. A module unloaded while the loader is linking is skipped.
+		 */
+		class ModuleLoader {
+		public:
+			/**
+			 * @brief Loading stage of the module.
+			 */
+			enum Stage {
+				EXPAND,
+				PREPARE,
+				REGISTER,
+				LINK,
+				RELOCATE_INTERNAL,
+				STATIC_INITIALIZERS,
+				FIX,
+				DLLMAIN,
+				DONE,
+				FAILED
+			};
+
+		private:
+			ModuleManager*						m_Manager;
+			rpm::init::ModuleAllocation 		m_Data;
+			const rpm::init::ModuleLayout*		m_Layout;
+			rpm::init::LoadFlags				m_Flags;
+			rpm::FixLevel						m_FixLevel;
+
+			rpm::Module*	m_Module;
+			Stage			m_Stage;
+
+			ModuleManager::LinkCursor	m_LinkCursor;
+			u32				m_RelocCursor;
+			u32				m_FuncListCursor;
+			u32				m_FuncCursor;
+
+		public:
+			/**
+			 * @brief Prepares an incremental load of a module prototype. No work is done until Step is called.
+			 * 
+			 * @param mgr The manager to load the module into.
+			 * @param data The module prototype.
+			 * @param fixLevel Level of fixing to perform between relocation and calling DllMain.
+			 */
+			RPM_PUBLIC ModuleLoader(ModuleManager* mgr, rpm::init::ModuleAllocation data, rpm::FixLevel fixLevel);
+
+			/**
+			 * @brief Prepares an incremental load of a module prototype with placement options.
+			 * 
+			 * @param mgr The manager to load the module into.
+			 * @param data The module prototype.
+			 * @param layout The module's layout, or null to reallocate the prototype as needed. Must stay valid until the module has been expanded.
+			 * @param flags Placement options.
+			 * @param fixLevel Level of fixing to perform between relocation and calling DllMain.
+			 */
+			RPM_PUBLIC ModuleLoader(ModuleManager* mgr, rpm::init::ModuleAllocation data, const rpm::init::ModuleLayout* layout, rpm::init::LoadFlags flags, rpm::FixLevel fixLevel);
+
+			/**
+			 * @brief Abandons the load if it has not finished. The module is left loaded in whatever stage it was.
+			 */
+			RPM_PUBLIC ~ModuleLoader();
+
+			/**
+			 * @brief Performs up to 'budget' units of work.
+			 * 
+			 * @param budget Maximum number of work units to perform. Must be non-zero.
+			 * @return True if loading has finished, either successfully or not.
+			 */
+			RPM_PUBLIC bool Step(u32 budget);
+
+			/**
+			 * @brief Gets the current loading stage.
+			 */
+			INLINE Stage GetStage() {
+				return m_Stage;
+			}
+
+			/**
+			 * @brief Checks if loading has finished, either successfully or not.
+			 */
+			INLINE bool IsFinished() {
+				return m_Stage == DONE || m_Stage == FAILED;
+			}
+
+			/**
+			 * @brief Gets the module being loaded.
+			 * 
+			 * @return The module, or null if it has not been expanded yet or loading has failed.
+			 */
+			INLINE rpm::Module* GetModule() {
+				return m_Module;
+			}
+
+		private:
+			/**
+			 * @brief Calls up to 'budget' static initializer functions.
+			 * 
+			 * @return Number of work units used.
+			 */
+			u32 StepStaticInitializers(u32 budget);
+		};
+	}
+}
+
+#endif
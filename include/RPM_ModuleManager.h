@@ -21,9 +21,39 @@
 #include "RPM_ModuleInit.h"
 #include "RPM_ModuleFixLevel.h"
 #include "RPM_ModuleListener.h"
+#include "RPM_Sync.h"
+#include "RPM_ImportCache.h"
+#include "RPM_Snapshot.h"
+#include "RPM_ModuleInstance.h"
+#include "RPM_MemoryStats.h"
+#include "RPM_Trace.h"
+#include "RPM_MemoryPressureHandler.h"
+#include "RPM_ModuleSource.h"
+
+/**
+ * @brief Name of the STRING metavalue under which a module is registered when it is loaded. See ModuleManager::FindModule.
+ */
+#define RPM_METAVALUE_MODULE_NAME "ModuleName"
+/**
+ * @brief Name of the INT metavalue with the size of a module's work memory arena. See ModuleManager::AllocModuleWorkMemory.
+ */
+#define RPM_METAVALUE_WORK_ARENA_SIZE "WorkArenaSize"
+/**
+ * @brief Alignment of work memory blocks allocated from an arena.
+ */
+#define RPM_WORK_ARENA_ALIGNMENT 8
+/**
+ * @brief Extern module index that selects all external relocations of a module. See ModuleManager::ApplyExternRelocations.
+ */
+#define RPM_EXTERN_MODULE_ALL 0xFFFFFFFF
 
 namespace rpm {
 	namespace mgr {
+		class ModuleLoader;
+		class OverlayManager;
+		class AddressIndex;
+		class PipelineLoader;
+
 		class ModuleManager {
 		private:
 			exl::heap::Allocator* m_ModuleHeap;
@@ -31,6 +61,163 @@ namespace rpm {
 			rpm::Module* 		m_LastModule;
 			ExternalRelocator*	m_ExternRelocator;
 			ModuleListener*		m_ListenerHead;
+			ImportCache*		m_ImportCache;
+			TraceBuffer*		m_Trace;
+			MemoryPressureHandler*	m_PressureHandler;
+
+			/**
+			 * @brief Record of a work memory block allocated on the heap.
+			 */
+			struct WorkMemoryBlock {
+				void*				Memory;
+				rpm::Module*		Owner;
+				size_t				Size;
+			};
+
+			/**
+			 * @brief Header preceding every control section block of a split module.
+			 */
+			struct ControlBlockHeader {
+				size_t				Size;
+			};
+
+			/**
+			 * @brief Records of all work memory blocks on the heap, sorted by address. The blocks themselves carry no header.
+			 */
+			WorkMemoryBlock*	m_WorkMemoryBlocks;
+			u32					m_WorkMemoryCapacity;
+			u32					m_WorkMemoryCount;
+			size_t				m_WorkMemorySize;
+
+			/**
+			 * @brief Header of a module's work memory arena, allocated in one block with the arena.
+			 */
+			struct WorkArenaHeader {
+				WorkArenaHeader*	Next;
+				rpm::Module*		Owner;
+				size_t				Size;
+				size_t				Used;
+				/**
+				 * @brief Number of blocks allocated and not freed yet. The arena is rewound once all of them have been freed.
+				 */
+				u32					LiveCount;
+
+				INLINE u8* GetMemory() {
+					return reinterpret_cast<u8*>(this + 1);
+				}
+			};
+
+			WorkArenaHeader*	m_WorkArenaHead;
+			size_t				m_InstanceMemorySize;
+			/**
+			 * @brief Memory currently held on the module heap, kept up to date by every allocation and free.
+			 */
+			size_t				m_MemoryInUse;
+			size_t				m_PeakMemorySize;
+
+			/**
+			 * @brief Slot of the module name registry, an open-addressed hash table.
+			 */
+			struct ModuleNameEntry {
+				RPM_NAMEHASH	Hash;
+				rpm::Module*	Module;
+			};
+
+			ModuleNameEntry*	m_NameTable;
+			u32					m_NameTableCapacity;
+			u32					m_NameCount;
+
+			/**
+			 * @brief Position of a module in its link order, see LinkModuleStep.
+			 */
+			struct LinkCursor {
+				/**
+				 * @brief Index of the next extern module name to link with.
+				 */
+				u16				NameIndex;
+				/**
+				 * @brief Whether the named modules have resolved all imports of the module.
+				 */
+				bool			LinkedByName;
+				/**
+				 * @brief Next module of the chain to link with, walking from the last module backwards.
+				 * Advanced past a module that is unloaded while the cursor is active.
+				 */
+				rpm::Module*	Other;
+				/**
+				 * @brief Next active cursor, see m_LinkCursorHead.
+				 */
+				LinkCursor*		Next;
+			};
+
+			/**
+			 * @brief Cursors between BeginLinkModule and the end of their link order, so that RetireModule can move them off an unloaded module.
+			 */
+			LinkCursor*			m_LinkCursorHead;
+
+			/**
+			 * @brief Copy of a module image taken once it has been linked and relocated, before its initializers have run. See BindSnapshotHeap.
+			 */
+			struct SnapshotCapture {
+				SnapshotCapture*	Next;
+				rpm::Module*		Module;
+				u32					Size;
+				rpm::FixLevel		FixLevel;
+				/**
+				 * @brief Whether LinkModuleExtern has been called for all extern modules since the copy was taken.
+				 */
+				bool				ExternAll;
+				/**
+				 * @brief Number of words in the mask of extern module indices that LinkModuleExtern has been called for since the copy was taken.
+				 */
+				u32					ExternWordCount;
+
+				INLINE u32* GetExternMask() {
+					return reinterpret_cast<u32*>(this + 1);
+				}
+
+				INLINE u8* GetImage() {
+					return reinterpret_cast<u8*>(GetExternMask() + ExternWordCount);
+				}
+			};
+
+			exl::heap::Allocator*	m_SnapshotHeap;
+			SnapshotCapture*	m_SnapshotCaptureHead;
+
+			/**
+			 * @brief Record of a module having imported symbols from another. Kept when the imports are unbound again, until either module is unloaded.
+			 */
+			struct ModuleDependency {
+				rpm::Module*		Exporter;
+				rpm::Module*		Importer;
+			};
+
+			/**
+			 * @brief Records of all dependencies between loaded modules, sorted by exporter and importer, so that ReloadModule can find the dependents of a module.
+			 */
+			ModuleDependency*	m_Dependencies;
+			u32					m_DependencyCapacity;
+			u32					m_DependencyCount;
+			/**
+			 * @brief Set when a dependency could not be recorded, in which case dependents are searched for on the whole module chain.
+			 */
+			bool				m_DependencyOverflow;
+			/**
+			 * @brief The module that replaces the one being unloaded by ReloadModule, for listeners handling its UNLOADED event.
+			 */
+			rpm::Module*		m_Replacement;
+
+			#ifdef RPM_CONCURRENT
+			sync::RecursiveSpinLock m_WriteLock;
+			sync::EpochDomain		m_ReadDomain;
+			#endif
+
+			friend class ModuleLoader;
+			friend class ModuleReadScope;
+			friend class ImportCache;
+			friend class OverlayManager;
+			friend class AddressIndex;
+			friend class PipelineLoader;
 
 			//Note: The reason why all RPM_PUBLIC functions here are virtual is that it allows accessing ModuleManager functions through vtables
 			//That allows us to have non-RPM-kernel-linked libRPM and external dynamic libraries without code duplication
@@ -142,6 +329,8 @@ namespace rpm {
 			/**
 			 * @brief Links a module against all of the current module chain.
 			 * 
+			 * The modules are linked in the order described at LinkModuleStep.
+			 * 
 			 * @param module The module to link.
 			 */
 			void LinkModule(rpm::Module* module);
@@ -160,9 +349,596 @@ namespace rpm {
 			 * @param externModule Implementation-defined tag of the external module.
 			 */
 			RPM_PUBLIC virtual void LinkModuleExtern(rpm::Module* module, const char* externModule);
+
+			/**
+			 * @brief Loads a module to the ModuleManager's domain using the given placement options.
+			 * 
+			 * With RPM_LOADFLAG_SPLIT_CONTROL, every control section is copied to a block of its own on the module heap,
+			 * and 'data' is shrunk to hold only the code, data and BSS. Fixing the module then frees whole blocks, in any order.
+			 * 
+			 * @param data The module prototype.
+			 * @param flags Placement options.
+			 * @return Module constructed and loaded from the prototype.
+			 */
+			RPM_PUBLIC virtual rpm::Module* LoadModule(rpm::init::ModuleAllocation data, rpm::init::LoadFlags flags);
+
+			/**
+			 * @brief Loads a module from an allocation that has already been sized according to its layout.
+			 * 
+			 * No reallocation takes place. See rpm::Module::QueryModuleLayout.
+			 * 
+			 * @param data The module prototype, at least layout->AllocSize bytes large.
+			 * @param layout The module's layout, or null to reallocate the prototype as needed.
+			 * @param flags Placement options. RPM_LOADFLAG_PRE_EXPANDED can not be combined with RPM_LOADFLAG_SPLIT_CONTROL.
+			 * @return Module constructed and loaded from the prototype.
+			 */
+			RPM_PUBLIC virtual rpm::Module* LoadModule(rpm::init::ModuleAllocation data, const rpm::init::ModuleLayout* layout, rpm::init::LoadFlags flags);
+
+			/**
+			 * @brief Gets the most recently loaded module. Older modules can be reached through rpm::Module::GetPrevModule.
+			 * 
+			 * In concurrent builds, the module chain may only be walked from within a ModuleReadScope.
+			 * 
+			 * @return The last module in the module chain, or null if no modules are loaded.
+			 */
+			RPM_PUBLIC virtual rpm::Module* GetLastModule();
+
+			/**
+			 * @brief Looks up an exported procedure in all loaded modules, starting from the most recently loaded one.
+			 * 
+			 * @param name Name of the procedure.
+			 * @param pModule Optional output for the module that exports the procedure.
+			 * @return Pointer to the procedure in memory, or null if no module exports it.
+			 */
+			RPM_PUBLIC virtual void* FindProcAddress(const char* name, rpm::Module** pModule);
+
+			/**
+			 * @brief Binds a cache to record import resolutions in and to link from on subsequent loads.
+			 * 
+			 * The cache is also bound as a module listener, so only modules loaded afterwards are cached.
+			 * 
+			 * @param cache An ImportCache. Can only be bound once.
+			 */
+			RPM_PUBLIC virtual void BindImportCache(ImportCache* cache);
+
+			/**
+			 * @brief Links and relocates a module like StartModule, but defers its static initializers and DllMain until it is first used.
+			 * 
+			 * The module is activated when one of its exports is resolved through GetProcAddress or FindProcAddress,
+			 * when a started module imports symbols from it, or when ActivateModule is called.
+			 * Deferred modules that it imports from are activated along with it.
+			 * Until then, fixing is limited to FixLevel::INTERNAL_RELOCATIONS so that the initializer tables are kept.
+			 * 
+			 * @param module The module to start.
+			 * @param fixLevel Level of fixing to perform once the module has been activated.
+			 */
+			RPM_PUBLIC virtual void StartModuleDeferred(rpm::Module* module, rpm::FixLevel fixLevel);
+
+			/**
+			 * @brief Runs the static initializers and DllMain of a module started with StartModuleDeferred.
+			 * 
+			 * Does nothing if the module is not waiting for activation. Must not be called from within a ModuleReadScope.
+			 * 
+			 * @param module The module to activate.
+			 */
+			RPM_PUBLIC virtual void ActivateModule(rpm::Module* module);
+
+			/**
+			 * @brief Binds a heap to keep the module images needed by SaveSnapshot on.
+			 * 
+			 * Every module started from then on has its image copied once it has been linked and relocated, before its static initializers run,
+			 * and the extern modules that LinkModuleExtern is called for afterwards are recorded along with it. The copies are freed when
+			 * their module is unloaded. They are kept off the module heap so that they do not change where the following modules are placed.
+			 * 
+			 * @param heap The heap to allocate the copies on, or null to free all copies and stop taking them.
+			 */
+			RPM_PUBLIC virtual void BindSnapshotHeap(exl::heap::Allocator* heap);
+
+			/**
+			 * @brief Calculates the size of a snapshot of all loaded modules.
+			 * 
+			 * @return Size of the snapshot in bytes, or 0 if a module can not be snapshotted because it was started before a snapshot heap was bound,
+			 * it is still being loaded or its image does not cover its info section.
+			 */
+			RPM_PUBLIC virtual size_t CalcSnapshotSize();
+
+			/**
+			 * @brief Saves the images of all loaded modules as they were before their static initializers ran, see BindSnapshotHeap.
+			 * 
+			 * Work memory allocated by the modules is not included. Modules are expected to set it up again in DllMain when restored.
+			 * 
+			 * @param buffer Memory to write the snapshot to.
+			 * @param bufferSize Size of 'buffer' in bytes.
+			 * @param stamps Caller-defined identification of each module file in load order, or null.
+			 * @return Size of the snapshot in bytes, or 0 if it could not be saved.
+			 */
+			RPM_PUBLIC virtual size_t SaveSnapshot(void* buffer, size_t bufferSize, const u32* stamps);
+
+			/**
+			 * @brief Restores modules saved by SaveSnapshot into an empty ModuleManager whose heap is at the same address.
+			 * 
+			 * The modules are reallocated in load order and must land at their original addresses. Each restored module is then linked, has the
+			 * external relocations that were performed after its image was taken performed again, and is fixed and started the same way it was
+			 * when the snapshot was saved. Deferred modules that had not been activated stay deferred.
+			 * If validation or allocation fails, all modules restored so far are unloaded and the modules should be loaded normally.
+			 * 
+			 * @param snapshot The snapshot.
+			 * @param size Size of the snapshot in bytes.
+			 * @param stamps Identification of the currently installed module files in the same order as when saving, or null.
+			 * @param stampCount Number of elements in 'stamps'. Must match the number of modules in the snapshot.
+			 * @return True if all modules have been restored.
+			 */
+			RPM_PUBLIC virtual bool RestoreSnapshot(const void* snapshot, size_t size, const u32* stamps, u32 stampCount);
+
+			/**
+			 * @brief Creates a new instance of a module's data that shares the rest of the module.
+			 * 
+			 * The template module must be instanceable (see ModuleInstance::GetInstanceData) and must have been started
+			 * with StartModuleDeferred and FixLevel::NONE, so that its data is relocated but not yet touched by its initializers.
+			 * The template must not be activated or unloaded while it has instances.
+			 * 
+			 * The module's static initializers and DllMain(MODULE_LOAD) are run with the new instance active.
+			 * The instance that was active before stays active afterwards.
+			 * 
+			 * @param templ The template module.
+			 * @return The new instance, or null if the module is not instanceable or memory ran out.
+			 */
+			RPM_PUBLIC virtual ModuleInstance* CreateModuleInstance(rpm::Module* templ);
+
+			/**
+			 * @brief Points the template's shared code at an instance's data.
+			 * 
+			 * Only one instance of a template is active at a time. The template's code must not be running on another thread while this is called.
+			 * 
+			 * @param instance The instance to switch to.
+			 */
+			RPM_PUBLIC virtual void ActivateModuleInstance(ModuleInstance* instance);
+
+			/**
+			 * @brief Runs DllMain(MODULE_UNLOAD) and the static destructors for an instance created by CreateModuleInstance and frees it.
+			 * 
+			 * If the instance was active, the template's code is left pointing at its own data until another instance is activated.
+			 * 
+			 * @param instance The instance to free.
+			 */
+			RPM_PUBLIC virtual void DestroyModuleInstance(ModuleInstance* instance);
+
+			/**
+			 * @brief Strips any combination of control sections from a module and releases the freed memory.
+			 * 
+			 * The remaining sections are moved together and the module's allocation (or control block, if split) is shrunk.
+			 * Like with FixModule, stripping sections that are still needed is not prevented.
+			 * 
+			 * @param module The module to fix.
+			 * @param mask Sections to strip.
+			 */
+			RPM_PUBLIC virtual void FixModuleSections(rpm::Module* module, rpm::FixMask mask);
+
+			/**
+			 * @brief Allocates work memory on the module heap and accounts it to a module.
+			 * 
+			 * The memory is reported as the module's work memory until it is freed or the module is unloaded.
+			 * 
+			 * Modules with a RPM_METAVALUE_WORK_ARENA_SIZE metavalue get an arena of that size when they are loaded, and their work memory
+			 * is taken from it as long as it fits. Arena blocks are only reclaimed once all of them have been freed. The whole arena and any
+			 * blocks of the module that went to the heap are released when the module is unloaded, so they must not be used or freed after that.
+			 * 
+			 * @param size Size of the work area.
+			 * @param owner The module that uses the work memory, or null.
+			 * @return Pointer to the allocated work memory.
+			 */
+			RPM_PUBLIC virtual void* AllocModuleWorkMemory(size_t size, rpm::Module* owner);
+
+			/**
+			 * @brief Reports how much memory a module uses, broken down by section.
+			 * 
+			 * @param module The module.
+			 * @param stats Output statistics.
+			 */
+			RPM_PUBLIC virtual void GetModuleMemoryStats(rpm::Module* module, ModuleMemoryStats* stats);
+
+			/**
+			 * @brief Reports the total memory usage of all modules, work memory and instances.
+			 * 
+			 * @param stats Output statistics.
+			 */
+			RPM_PUBLIC virtual void GetMemoryStats(ManagerMemoryStats* stats);
+
+			/**
+			 * @brief Resets the peak memory usage to the current memory usage.
+			 */
+			RPM_PUBLIC virtual void ResetMemoryPeak();
+
+			/**
+			 * @brief Binds a ring buffer to record loader events in.
+			 * 
+			 * Events are only recorded in builds with RPM_TRACE defined.
+			 * 
+			 * @param trace A TraceBuffer, or null to stop recording.
+			 */
+			RPM_PUBLIC virtual void BindTraceBuffer(TraceBuffer* trace);
+
+			/**
+			 * @brief Registers a loaded module under a name, replacing the name it was registered under before.
+			 * 
+			 * Modules with a RPM_METAVALUE_MODULE_NAME metavalue are registered automatically when loaded.
+			 * Only the hash of the name is kept, so the name does not have to outlive the call.
+			 * 
+			 * @param module The module to name.
+			 * @param name The module's name, or null to only remove its current name.
+			 * @return False if another module is registered under the name or memory ran out.
+			 */
+			RPM_PUBLIC virtual bool SetModuleName(rpm::Module* module, const char* name);
+
+			/**
+			 * @brief Looks up a loaded module by its registered name.
+			 * 
+			 * @param name Name of the module.
+			 * @return The module, or null if no module is registered under the name.
+			 */
+			RPM_PUBLIC virtual rpm::Module* FindModule(const char* name);
+
+			/**
+			 * @brief Binds a handler to release memory when an allocation from the module heap fails.
+			 * 
+			 * @param handler A MemoryPressureHandler, or null to fail allocations right away.
+			 */
+			RPM_PUBLIC virtual void BindMemoryPressureHandler(MemoryPressureHandler* handler);
+
+			/**
+			 * @brief Loads a module from a ModuleSource, reading the file data directly to its expanded layout.
+			 * 
+			 * If the source maps the image itself, the module is loaded as an RPM_LOADFLAG_EXTERNAL_IMAGE and the source must outlive it.
+			 * Otherwise, the module is allocated on the module heap like a module loaded from a prototype.
+			 * 
+			 * @param source The source to read the module from.
+			 * @param flags Placement options. RPM_LOADFLAG_SPLIT_CONTROL is not supported.
+			 * @return The loaded module, or null if the source could not be read or the module failed verification.
+			 */
+			RPM_PUBLIC virtual rpm::Module* LoadModule(ModuleSource* source, rpm::init::LoadFlags flags);
+
+			/**
+			 * @brief Replaces a running module with a new image, moving the imports of its dependents over in place.
+			 * 
+			 * The new module is loaded, has its own imports linked and is started first. Then every module that has imported from the old one
+			 * is rebound to the new exports, processing only its relocations of the rebound imports, and has its pending imports linked with the new module.
+			 * Imports that the new module no longer exports become pending. Modules that never imported from the old module are not linked with the new one.
+			 * The old module is then unloaded without unlinking the rest of the chain. An overlay slot holding the old module is moved to the new one.
+			 * If the new module has no name of its own, it takes over the name of the old one.
+			 * 
+			 * All dependents must still have their import relocations, so none of them may have been fixed with RPM_FIXMASK_IMPORT_RELOCATIONS.
+			 * 
+			 * @param old The module to replace.
+			 * @param data The prototype of the new module. It is freed if the reload is not possible.
+			 * @param fixLevel Level to fix the new module to after it is started.
+			 * @return The new module, or null if a dependent can not be rebound or the new module could not be loaded. The old module stays loaded in that case.
+			 */
+			RPM_PUBLIC virtual rpm::Module* ReloadModule(rpm::Module* old, rpm::init::ModuleAllocation data, rpm::FixLevel fixLevel);
 		
 		private:
 			void CallModuleListeners(rpm::Module* module, ModuleEvent event);
+
+			/**
+			 * @brief Allocates from the module heap, asking the memory pressure handler to release memory if the heap is exhausted.
+			 */
+			void* AllocHeap(size_t size);
+
+			/**
+			 * @brief Places the file data of a module source in expanded layout, either mapped by the source or on the module heap.
+			 * 
+			 * @param source The source to read.
+			 * @param layout Output layout of the module.
+			 * @param flags Load flags to add the placement options of the image to.
+			 * @return The module image, or null if the source could not be read or memory ran out.
+			 */
+			rpm::init::ModuleAllocation ReadModuleImage(ModuleSource* source, rpm::init::ModuleLayout* layout, rpm::init::LoadFlags* flags);
+
+			/**
+			 * @brief Calls all functions of a module's static initializer or destructor list.
+			 * 
+			 * @param module The module.
+			 * @param funcArray The function list, or null.
+			 * @param type TRACE_STATIC_INITIALIZERS or TRACE_STATIC_DESTRUCTORS.
+			 */
+			void CallFuncArray(rpm::Module* module, rpm::FuncArrayList* funcArray, TraceEventType type);
+
+			/**
+			 * @brief Moves a module prototype to its final allocation and expands its BSS.
+			 * 
+			 * @param data The module prototype.
+			 * @param layout The module's layout, or null to reallocate the prototype as needed.
+			 * @param flags Placement options.
+			 * @return The expanded module, or null if allocation failed.
+			 */
+			rpm::Module* PlaceModule(rpm::init::ModuleAllocation data, const rpm::init::ModuleLayout* layout, rpm::init::LoadFlags flags);
+
+			/**
+			 * @brief Verifies a prepared module and adds it to the module chain.
+			 * 
+			 * @param module The module to register.
+			 * @return The registered module, or null if verification failed and the module has been freed.
+			 */
+			rpm::Module* RegisterModule(rpm::Module* module);
+
+			/**
+			 * @brief Registers a copy of a module image taken right after StartModuleDeferred, at the address that it was taken at.
+			 * 
+			 * The image keeps its relocations and import bindings. Other modules are linked to it like to a newly started module.
+			 * 
+			 * @param module The copied image.
+			 * @param cacheId Identity of the module that the image was taken from in the bound ImportCache, or 0.
+			 * @return The module, or null if it failed verification.
+			 */
+			rpm::Module* RegisterDeferredImage(rpm::Module* module, u32 cacheId);
+
+			/**
+			 * @brief Allows a module to be linked and resolves its imports from the import cache, if one is bound.
+			 * 
+			 * @param cursor Cursor to set to the start of the module's link order. Stays active until LinkModuleStep returns false or EndLinkModule is called.
+			 */
+			void BeginLinkModule(rpm::Module* module, LinkCursor* cursor);
+
+			/**
+			 * @brief Deactivates a link cursor before the end of its link order. Does nothing if the cursor is not active.
+			 */
+			void EndLinkModule(LinkCursor* cursor);
+
+			/**
+			 * @brief Links a module with the next module in its link order.
+			 * 
+			 * The link order is the same for every way of starting a module, so that a symbol exported by several modules
+			 * always binds to the same one. It consists of the loaded modules named in the symbol section's list of extern modules,
+			 * then the module chain from the last module backwards. If the named modules resolve all imports, the chain is only
+			 * walked for modules that still have unresolved imports.
+			 * 
+			 * @param cursor Cursor set by BeginLinkModule.
+			 * @param usedByStarted Set if a started module imported symbols from the module.
+			 * @return False if there was no module left to link with.
+			 */
+			bool LinkModuleStep(rpm::Module* module, LinkCursor* cursor, bool* usedByStarted);
+
+			/**
+			 * @brief Links a module with every module in its link order.
+			 * 
+			 * @return True if a started module imported symbols from the module.
+			 */
+			bool LinkModuleAll(rpm::Module* module);
+
+			/**
+			 * @brief Links a module with a single other module, notifying listeners if the other module has been changed.
+			 * 
+			 * If the module imports symbols from a deferred module and is not deferred itself, the deferred module is activated.
+			 * 
+			 * @return True if the other module has been started and imported symbols from the module.
+			 */
+			bool LinkModulePair(rpm::Module* module, rpm::Module* other);
+
+			/**
+			 * @brief Imports the symbols of one module that another exports, recording the dependency.
+			 * 
+			 * @return True if any symbol has been imported.
+			 */
+			bool ImportFromModule(rpm::Module* module, rpm::Module* other);
+
+			/**
+			 * @brief Resolves the imports of a module against the loaded modules, without linking other modules' imports against it.
+			 * 
+			 * @param module The module to link.
+			 * @param skip A module not to import from, or null.
+			 */
+			void LinkModuleImports(rpm::Module* module, rpm::Module* skip);
+
+			/**
+			 * @brief Runs the steps of StartModule that follow linking.
+			 */
+			void StartLinkedModule(rpm::Module* module, rpm::FixLevel fixLevel);
+
+			/**
+			 * @brief Finds the index of the first dependency record at or after an exporter and importer pair.
+			 */
+			u32 FindModuleDependency(rpm::Module* exporter, rpm::Module* importer);
+
+			/**
+			 * @brief Records that a module has imported symbols from another, growing the record table as needed.
+			 */
+			void AddModuleDependency(rpm::Module* exporter, rpm::Module* importer);
+
+			/**
+			 * @brief Records the dependencies of a module whose imports have been bound before it was registered, such as a restored image.
+			 */
+			void AddBoundDependencies(rpm::Module* module);
+
+			/**
+			 * @brief Removes all dependency records of a module, as importer and as exporter.
+			 */
+			void RemoveModuleDependencies(rpm::Module* module);
+
+			/**
+			 * @brief Activates a deferred module found by a lookup outside of the write lock, if it is still loaded.
+			 */
+			void ActivateFoundModule(rpm::Module* module);
+
+			/**
+			 * @brief Fixes a fully relocated module and notifies listeners that it is ready to run.
+			 */
+			void ReadyModule(rpm::Module* module, rpm::FixLevel fixLevel);
+
+			/**
+			 * @brief Flags a module as started after its DllMain has been called.
+			 */
+			void CompleteStartModule(rpm::Module* module);
+
+			/**
+			 * @brief Gets the module that was loaded first.
+			 */
+			rpm::Module* GetFirstModule();
+
+			/**
+			 * @brief Checks a snapshot's header against the installed module files.
+			 */
+			bool ValidateSnapshot(const SnapshotHeader* header, size_t size, const u32* stamps, u32 stampCount);
+
+			/**
+			 * @brief Copies a linked and relocated module image to the snapshot heap, if one is bound.
+			 */
+			void CaptureModule(rpm::Module* module, rpm::FixLevel fixLevel);
+
+			/**
+			 * @brief Finds the image copy of a module, or null if it has none.
+			 */
+			SnapshotCapture* FindSnapshotCapture(rpm::Module* module);
+
+			/**
+			 * @brief Frees the image copy of a module, if it has one.
+			 */
+			void ReleaseSnapshotCapture(rpm::Module* module);
+
+			/**
+			 * @brief Performs the external relocations of a module that target an extern module, or all of them.
+			 * 
+			 * @param module The module hosting the relocations.
+			 * @param extModIndex Index of the extern module in the module's extern module list, or RPM_EXTERN_MODULE_ALL.
+			 * @return True if any relocation has been passed to the external relocator.
+			 */
+			bool ApplyExternRelocations(rpm::Module* module, u32 extModIndex);
+
+			/**
+			 * @brief Releases all control section blocks of a split module, as for FixLevel::ALL_NONCODE.
+			 */
+			void ReleaseModuleControl(rpm::Module* module);
+
+			/**
+			 * @brief Copies each control section of an expanded module to a block of its own and shrinks the module to its persistent image.
+			 * 
+			 * @return False if a block could not be allocated, in which case the module is left as it was.
+			 */
+			bool SplitModuleControl(rpm::Module* module);
+
+			/**
+			 * @brief Frees a control section block of a split module.
+			 * 
+			 * @param block Start of the control section held by the block.
+			 * @return Size of the freed block, including its header.
+			 */
+			size_t FreeControlBlock(u8* block);
+
+			/**
+			 * @brief Strips control sections, compacts the rest and shrinks the allocation holding them.
+			 * 
+			 * @param module The module to fix.
+			 * @param mask Sections to strip.
+			 */
+			void CompactModule(rpm::Module* module, rpm::FixMask mask);
+
+			/**
+			 * @brief Applies a fix level to a module without updating the memory in use.
+			 */
+			void ApplyFixLevel(rpm::Module* module, rpm::FixLevel fixLevel);
+
+			/**
+			 * @brief Gets the size of a module's allocation(s), including split control blocks.
+			 */
+			static size_t GetModuleFootprint(rpm::Module* module);
+
+			/**
+			 * @brief Raises the peak memory usage to the current memory usage if it is higher.
+			 * Called wherever memory usage grows.
+			 */
+			void UpdateMemoryPeak();
+
+			/**
+			 * @brief Finds the index of the first work memory record at or after an address.
+			 */
+			u32 FindWorkMemoryBlock(void* mem);
+
+			/**
+			 * @brief Records a work memory block allocated on the heap, growing the record table as needed.
+			 * 
+			 * @return False if the table could not be grown.
+			 */
+			bool InsertWorkMemoryBlock(void* mem, rpm::Module* owner, size_t size);
+
+			/**
+			 * @brief Removes the work memory record at an index, freeing the record table once it is empty.
+			 */
+			void RemoveWorkMemoryBlock(u32 index);
+
+			/**
+			 * @brief Finds the registry slot of a name hash, or the empty slot where it would be inserted.
+			 */
+			ModuleNameEntry* FindNameEntry(RPM_NAMEHASH hash);
+
+			/**
+			 * @brief Adds a module to the name registry, growing it as needed.
+			 * 
+			 * @return False if the name is taken or memory ran out.
+			 */
+			bool InsertModuleName(RPM_NAMEHASH hash, rpm::Module* module);
+
+			/**
+			 * @brief Removes a module from the name registry, if it is registered.
+			 */
+			void RemoveModuleName(rpm::Module* module);
+
+			/**
+			 * @brief Finds the registry slot of a module, or null if it is not registered.
+			 */
+			ModuleNameEntry* FindModuleNameEntry(rpm::Module* module);
+
+			/**
+			 * @brief Allocates the work memory arena of a module if its metadata asks for one.
+			 */
+			void CreateWorkArena(rpm::Module* module);
+
+			/**
+			 * @brief Finds the work memory arena of a module, or null if it has none.
+			 */
+			WorkArenaHeader* FindWorkArena(rpm::Module* owner);
+
+			/**
+			 * @brief Finds the work memory arena that a block was allocated from, or null if it was allocated on its own.
+			 */
+			WorkArenaHeader* FindWorkArenaOf(void* mem);
+
+			/**
+			 * @brief Frees the work memory arena of a module, along with all blocks allocated from it.
+			 */
+			void ReleaseWorkArena(rpm::Module* module);
+
+			/**
+			 * @brief Frees the work memory blocks of a module that did not fit its arena and were allocated on the heap.
+			 */
+			void ReleaseWorkMemory(rpm::Module* module);
+
+			/**
+			 * @brief Stops, unchains and frees a module.
+			 * 
+			 * @param module The module to unload.
+			 * @param unlink Whether to unimport the module from all other modules. Skipped when its dependents have already been rebound.
+			 */
+			void RetireModule(rpm::Module* module, bool unlink);
+		};
+
+		/**
+		 * @brief Scope within which modules of a ModuleManager are guaranteed not to be freed or modified in place.
+		 * 
+		 * In concurrent builds, this lets threads walk the module chain and look up symbols while another thread loads or unloads modules.
+		 * Scopes must not be nested and must not be held while calling ModuleManager functions that take a scope on their own (GetProcAddress, FindProcAddress).
+		 * In single-threaded builds, this has no effect.
+		 */
+		class ModuleReadScope {
+		#ifdef RPM_CONCURRENT
+		private:
+			sync::ReadGuard m_Guard;
+
+		public:
+			ModuleReadScope(ModuleManager* mgr) : m_Guard(&mgr->m_ReadDomain) {
+			}
+		#else
+		public:
+			ModuleReadScope(ModuleManager* mgr) {
+			}
+		#endif
 		};
 	}
 }
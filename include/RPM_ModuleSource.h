@@ -0,0 +1,131 @@
+/**
+ * @file RPM_ModuleSource.h
+ * @author Hello007
+ * @brief Interface for loading modules straight from their storage, with file backends for Linux hosts.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ */
+#ifndef __RPM_MODULESOURCE_H
+#define __RPM_MODULESOURCE_H
+
+#include "RPM_Types.h"
+#include "RPM_DllExport.h"
+#include "RPM_ModuleInit.h"
+
+/**
+ * @brief Maximum number of bytes read by a FileReadSource in a single call.
+ */
+#define RPM_FILE_SOURCE_MAX_READ 0x40000
+
+namespace rpm {
+	namespace mgr {
+		/**
+		 * @brief Storage that a module file can be loaded from by ModuleManager::LoadModule, without reading the whole file to a buffer first.
+		 */
+		class ModuleSource {
+			public:
+				/**
+				 * @brief Gets the size of the module file.
+				 */
+				virtual size_t GetSize() = 0;
+
+				/**
+				 * @brief Reads a range of the module file.
+				 *
+				 * @param buffer Buffer to read to.
+				 * @param offset Offset in the file.
+				 * @param size Number of bytes to read.
+				 * @return True if all bytes were read.
+				 */
+				virtual bool Read(void* buffer, size_t offset, size_t size) = 0;
+
+				/**
+				 * @brief Virtual function called to place the module without allocating it from the module heap.
+				 *
+				 * The image must be laid out as described by the layout, with the BSS zero-filled. It stays owned by the source,
+				 * which has to keep it until the module is unloaded.
+				 *
+				 * @param layout Layout of the module.
+				 * @return The module image, or null to read the file into the module heap instead.
+				 */
+				virtual rpm::init::ModuleAllocation MapImage(const rpm::init::ModuleLayout* layout) { return nullptr; };
+		};
+	}
+}
+
+#ifdef __linux__
+
+namespace rpm {
+	namespace mgr {
+		/**
+		 * @brief Module file read with pread, straight into the module allocation.
+		 */
+		class FileReadSource : public ModuleSource {
+			protected:
+				int		m_Fd;
+				size_t	m_Size;
+				size_t	m_MaxRead;
+
+			public:
+				/**
+				 * @brief Creates a closed file source.
+				 *
+				 * @param maxRead Maximum number of bytes to read in a single call, which bounds the time that each read blocks.
+				 */
+				RPM_PUBLIC FileReadSource(size_t maxRead = RPM_FILE_SOURCE_MAX_READ);
+
+				RPM_PUBLIC virtual ~FileReadSource();
+
+				/**
+				 * @brief Opens a module file.
+				 *
+				 * @return False if the file could not be opened.
+				 */
+				RPM_PUBLIC bool Open(const char* path);
+
+				/**
+				 * @brief Closes the file. Images that were mapped from it are kept.
+				 */
+				RPM_PUBLIC void Close();
+
+				size_t GetSize() override;
+
+				bool Read(void* buffer, size_t offset, size_t size) override;
+		};
+
+		/**
+		 * @brief Module file mapped copy-on-write into the module image.
+		 *
+		 * Whole pages of code and data are mapped from the file with MAP_PRIVATE, so they are shared with the page cache
+		 * until they are relocated. The tail of the last such page, the BSS and the header section are anonymous memory.
+		 *
+		 * The mapped image belongs to the source, so the source must outlive the module and can map a single module at a time.
+		 */
+		class FileMapSource : public FileReadSource {
+			private:
+				void*	m_Image;
+				size_t	m_ImageSize;
+
+			public:
+				RPM_PUBLIC FileMapSource();
+
+				/**
+				 * @brief Closes the file and unmaps the image, if one is mapped.
+				 */
+				RPM_PUBLIC ~FileMapSource();
+
+				rpm::init::ModuleAllocation MapImage(const rpm::init::ModuleLayout* layout) override;
+
+				/**
+				 * @brief Unmaps the image. The module must have been unloaded.
+				 */
+				RPM_PUBLIC void UnmapImage();
+		};
+	}
+}
+
+#endif
+
+#endif
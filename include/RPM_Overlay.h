@@ -0,0 +1,203 @@
+/**
+ * @file RPM_Overlay.h
+ * @author Hello007
+ * @brief Fixed-address overlay slots with a cache of relocated module images.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ */
+#ifndef __RPM_OVERLAY_H
+#define __RPM_OVERLAY_H
+
+#include "RPM_Types.h"
+#include "RPM_Module.h"
+#include "RPM_ModuleFixLevel.h"
+#include "RPM_ModuleListener.h"
+#include "RPM_MemoryPressureHandler.h"
+
+/**
+ * @brief Maximum number of overlay slots of an OverlayManager.
+ */
+#define RPM_OVERLAY_MAX_SLOTS 8
+/**
+ * @brief Maximum number of modules that a cached overlay image can import from.
+ */
+#define RPM_OVERLAY_MAX_DEPENDENCIES 8
+
+namespace rpm {
+	namespace mgr {
+		class ModuleManager;
+
+		/**
+		 * @brief Reads an overlay module file.
+		 *
+		 * @param id Identifier of the overlay, as passed to OverlayManager::LoadOverlay.
+		 * @param buffer Buffer to read the file to.
+		 * @param bufferSize Size of the buffer in bytes.
+		 * @return Size of the file, or 0 if it could not be read or does not fit.
+		 */
+		typedef size_t (*OverlayReader)(u32 id, void* buffer, size_t bufferSize);
+
+		/**
+		 * @brief Loads modules into fixed memory regions and keeps copies of their relocated images for reloading.
+		 *
+		 * When an overlay is loaded from its file, its image is copied to the cache after linking and relocation, but before its initializers run.
+		 * Loading the same overlay into the same slot again restores the copy, without reading the file or processing any relocations.
+		 *
+		 * Cached images keep their import bindings, so an image is dropped as soon as a module that it imports from is unloaded.
+		 * Least recently used images are evicted to stay within the cache budget, and whenever the module heap runs out.
+		 *
+		 * The overlay manager binds itself as a module listener and memory pressure handler, so it must not be destroyed while the ModuleManager is in use.
+		 */
+		class OverlayManager : public ModuleListener, public MemoryPressureHandler {
+		private:
+			/**
+			 * @brief Caller-owned memory region that one overlay is loaded to at a time.
+			 */
+			struct Slot {
+				void*			Memory;
+				size_t			Size;
+				rpm::Module*	Module;
+				u32				Id;
+			};
+
+			/**
+			 * @brief A cached overlay image. The image follows the entry.
+			 */
+			struct CacheEntry {
+				CacheEntry*		Prev;
+				CacheEntry*		Next;
+				u32				Id;
+				u32				SlotIdx;
+				/**
+				 * @brief Identity of the overlay in the ImportCache bound to the manager, or 0.
+				 */
+				u32				CacheId;
+				size_t			ImageSize;
+				u32				DependencyCount;
+				rpm::Module*	Dependencies[RPM_OVERLAY_MAX_DEPENDENCIES];
+
+				static INLINE size_t GetHeaderSize() {
+					return (sizeof(CacheEntry) + RPM_MODULE_ALIGNMENT - 1) & ~(RPM_MODULE_ALIGNMENT - 1);
+				}
+
+				INLINE u8* GetImage() {
+					return reinterpret_cast<u8*>(this) + GetHeaderSize();
+				}
+			};
+
+			ModuleManager*	m_Manager;
+			OverlayReader	m_Reader;
+
+			Slot			m_Slots[RPM_OVERLAY_MAX_SLOTS];
+			u32				m_SlotCount;
+			/**
+			 * @brief Slot whose overlay is being started from its file, to be cached once it is relocated, or 0xFFFFFFFF.
+			 */
+			u32				m_CapturingSlot;
+
+			/**
+			 * @brief Most recently used cache entry.
+			 */
+			CacheEntry*		m_CacheHead;
+			/**
+			 * @brief Least recently used cache entry.
+			 */
+			CacheEntry*		m_CacheTail;
+			size_t			m_CacheSize;
+			size_t			m_CacheBudget;
+
+		public:
+			/**
+			 * @brief Creates an overlay manager without slots.
+			 *
+			 * @param mgr The manager to load overlays in.
+			 * @param reader Function to read overlay files with.
+			 * @param cacheBudget Maximum number of bytes taken by cached images, allocated from the module heap.
+			 */
+			RPM_PUBLIC OverlayManager(ModuleManager* mgr, OverlayReader reader, size_t cacheBudget);
+
+			/**
+			 * @brief Adds an overlay slot.
+			 *
+			 * @param memory Caller-owned memory that overlays are loaded to. Must be aligned to RPM_MODULE_ALIGNMENT.
+			 * @param size Size of the memory, which limits the size of the expanded overlays.
+			 * @return Index of the slot, or -1 if there are no free slots.
+			 */
+			RPM_PUBLIC u32 AddSlot(void* memory, size_t size);
+
+			/**
+			 * @brief Loads and starts an overlay, replacing the overlay in the slot.
+			 *
+			 * @param slot Index of the slot.
+			 * @param id Identifier of the overlay, passed to the reader.
+			 * @param fixLevel Level to fix the overlay to after it is started. The slot memory is never shrunk.
+			 * Overlays restored from the cache are fixed to the level that they were first loaded with.
+			 * @return The started overlay, or null if it could not be read or loaded.
+			 */
+			RPM_PUBLIC rpm::Module* LoadOverlay(u32 slot, u32 id, rpm::FixLevel fixLevel);
+
+			/**
+			 * @brief Unloads the overlay in a slot. Its cached image is kept.
+			 */
+			RPM_PUBLIC void UnloadOverlay(u32 slot);
+
+			/**
+			 * @brief Gets the overlay loaded in a slot, or null if the slot is empty.
+			 */
+			INLINE rpm::Module* GetOverlay(u32 slot) {
+				return slot < m_SlotCount ? m_Slots[slot].Module : nullptr;
+			}
+
+			/**
+			 * @brief Gets the number of bytes taken by cached images.
+			 */
+			INLINE size_t GetCacheSize() {
+				return m_CacheSize;
+			}
+
+			/**
+			 * @brief Sets the maximum number of bytes taken by cached images, evicting images as necessary.
+			 */
+			RPM_PUBLIC void SetCacheBudget(size_t budget);
+
+			/**
+			 * @brief Evicts cached images, least recently used first.
+			 *
+			 * @param size Number of bytes to release.
+			 * @return Number of bytes released, which may be more or less than requested.
+			 */
+			RPM_PUBLIC size_t ReleaseCache(size_t size);
+
+			void OnEvent(rpm::mgr::ModuleManager* mgr, rpm::Module* module, ModuleEvent event) override;
+
+			size_t OnMemoryPressure(rpm::mgr::ModuleManager* mgr, size_t size) override;
+
+		private:
+			rpm::Module* RestoreOverlay(u32 slot, CacheEntry* entry);
+
+			rpm::Module* ReadOverlay(u32 slot, u32 id, rpm::FixLevel fixLevel);
+
+			CacheEntry* FindCacheEntry(u32 slot, u32 id);
+
+			/**
+			 * @brief Copies the image of an overlay that has just been relocated to the cache.
+			 */
+			void CacheOverlay(u32 slot, rpm::Module* module);
+
+			void LinkCacheEntry(CacheEntry* entry);
+
+			void UnlinkCacheEntry(CacheEntry* entry);
+
+			void DropCacheEntry(CacheEntry* entry);
+
+			/**
+			 * @brief Evicts least recently used images until the cache takes at most the given number of bytes.
+			 */
+			void TrimCache(size_t maxSize);
+		};
+	}
+}
+
+#endif
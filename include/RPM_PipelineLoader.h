@@ -0,0 +1,167 @@
+/**
+ * @file RPM_PipelineLoader.h
+ * @author Hello007
+ * @brief Multi-threaded loading of module files on hosted platforms.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ */
+#ifndef __RPM_PIPELINELOADER_H
+#define __RPM_PIPELINELOADER_H
+
+#include "RPM_Types.h"
+#include "RPM_Module.h"
+#include "RPM_ModuleInit.h"
+#include "RPM_ModuleFixLevel.h"
+
+/**
+ * The pipelined loader relies on POSIX threads and the locking of a concurrent ModuleManager,
+ * so it is only available on Linux hosts built with RPM_CONCURRENT.
+ */
+#if defined(RPM_CONCURRENT) && defined(__linux__)
+#define RPM_PIPELINE
+
+#include <pthread.h>
+
+/**
+ * @brief Maximum number of worker threads of a PipelineLoader.
+ */
+#define RPM_PIPELINE_MAX_WORKERS 32
+/**
+ * @brief Maximum number of modules between reading and linking at once.
+ */
+#define RPM_PIPELINE_MAX_DEPTH 64
+
+namespace rpm {
+	namespace mgr {
+		class ModuleManager;
+
+		/**
+		 * @brief Loads and starts a list of module files, overlapping file reads, per-module work and linking.
+		 *
+		 * The work is split into three stages connected by a ring of in-flight modules:
+		 *  - An I/O thread allocates each module and reads its file directly into the expanded layout.
+		 *  - Worker threads expand the modules and process their internal relocations, in parallel.
+		 *  - The calling thread registers and starts the modules in list order, which is the only stage that touches the ModuleManager's state.
+		 *
+		 * The result is the same as loading and starting the files one after another. The ring depth bounds the number of modules
+		 * that have been read but not linked yet, and with it the extra memory used.
+		 *
+		 * Modules are relocated before they are registered, so their ImportCache identity is calculated by the workers beforehand.
+		 *
+		 * If the threads can not be created, the files are loaded one after another on the calling thread.
+		 */
+		class PipelineLoader {
+		private:
+			enum JobState {
+				/**
+				 * @brief The ring slot can be filled with the next file.
+				 */
+				JOB_FREE,
+				/**
+				 * @brief The file has been read and is waiting for a worker.
+				 */
+				JOB_READ,
+				JOB_EXPANDING,
+				/**
+				 * @brief The module is expanded and relocated, and waiting to be linked.
+				 */
+				JOB_EXPANDED,
+				JOB_FAILED
+			};
+
+			struct Job {
+				u32							Index;
+				JobState					State;
+				rpm::init::ModuleAllocation	Data;
+				rpm::init::ModuleLayout		Layout;
+				rpm::init::LoadFlags		Flags;
+				/**
+				 * @brief Identity of the module in the manager's ImportCache, calculated before relocation, or 0.
+				 */
+				u32							CacheId;
+			};
+
+			ModuleManager*		m_Manager;
+			u32					m_WorkerCount;
+			u32					m_Depth;
+
+			pthread_mutex_t		m_Mutex;
+			/**
+			 * @brief Signalled whenever a job changes state.
+			 */
+			pthread_cond_t		m_Cond;
+
+			Job					m_Jobs[RPM_PIPELINE_MAX_DEPTH];
+			const char* const*	m_Paths;
+			u32					m_Count;
+			/**
+			 * @brief Index of the next file that a worker can pick up.
+			 */
+			u32					m_WorkIndex;
+
+		public:
+			/**
+			 * @brief Creates a pipelined loader.
+			 *
+			 * @param mgr The manager to load the modules in. Heap allocations are serialized through its write lock.
+			 * @param workerCount Number of worker threads, or 0 to use one per online CPU.
+			 * @param depth Maximum number of modules in flight, at most RPM_PIPELINE_MAX_DEPTH.
+			 */
+			RPM_PUBLIC PipelineLoader(ModuleManager* mgr, u32 workerCount, u32 depth);
+
+			RPM_PUBLIC ~PipelineLoader();
+
+			/**
+			 * @brief Loads and starts module files in order.
+			 *
+			 * @param paths Paths of the module files.
+			 * @param count Number of files.
+			 * @param fixLevel Level to fix each module to after it is started.
+			 * @param modules Optional output array of the loaded modules, with null for files that failed to load.
+			 * @return Number of modules loaded.
+			 */
+			RPM_PUBLIC u32 LoadModules(const char* const* paths, u32 count, rpm::FixLevel fixLevel, rpm::Module** modules);
+
+		private:
+			static void* IOThreadMain(void* param);
+
+			static void* WorkerThreadMain(void* param);
+
+			/**
+			 * @brief Loads and starts the files one after another on the calling thread, for when the pipeline threads could not be started.
+			 */
+			u32 LoadModulesSequential(u32 count, rpm::FixLevel fixLevel, rpm::Module** modules);
+
+			/**
+			 * @brief Registers and starts the module of a finished job, or frees its data if the job failed.
+			 *
+			 * @return The started module, or null.
+			 */
+			rpm::Module* StartJob(Job* job, JobState state, rpm::FixLevel fixLevel);
+
+			/**
+			 * @brief Allocates a module and reads its file in expanded layout through a FileReadSource.
+			 *
+			 * @return True if the file was read into job->Data.
+			 */
+			bool ReadModule(const char* path, Job* job);
+
+			/**
+			 * @brief Expands and relocates a module that has been read.
+			 */
+			bool ExpandModule(Job* job);
+
+			void FreeModuleData(rpm::init::ModuleAllocation data);
+
+			INLINE Job* GetJob(u32 index) {
+				return &m_Jobs[index % m_Depth];
+			}
+		};
+	}
+}
+
+#endif
+
+#endif
@@ -0,0 +1,58 @@
+/**
+ * @file RPM_ProcTable.h
+ * @author Hello007
+ * @brief Tables of host function pointers bound to module exports in bulk.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ */
+#ifndef __RPM_PROCTABLE_H
+#define __RPM_PROCTABLE_H
+
+#include "RPM_Types.h"
+#include "RPM_Control.h"
+#include "RPM_Util.h"
+
+/**
+ * @brief Declares a ProcBinding of a function pointer variable to the export 'name', hashed at compile time.
+ */
+#define RPM_PROC_BINDING(name, slot) { rpm::Util::HashNameConst(name), reinterpret_cast<void**>(&(slot)) }
+
+/**
+ * @brief Declares a ProcTable over an array of ProcBindings.
+ */
+#define RPM_PROC_TABLE(bindings) { bindings, sizeof(bindings) / sizeof((bindings)[0]), false }
+
+namespace rpm {
+	/**
+	 * @brief A function pointer slot to be bound to an exported procedure.
+	 */
+	struct ProcBinding {
+		/**
+		 * @brief Name hash of the export.
+		 */
+		RPM_NAMEHASH	Hash;
+		/**
+		 * @brief Slot to store the address of the export to, or null if the export is missing.
+		 */
+		void**			Slot;
+	};
+
+	/**
+	 * @brief A list of ProcBindings bound together by Module::BindProcTable.
+	 *
+	 * The bindings are sorted by hash the first time the table is bound, so that every bind is a single merge pass
+	 * over the module's export hash table. Binding the table again, for example to a reloaded module, refreshes the slots in place.
+	 */
+	struct ProcTable {
+		ProcBinding*	Bindings;
+		u32				Count;
+		/**
+		 * @brief Set once the bindings have been sorted by hash.
+		 */
+		bool			Sorted;
+	};
+}
+
+#endif
@@ -0,0 +1,83 @@
+/**
+ * @file RPM_Snapshot.h
+ * @author Hello007
+ * @brief Serialized format of module heap snapshots.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ */
+#ifndef __RPM_SNAPSHOT_H
+#define __RPM_SNAPSHOT_H
+
+#include "RPM_Types.h"
+#include "RPM_Util.h"
+
+namespace rpm {
+	namespace mgr {
+		enum SnapshotModuleFlags {
+			/**
+			 * @brief The module had been started, or activated if it was started deferred.
+			 */
+			SNAPSHOT_MODULE_STARTED = (1 << 0),
+			/**
+			 * @brief LinkModuleExtern had been called for all extern modules after the image was taken.
+			 */
+			SNAPSHOT_MODULE_EXTERN_ALL = (1 << 1)
+		};
+
+		/**
+		 * @brief A module image within a snapshot, taken before its static initializers ran.
+		 * The image is followed by the mask of extern module indices that LinkModuleExtern had been called for after it was taken.
+		 */
+		struct SnapshotModule {
+			/**
+			 * @brief Address that the module was loaded at. Restoring fails if the module can not be allocated at the same address.
+			 */
+			void*	Address;
+			u32		Size;
+			/**
+			 * @brief Offset of the module image from the start of the snapshot.
+			 */
+			u32		DataOffset;
+			/**
+			 * @brief Caller-defined identification of the module file, such as its size and modification date.
+			 */
+			u32		Stamp;
+			/**
+			 * @brief Identity of the module in the ImportCache bound when the snapshot was taken, or 0.
+			 */
+			u32		CacheId;
+			/**
+			 * @brief rpm::FixLevel that the module was started with.
+			 */
+			u32		FixLevel;
+			/**
+			 * @brief SnapshotModuleFlags.
+			 */
+			u32		Flags;
+			/**
+			 * @brief Number of words in the extern module mask that follows the 4-byte aligned image.
+			 */
+			u32		ExternWordCount;
+		};
+
+		/**
+		 * @brief Header of a snapshot of all modules of a ModuleManager. Module images follow the entries, 4-byte aligned.
+		 */
+		struct SnapshotHeader {
+			#define SNAPSHOT_MAGIC MAGIC('R', 'S', 'S', '1')
+
+			u32				Magic;
+			u32				Version;
+			u32				TotalSize;
+			u32				ModuleCount;
+			/**
+			 * @brief Modules in load order.
+			 */
+			SnapshotModule	Modules[];
+		};
+	}
+}
+
+#endif
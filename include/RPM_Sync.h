@@ -0,0 +1,213 @@
+/**
+ * @file RPM_Sync.h
+ * @author Hello007
+ * @brief Synchronization primitives for the concurrent ModuleManager.
+ * @version 0.1
+ * @date 2026-10-19
+ * 
+ * @copyright Copyright (c) 2026
+ */
+#ifndef __RPM_SYNC_H
+#define __RPM_SYNC_H
+
+#include "RPM_Types.h"
+
+/**
+ * Define RPM_CONCURRENT to build a ModuleManager that can be used from multiple threads.
+ * 
+ * Writers (loading, starting, fixing, unloading) are serialized by a recursive lock, while readers (symbol lookup, module iteration)
+ * never block unless a module is being modified in place. The implementation relies on the GCC __atomic builtins and thread-local storage,
+ * so it requires a multi-core capable target (ARMv6 or newer) or a hosted platform.
+ */
+#ifdef RPM_CONCURRENT
+
+#define RPM_ATOMIC_LOAD(var) __atomic_load_n(&(var), __ATOMIC_ACQUIRE)
+#define RPM_ATOMIC_STORE(var, value) __atomic_store_n(&(var), (value), __ATOMIC_RELEASE)
+
+#define RPM_SYNC_WRITE_SCOPE(lock) rpm::sync::WriteGuard __rpmWriteGuard(&(lock))
+#define RPM_SYNC_READ_SCOPE(domain) rpm::sync::ReadGuard __rpmReadGuard(&(domain))
+#define RPM_SYNC_EXCLUSIVE_SCOPE(domain) rpm::sync::ExclusiveGuard __rpmExclusiveGuard(&(domain))
+#define RPM_SYNC_SYNCHRONIZE(domain) (domain).Synchronize()
+
+namespace rpm {
+	namespace sync {
+		/**
+		 * @brief Gets a value that uniquely identifies the calling thread.
+		 */
+		INLINE void* GetThreadTag() {
+			static thread_local u8 tag;
+			return &tag;
+		}
+
+		/**
+		 * @brief Spin lock that may be re-acquired by the thread that holds it.
+		 */
+		class RecursiveSpinLock {
+		private:
+			void*	m_Owner;
+			u32		m_Depth;
+
+		public:
+			RecursiveSpinLock() {
+				m_Owner = nullptr;
+				m_Depth = 0;
+			}
+
+			void Lock() {
+				void* self = GetThreadTag();
+				if (__atomic_load_n(&m_Owner, __ATOMIC_RELAXED) == self) {
+					m_Depth++;
+					return;
+				}
+				void* expected = nullptr;
+				while (!__atomic_compare_exchange_n(&m_Owner, &expected, self, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+					expected = nullptr;
+				}
+				m_Depth = 1;
+			}
+
+			void Unlock() {
+				if (--m_Depth == 0) {
+					__atomic_store_n(&m_Owner, nullptr, __ATOMIC_RELEASE);
+				}
+			}
+		};
+
+		/**
+		 * @brief Epoch-based read domain.
+		 * 
+		 * Readers register themselves in one of two counters selected by the current epoch. A writer that has unpublished a piece of data
+		 * advances the epoch and waits for the previous epoch's readers to drain before freeing it. For data that has to be modified in place,
+		 * the writer can additionally hold off new readers.
+		 * 
+		 * Read sections must not be nested on the same domain.
+		 */
+		class EpochDomain {
+		private:
+			u32 m_Epoch;
+			u32 m_Readers[2];
+			u32 m_Exclusive;
+
+		public:
+			EpochDomain() {
+				m_Epoch = 0;
+				m_Readers[0] = 0;
+				m_Readers[1] = 0;
+				m_Exclusive = 0;
+			}
+
+			/**
+			 * @brief Enters a read section.
+			 * 
+			 * @return Ticket to pass to LeaveRead.
+			 */
+			u32 EnterRead() {
+				while (true) {
+					if (__atomic_load_n(&m_Exclusive, __ATOMIC_SEQ_CST)) {
+						continue;
+					}
+					u32 epoch = __atomic_load_n(&m_Epoch, __ATOMIC_SEQ_CST);
+					__atomic_fetch_add(&m_Readers[epoch & 1], 1, __ATOMIC_SEQ_CST);
+					if (__atomic_load_n(&m_Epoch, __ATOMIC_SEQ_CST) == epoch && !__atomic_load_n(&m_Exclusive, __ATOMIC_SEQ_CST)) {
+						return epoch;
+					}
+					__atomic_fetch_sub(&m_Readers[epoch & 1], 1, __ATOMIC_SEQ_CST);
+				}
+			}
+
+			/**
+			 * @brief Leaves a read section.
+			 * 
+			 * @param ticket Value returned by EnterRead.
+			 */
+			void LeaveRead(u32 ticket) {
+				__atomic_fetch_sub(&m_Readers[ticket & 1], 1, __ATOMIC_RELEASE);
+			}
+
+			/**
+			 * @brief Waits until no reader can still observe data unpublished before this call. Writers only.
+			 */
+			void Synchronize() {
+				u32 epoch = __atomic_load_n(&m_Epoch, __ATOMIC_SEQ_CST);
+				__atomic_store_n(&m_Epoch, epoch + 1, __ATOMIC_SEQ_CST);
+				while (__atomic_load_n(&m_Readers[epoch & 1], __ATOMIC_ACQUIRE)) {
+				}
+			}
+
+			/**
+			 * @brief Holds off new readers and waits for all current readers to leave. Writers only.
+			 */
+			void BeginExclusive() {
+				__atomic_store_n(&m_Exclusive, 1, __ATOMIC_SEQ_CST);
+				Synchronize();
+			}
+
+			/**
+			 * @brief Lets readers in again after BeginExclusive.
+			 */
+			void EndExclusive() {
+				__atomic_store_n(&m_Exclusive, 0, __ATOMIC_RELEASE);
+			}
+		};
+
+		class WriteGuard {
+		private:
+			RecursiveSpinLock* m_Lock;
+
+		public:
+			WriteGuard(RecursiveSpinLock* lock) {
+				m_Lock = lock;
+				m_Lock->Lock();
+			}
+
+			~WriteGuard() {
+				m_Lock->Unlock();
+			}
+		};
+
+		class ReadGuard {
+		private:
+			EpochDomain*	m_Domain;
+			u32				m_Ticket;
+
+		public:
+			ReadGuard(EpochDomain* domain) {
+				m_Domain = domain;
+				m_Ticket = domain->EnterRead();
+			}
+
+			~ReadGuard() {
+				m_Domain->LeaveRead(m_Ticket);
+			}
+		};
+
+		class ExclusiveGuard {
+		private:
+			EpochDomain* m_Domain;
+
+		public:
+			ExclusiveGuard(EpochDomain* domain) {
+				m_Domain = domain;
+				m_Domain->BeginExclusive();
+			}
+
+			~ExclusiveGuard() {
+				m_Domain->EndExclusive();
+			}
+		};
+	}
+}
+
+#else
+
+#define RPM_ATOMIC_LOAD(var) (var)
+#define RPM_ATOMIC_STORE(var, value) ((var) = (value))
+
+#define RPM_SYNC_WRITE_SCOPE(lock)
+#define RPM_SYNC_READ_SCOPE(domain)
+#define RPM_SYNC_EXCLUSIVE_SCOPE(domain)
+#define RPM_SYNC_SYNCHRONIZE(domain)
+
+#endif
+
+#endif
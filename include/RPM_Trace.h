@@ -0,0 +1,204 @@
+/**
+ * @file RPM_Trace.h
+ * @author Hello007
+ * @brief Ring buffer of timestamped loader events.
+ * @version 0.1
+ * @date 2026-10-19
+ *
+ * @copyright Copyright (c) 2026
+ */
+#ifndef __RPM_TRACE_H
+#define __RPM_TRACE_H
+
+#include "RPM_Types.h"
+#include "RPM_DllExport.h"
+
+namespace rpm {
+	class Module;
+
+	namespace mgr {
+		/**
+		 * @brief Loader operation that a trace event belongs to.
+		 */
+		enum TraceEventType {
+			/**
+			 * @brief Placement, preparation and registration of a module.
+			 */
+			TRACE_LOAD,
+			/**
+			 * @brief Linking of a module with another module. 'Other' is the other module.
+			 */
+			TRACE_LINK,
+			/**
+			 * @brief Internal relocation. 'Arg' is the number of relocations in the batch, or 0 if all of them were processed at once.
+			 */
+			TRACE_RELOCATE,
+			/**
+			 * @brief Module listener callback. 'Other' is the listener and 'Arg' the ModuleEvent.
+			 */
+			TRACE_LISTENER,
+			TRACE_STATIC_INITIALIZERS,
+			TRACE_STATIC_DESTRUCTORS,
+			/**
+			 * @brief DllMain call. 'Arg' is the DllMainReason.
+			 */
+			TRACE_DLLMAIN,
+			/**
+			 * @brief Fixing of a module. 'Arg' is the FixLevel or FixMask.
+			 */
+			TRACE_FIX,
+			TRACE_UNLOAD,
+
+			TRACE_EVENT_TYPE_COUNT
+		};
+
+		enum TracePhase {
+			TRACE_BEGIN,
+			TRACE_END
+		};
+
+		/**
+		 * @brief A recorded loader event. The layout is identical on all platforms so that device dumps can be converted on a host.
+		 */
+		struct TraceEvent {
+			u64	Timestamp;
+			u64	Module;
+			u64	Other;
+			u32	Arg;
+			u8	Type;
+			u8	Phase;
+			u16	Reserved;
+		};
+
+		/**
+		 * @brief Returns the current time in ticks.
+		 */
+		typedef u64 (*TraceClock)();
+
+		/**
+		 * @brief Fixed-size ring buffer of loader events, kept in a caller-provided buffer.
+		 *
+		 * When full, the oldest events are overwritten. Recording never allocates memory.
+		 * The buffer can be dumped as-is and later converted with WriteChromeTrace.
+		 *
+		 * Events are only recorded in builds with RPM_TRACE defined, after binding the buffer with ModuleManager::BindTraceBuffer.
+		 */
+		class TraceBuffer {
+		public:
+			/**
+			 * @brief Header of the raw trace buffer. Events follow in ring order.
+			 */
+			struct Header {
+				#define TRACE_MAGIC MAGIC('R', 'T', 'R', '0')
+
+				u32	Magic;
+				u32	Version;
+				u32	Capacity;
+				u32	EventSize;
+				/**
+				 * @brief Number of events recorded since the buffer was cleared, including overwritten ones.
+				 */
+				u64	Count;
+				u64	TickFrequency;
+			};
+
+		private:
+			Header*		m_Data;
+			TraceClock	m_Clock;
+
+		public:
+			/**
+			 * @brief Creates an empty trace buffer.
+			 *
+			 * @param storage Buffer to hold the events. Should be 8-byte aligned.
+			 * @param storageSize Size of the buffer in bytes.
+			 * @param clock Source of the event timestamps.
+			 * @param tickFrequency Number of clock ticks per second.
+			 */
+			RPM_PUBLIC TraceBuffer(void* storage, size_t storageSize, TraceClock clock, u64 tickFrequency);
+
+			/**
+			 * @brief Gets the raw trace buffer for dumping.
+			 */
+			INLINE const void* GetData() {
+				return m_Data;
+			}
+
+			/**
+			 * @brief Gets the size of the raw trace buffer in bytes.
+			 */
+			INLINE size_t GetDataSize() {
+				return sizeof(Header) + m_Data->Capacity * sizeof(TraceEvent);
+			}
+
+			/**
+			 * @brief Removes all events.
+			 */
+			RPM_PUBLIC void Clear();
+
+			/**
+			 * @brief Records an event, overwriting the oldest one if the buffer is full.
+			 */
+			void Record(TraceEventType type, TracePhase phase, rpm::Module* module, const void* other, u32 arg);
+
+			/**
+			 * @brief Writes a raw trace buffer as Chrome trace-event JSON, oldest event first.
+			 *
+			 * @param raw The raw trace buffer, as returned by GetData.
+			 * @param rawSize Size of the raw trace buffer.
+			 * @param out The file to write to.
+			 * @return False if the buffer is not a valid trace buffer.
+			 */
+			RPM_PUBLIC static bool WriteChromeTrace(const void* raw, size_t rawSize, FILE* out);
+
+		private:
+			INLINE TraceEvent* GetEvents() {
+				return reinterpret_cast<TraceEvent*>(m_Data + 1);
+			}
+		};
+
+		/**
+		 * @brief Records the beginning and end of a scope.
+		 */
+		class TraceScope {
+		private:
+			TraceBuffer*	m_Buffer;
+			TraceEventType	m_Type;
+			rpm::Module*	m_Module;
+			const void*		m_Other;
+			u32				m_Arg;
+
+		public:
+			INLINE TraceScope(TraceBuffer* buffer, TraceEventType type, rpm::Module* module, const void* other, u32 arg) {
+				m_Buffer = buffer;
+				m_Type = type;
+				m_Module = module;
+				m_Other = other;
+				m_Arg = arg;
+				if (buffer) {
+					buffer->Record(type, TRACE_BEGIN, module, other, arg);
+				}
+			}
+
+			INLINE ~TraceScope() {
+				if (m_Buffer) {
+					m_Buffer->Record(m_Type, TRACE_END, m_Module, m_Other, m_Arg);
+				}
+			}
+		};
+	}
+}
+
+/**
+ * Define RPM_TRACE to record loader events to the TraceBuffer bound to a ModuleManager.
+ * Otherwise, tracing compiles to nothing.
+ */
+#ifdef RPM_TRACE
+#define RPM_TRACE_SCOPE(buffer, type, module, other, arg) rpm::mgr::TraceScope __rpmTraceScope((buffer), (type), (module), (other), (arg))
+#define RPM_TRACE_EVENT(buffer, type, phase, module, other, arg) do { if (buffer) { (buffer)->Record((type), (phase), (module), (other), (arg)); } } while (0)
+#else
+#define RPM_TRACE_SCOPE(buffer, type, module, other, arg)
+#define RPM_TRACE_EVENT(buffer, type, phase, module, other, arg)
+#endif
+
+#endif
@@ -12,6 +12,11 @@
 
 #include "RPM_Types.h"
 
+/**
+ * @brief FNV1a offset basis used to start hashes with Util::HashData.
+ */
+#define RPM_HASH_SEED 0x811C9DC5
+
 #define MAGIC(a,b,c,d) static_cast<u32>((static_cast<u8>(a) <<  0) | (static_cast<u8>(b) << 8) | (static_cast<u8>(c) << 16) | (static_cast<u8>(d) << 24))
 
 #ifdef DEBUG
@@ -102,6 +107,38 @@ namespace rpm {
 		 */
 		static void DoRelocation(u8* srcAddr, Module* m, Relocation* r);
 
+		/**
+		 * @brief Applies a run of RPM_REL_TGTTYPE_OFFSET relocations to consecutive words.
+		 * 
+		 * Pointer tables and vtables produce long runs of such relocations. Writing them in one loop
+		 * avoids setting up a relocation request and dispatching to the relocation procedure for each word.
+		 * 
+		 * @param code Code base of the module.
+		 * @param m Parent module of the relocations.
+		 * @param rels The first relocation of the run.
+		 * @param maxCount Maximum number of relocations to process.
+		 * @return Number of relocations processed. 0 if the first relocation does not start a run.
+		 */
+		static u32 DoOffsetRelocationRun(u8* code, Module* m, Relocation* rels, u32 maxCount);
+
+		/**
+		 * @brief Sorts relocations by their source symbol in place, if they are not sorted already.
+		 * 
+		 * @param rels The relocations to sort.
+		 * @param count Number of elements in 'rels'.
+		 */
+		static void SortRelocationsBySymbol(Relocation* rels, u32 count);
+
+		/**
+		 * @brief Finds the first relocation from a symbol in relocations sorted by SortRelocationsBySymbol.
+		 * 
+		 * @param symbNo Index of the source symbol.
+		 * @param rels The sorted relocations.
+		 * @param count Number of elements in 'rels'.
+		 * @return Index of the first relocation whose source symbol is not below 'symbNo', or 'count' if there is none.
+		 */
+		static u32 LowerBoundRelocationSymbol(u16 symbNo, const Relocation* rels, u32 count);
+
 		/**
 		 * @brief Converts a string to a standard RPM name hash.
 		 * 
@@ -110,6 +147,27 @@ namespace rpm {
 		 */
 		static RPM_NAMEHASH HashName(const char* name);
 
+		/**
+		 * @brief Compile-time variant of HashName, for hashing name literals.
+		 * 
+		 * @param name The string to convert.
+		 * @param hash Hash of the preceding characters.
+		 * @return 32-bit FNV1a hash of the name, equal to HashName(name).
+		 */
+		static constexpr RPM_NAMEHASH HashNameConst(const char* name, RPM_NAMEHASH hash = RPM_HASH_SEED) {
+			return *name ? HashNameConst(name + 1, (hash ^ *name) * 16777619) : hash;
+		}
+
+		/**
+		 * @brief Hashes a block of memory byte by byte, so that the result does not depend on its alignment.
+		 * 
+		 * @param data The memory to hash.
+		 * @param size Size of the memory in bytes.
+		 * @param hash Hash to continue from, or RPM_HASH_SEED to start a new hash.
+		 * @return 32-bit FNV1a-style hash of the memory.
+		 */
+		static u32 HashData(const void* data, size_t size, u32 hash);
+
 		/**
 		 * @brief Searches for a hash in a sorted symbol hash array.
 		 * 
@@ -129,6 +187,12 @@ namespace rpm {
 		 * @return The symbol or nullptr if none found.
 		 */
 		static rpm::Symbol* BinarySearchImportTable(RPM_NAMEHASH key, rpm::Symbol* array, size_t arraySize);
+
+	private:
+		/**
+		 * @brief Moves a relocation down a max-heap ordered by source symbol until both of its children are not above it.
+		 */
+		static void SiftDownRelocation(Relocation* rels, u32 root, u32 count);
 	};
 }
 
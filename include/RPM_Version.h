@@ -13,7 +13,7 @@
 /**
  * @brief Current version of the Relocatable Program Module library and supported binary formats.
  */
-#define LIBRPM_VERSION 13 //libRPM v0.12
+#define LIBRPM_VERSION 15 //libRPM v0.15
 
 /**
  *  === RELOCATABLE PROGRAM MODULE LIBRARY - VERSION HISTORY ===
@@ -36,6 +36,9 @@
  *  - v0.11 : Add BSS support / module expansion, header fields now relative to start of DLXH.
  *  - v0.12 : Export/import symbols are now sorted, allowing for binary search. Global address attribute moved to SymbolAttr.
  *  - v0.13 : Static initializer/finalizer support.
+ *  - v0.14 : Control section links are self-relative offsets (0 = none) and the code segment is referenced relative to the module start.
+ *          : Control sections no longer need to be relocated after loading.
+ *  - v0.15 : Import symbol hashes, bound addresses and exporting modules are additionally stored as parallel arrays in the symbol section.
  */
 
 #endif
\ No newline at end of file
@@ -0,0 +1,259 @@
+#ifndef __RPM_ADDRESSINDEX_CPP
+#define __RPM_ADDRESSINDEX_CPP
+
+#include "RPM_Types.h"
+#include "RPM_Module.h"
+#include "RPM_AddressIndex.h"
+#include "RPM_ModuleManager.h"
+#include "RPM_Util.h"
+#include <cstring>
+
+namespace rpm {
+	namespace mgr {
+		AddressIndex::AddressIndex(ModuleManager* mgr, bool retainStripped) {
+			RPM_ASSERT(mgr);
+			m_Manager = mgr;
+			m_RetainStripped = retainStripped;
+			m_Ranges = nullptr;
+			m_RangeCount = 0;
+			m_RangeCapacity = 0;
+			//Indexing and binding are one write so that no module is loaded in between
+			RPM_SYNC_WRITE_SCOPE(mgr->m_WriteLock);
+			for (rpm::Module* module = mgr->m_LastModule; module; module = module->GetPrevModule()) {
+				AddModule(module);
+			}
+			mgr->BindModuleListener(this);
+		}
+
+		bool AddressIndex::Lookup(const void* address, AddressInfo* info) {
+			RPM_ASSERT(info);
+			//The ranges are only modified with readers held off, see AddModule and RemoveModule
+			RPM_SYNC_READ_SCOPE(m_Manager->m_ReadDomain);
+			const u8* addr = static_cast<const u8*>(address);
+			u32 index = FindRangeIndex(addr);
+			if (!index || addr >= m_Ranges[index - 1].End) {
+				return false;
+			}
+			ModuleRange* range = &m_Ranges[index - 1];
+			memset(info, 0, sizeof(AddressInfo));
+			info->Module = range->Module;
+			info->CodeOffset = addr - range->Start;
+			FunctionEntry* entry = range->Functions ? FindFunction(range->Functions, info->CodeOffset) : nullptr;
+			if (entry && (!entry->Size || info->CodeOffset < entry->Offset + entry->Size)) {
+				info->Function = range->Start + entry->Offset;
+				info->FunctionOffset = info->CodeOffset - entry->Offset;
+				info->NameHash = entry->Hash;
+				if (entry->SymbolIdx != 0xFFFF) {
+					info->Symbol = &range->Module->GetSymbols()->Symbols[entry->SymbolIdx];
+					info->Name = range->Module->GetString(info->Symbol->Name);
+				}
+			}
+			return true;
+		}
+
+		void AddressIndex::OnEvent(rpm::mgr::ModuleManager*, rpm::Module* module, ModuleEvent event) {
+			switch (event) {
+				case LOADED:
+					AddModule(module);
+					break;
+				case FIXED:
+					UpdateModule(module);
+					break;
+				case UNLOADED:
+					RemoveModule(module);
+					break;
+				default:
+					break;
+			}
+		}
+
+		void AddressIndex::AddModule(rpm::Module* module) {
+			if (!module->GetCodeSize()) {
+				return;
+			}
+			ModuleRange* oldRanges = nullptr;
+			ModuleRange* newRanges = nullptr;
+			u32 newCapacity = m_RangeCapacity;
+			if (m_RangeCount == m_RangeCapacity) {
+				newCapacity = m_RangeCapacity ? m_RangeCapacity * 2 : 16;
+				newRanges = static_cast<ModuleRange*>(m_Manager->AllocModuleWorkMemory(newCapacity * sizeof(ModuleRange)));
+				if (!newRanges) {
+					RPM_DEBUG_PRINTF("Could not grow the address index.\n");
+					return;
+				}
+			}
+			//Built before holding off the readers, the table is not reachable until the range is inserted
+			FunctionTable* functions = BuildFunctionTable(module);
+			{
+				RPM_SYNC_EXCLUSIVE_SCOPE(m_Manager->m_ReadDomain);
+				if (newRanges) {
+					if (m_Ranges) {
+						memcpy(newRanges, m_Ranges, m_RangeCount * sizeof(ModuleRange));
+					}
+					oldRanges = m_Ranges;
+					m_Ranges = newRanges;
+					m_RangeCapacity = newCapacity;
+				}
+				u8* start = module->GetCode();
+				u32 index = FindRangeIndex(start);
+				memmove(&m_Ranges[index + 1], &m_Ranges[index], (m_RangeCount - index) * sizeof(ModuleRange));
+				ModuleRange* range = &m_Ranges[index];
+				range->Start = start;
+				range->End = start + module->GetCodeSize();
+				range->Module = module;
+				range->Functions = functions;
+				m_RangeCount++;
+			}
+			if (oldRanges) {
+				m_Manager->FreeModuleWorkMemory(oldRanges);
+			}
+		}
+
+		void AddressIndex::RemoveModule(rpm::Module* module) {
+			ModuleRange* range = FindModuleRange(module);
+			if (!range) {
+				return;
+			}
+			FunctionTable* functions = range->Functions;
+			ModuleRange* oldRanges = nullptr;
+			{
+				RPM_SYNC_EXCLUSIVE_SCOPE(m_Manager->m_ReadDomain);
+				u32 index = range - m_Ranges;
+				m_RangeCount--;
+				memmove(range, range + 1, (m_RangeCount - index) * sizeof(ModuleRange));
+				if (!m_RangeCount) {
+					oldRanges = m_Ranges;
+					m_Ranges = nullptr;
+					m_RangeCapacity = 0;
+				}
+			}
+			//No reader can hold the removed range any more
+			if (functions) {
+				m_Manager->FreeModuleWorkMemory(functions);
+			}
+			if (oldRanges) {
+				m_Manager->FreeModuleWorkMemory(oldRanges);
+			}
+		}
+
+		void AddressIndex::UpdateModule(rpm::Module* module) {
+			ModuleRange* range = FindModuleRange(module);
+			if (!range || !range->Functions) {
+				return;
+			}
+			//FIXED is sent with readers held off, so the table can be updated in place
+			//Stripping local symbols renumbers the rest, so the indices are looked up again by offset
+			MapFunctionSymbols(module, range->Functions);
+			if (!module->GetSymbols() && !m_RetainStripped) {
+				m_Manager->FreeModuleWorkMemory(range->Functions);
+				range->Functions = nullptr;
+			}
+		}
+
+		AddressIndex::FunctionTable* AddressIndex::BuildFunctionTable(rpm::Module* module) {
+			rpm::Module::SymbolSection* symSect = module->GetSymbols();
+			if (!symSect) {
+				return nullptr;
+			}
+			u32 count = 0;
+			for (u32 i = 0; i < symSect->SymbolCount; i++) {
+				count += IsFunctionSymbol(&symSect->Symbols[i]);
+			}
+			if (!count) {
+				return nullptr;
+			}
+			FunctionTable* table = static_cast<FunctionTable*>(m_Manager->AllocModuleWorkMemory(sizeof(FunctionTable) + count * sizeof(FunctionEntry), module));
+			if (!table) {
+				return nullptr;
+			}
+			table->Count = 0;
+			for (u32 i = 0; i < symSect->SymbolCount; i++) {
+				rpm::Symbol* sym = &symSect->Symbols[i];
+				if (!IsFunctionSymbol(sym)) {
+					continue;
+				}
+				FunctionEntry entry;
+				entry.Offset = sym->Addr.RawAddress;
+				entry.Size = sym->Size;
+				entry.SymbolIdx = i;
+				const char* name = module->GetString(sym->Name);
+				entry.Hash = name ? Util::HashName(name) : 0;
+				//Symbol tables are mostly emitted in address order, which keeps this close to linear
+				u32 j = table->Count++;
+				for (; j > 0 && table->Entries[j - 1].Offset > entry.Offset; j--) {
+					table->Entries[j] = table->Entries[j - 1];
+				}
+				table->Entries[j] = entry;
+			}
+			return table;
+		}
+
+		void AddressIndex::MapFunctionSymbols(rpm::Module* module, FunctionTable* table) {
+			for (u32 i = 0; i < table->Count; i++) {
+				table->Entries[i].SymbolIdx = 0xFFFF;
+			}
+			rpm::Module::SymbolSection* symSect = module->GetSymbols();
+			if (!symSect) {
+				return;
+			}
+			for (u32 i = 0; i < symSect->SymbolCount; i++) {
+				rpm::Symbol* sym = &symSect->Symbols[i];
+				if (!IsFunctionSymbol(sym)) {
+					continue;
+				}
+				FunctionEntry* entry = FindFunction(table, sym->Addr.RawAddress);
+				//Aliases share an offset, the first one to be found is kept
+				if (entry && entry->Offset == sym->Addr.RawAddress && entry->SymbolIdx == 0xFFFF) {
+					entry->SymbolIdx = i;
+				}
+			}
+		}
+
+		//Both searches halve the range with a conditional move instead of a branch, since sampled addresses are unpredictable
+
+		AddressIndex::FunctionEntry* AddressIndex::FindFunction(FunctionTable* table, u32 offset) {
+			FunctionEntry* base = table->Entries;
+			u32 count = table->Count;
+			if (!count || base->Offset > offset) {
+				return nullptr;
+			}
+			while (count > 1) {
+				u32 half = count >> 1;
+				base = base[half].Offset <= offset ? base + half : base;
+				count -= half;
+			}
+			return base;
+		}
+
+		u32 AddressIndex::FindRangeIndex(const u8* address) {
+			u32 count = m_RangeCount;
+			if (!count || m_Ranges[0].Start > address) {
+				return 0;
+			}
+			ModuleRange* base = m_Ranges;
+			while (count > 1) {
+				u32 half = count >> 1;
+				base = base[half].Start <= address ? base + half : base;
+				count -= half;
+			}
+			return base - m_Ranges + 1;
+		}
+
+		AddressIndex::ModuleRange* AddressIndex::FindModuleRange(rpm::Module* module) {
+			u32 index = FindRangeIndex(module->GetCode());
+			if (index && m_Ranges[index - 1].Module == module) {
+				return &m_Ranges[index - 1];
+			}
+			return nullptr;
+		}
+
+		bool AddressIndex::IsFunctionSymbol(rpm::Symbol* sym) {
+			if (sym->Attr & (RPM_SYMATTR_IMPORT | RPM_SYMATTR_GLOBAL)) {
+				return false;
+			}
+			return sym->Type == RPM_SYMTYPE_FUNCTION_ARM || sym->Type == RPM_SYMTYPE_FUNCTION_THM;
+		}
+	}
+}
+
+#endif
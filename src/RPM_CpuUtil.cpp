@@ -9,7 +9,7 @@
 namespace rpm {
 	namespace cpu {
 		void CpuUtil::Reloc_OFFSET(CpuRelRequest* req) {
-			Write32(req->Source, reinterpret_cast<u32>(req->Target));
+			Write32(req->Source, static_cast<u32>(reinterpret_cast<size_t>(req->Target)));
 		}
 
 		void CpuUtil::Reloc_THUMB_BL(CpuRelRequest* req) {
@@ -106,7 +106,7 @@ namespace rpm {
 			StreamWrite16(&req->Source, THUMB_BX(12));
 
 			req->Source = prospectedLDRPtr;
-			StreamWrite32(&req->Source, reinterpret_cast<u32>(req->Target));
+			StreamWrite32(&req->Source, static_cast<u32>(reinterpret_cast<size_t>(req->Target)));
 		}
 
 		void CpuUtil::Reloc_OFFSET_REL31(CpuRelRequest* req) {
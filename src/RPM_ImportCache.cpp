@@ -0,0 +1,189 @@
+#ifndef __RPM_IMPORTCACHE_CPP
+#define __RPM_IMPORTCACHE_CPP
+
+#include "RPM_Types.h"
+#include "RPM_Module.h"
+#include "RPM_ImportCache.h"
+#include "RPM_ModuleManager.h"
+#include "RPM_Util.h"
+#include "RPM_Version.h"
+#include <cstring>
+
+namespace rpm {
+	namespace mgr {
+		ImportCache::ImportCache(void* storage, size_t storageSize) {
+			RPM_ASSERT(storage);
+			RPM_ASSERT(storageSize >= sizeof(Header));
+			m_Data = static_cast<Header*>(storage);
+			m_Capacity = (storageSize - sizeof(Header)) / sizeof(Entry);
+			if (m_Data->Magic != IMPORTCACHE_MAGIC || m_Data->Version != LIBRPM_VERSION || m_Data->EntryCount > m_Capacity) {
+				RPM_DEBUG_PRINTF("Import cache invalid, starting empty.\n");
+				Clear();
+			}
+			m_Dirty = false;
+			m_Full = false;
+			memset(m_Modules, 0, sizeof(m_Modules));
+			m_UntrackedCount = 0;
+		}
+
+		void ImportCache::Clear() {
+			m_Data->Magic = IMPORTCACHE_MAGIC;
+			m_Data->Version = LIBRPM_VERSION;
+			m_Data->EntryCount = 0;
+			m_Dirty = true;
+			m_Full = false;
+		}
+
+		u32 ImportCache::CalcModuleId(rpm::Module* module) {
+			u32 hash = Util::HashData(module->GetCode(), module->GetCodeSize(), RPM_HASH_SEED);
+			rpm::Module::SymbolSection* symSect = module->GetSymbols();
+			if (symSect) {
+				hash = Util::HashData(symSect->Symbols, symSect->SymbolCount * sizeof(Symbol), hash);
+				if (symSect->ExportSymbolHashTable) {
+					hash = Util::HashData(symSect->ExportSymbolHashTable, symSect->ExportSymbolCount * sizeof(RPM_NAMEHASH), hash);
+				}
+			}
+			return hash ? hash : 1; //0 is reserved for unknown modules
+		}
+
+		u32 ImportCache::GetModuleId(rpm::Module* module) {
+			for (u32 i = 0; i < RPM_IMPORTCACHE_MAX_MODULES; i++) {
+				if (m_Modules[i].Module == module) {
+					return m_Modules[i].Id;
+				}
+			}
+			return 0;
+		}
+
+		void ImportCache::SetModuleId(rpm::Module* module, u32 id) {
+			RPM_ASSERT(module);
+			ModuleId* slot = nullptr;
+			for (u32 i = 0; i < RPM_IMPORTCACHE_MAX_MODULES; i++) {
+				if (m_Modules[i].Module == module) {
+					slot = &m_Modules[i];
+					break;
+				}
+				if (!slot && !m_Modules[i].Module) {
+					slot = &m_Modules[i];
+				}
+			}
+			if (!slot) {
+				RPM_DEBUG_PRINTF("Import cache is tracking %d modules already, module %p is not cached.\n", RPM_IMPORTCACHE_MAX_MODULES, module);
+				m_UntrackedCount++;
+				return;
+			}
+			slot->Module = module;
+			slot->Id = id;
+		}
+
+		rpm::Module* ImportCache::FindModuleById(u32 id) {
+			for (u32 i = 0; i < RPM_IMPORTCACHE_MAX_MODULES; i++) {
+				if (m_Modules[i].Id == id) {
+					return m_Modules[i].Module;
+				}
+			}
+			return nullptr;
+		}
+
+		void ImportCache::OnEvent(rpm::mgr::ModuleManager*, rpm::Module* module, ModuleEvent event) {
+			switch (event) {
+				case LOADED:
+					//Only the unrelocated image matches the module file, relocated images get their identity through SetModuleId
+					if (!module->IsCodeRelocated()) {
+						SetModuleId(module, CalcModuleId(module));
+					}
+					break;
+				case UNLOADED:
+					for (u32 i = 0; i < RPM_IMPORTCACHE_MAX_MODULES; i++) {
+						if (m_Modules[i].Module == module) {
+							m_Modules[i].Module = nullptr;
+							m_Modules[i].Id = 0;
+							break;
+						}
+					}
+					break;
+				default:
+					break;
+			}
+		}
+
+		u32 ImportCache::LowerBound(u32 importerId, u16 symIndex) {
+			u32 start = 0;
+			u32 end = m_Data->EntryCount;
+			while (start < end) {
+				u32 mid = start + ((end - start) >> 1);
+				Entry* e = &m_Data->Entries[mid];
+				if (e->ImporterId < importerId || (e->ImporterId == importerId && e->SymbolIdx < symIndex)) {
+					start = mid + 1;
+				}
+				else {
+					end = mid;
+				}
+			}
+			return start;
+		}
+
+		u32 ImportCache::BindCachedImports(rpm::mgr::ModuleManager* mgr, rpm::Module* importer) {
+			u32 id = GetModuleId(importer);
+			if (!id) {
+				return 0;
+			}
+			u32 count = m_Data->EntryCount;
+			u32 bound = 0;
+			rpm::Module* exporter = nullptr;
+			u32 exporterId = 0;
+			for (u32 i = LowerBound(id, 0); i < count; i++) {
+				Entry* e = &m_Data->Entries[i];
+				if (e->ImporterId != id) {
+					break;
+				}
+				if (e->ExporterId != exporterId) {
+					exporterId = e->ExporterId;
+					exporter = FindModuleById(exporterId);
+				}
+				if (exporter && exporter != importer && importer->ImportSymbol(e->SymbolIdx, exporter, e->ExportIdx)) {
+					mgr->AddModuleDependency(exporter, importer);
+					if (exporter->IsStartDeferred() && !importer->IsStartDeferred()) {
+						mgr->ActivateModule(exporter);
+					}
+					bound++;
+				}
+			}
+			RPM_DEBUG_PRINTF("Bound %d cached imports.\n", bound);
+			return bound;
+		}
+
+		void ImportCache::OnImport(rpm::Module* importer, u16 symIndex, rpm::Module* exporter, u16 exportIndex) {
+			u32 importerId = GetModuleId(importer);
+			u32 exporterId = GetModuleId(exporter);
+			if (!importerId || !exporterId) {
+				return;
+			}
+			u32 pos = LowerBound(importerId, symIndex);
+			Entry* e = &m_Data->Entries[pos];
+			if (pos < m_Data->EntryCount && e->ImporterId == importerId && e->SymbolIdx == symIndex) {
+				if (e->ExporterId == exporterId && e->ExportIdx == exportIndex) {
+					return;
+				}
+			}
+			else {
+				if (m_Data->EntryCount == m_Capacity) {
+					if (!m_Full) {
+						RPM_DEBUG_PRINTF("Import cache is full, further imports are not cached.\n");
+						m_Full = true;
+					}
+					return;
+				}
+				memmove(e + 1, e, (m_Data->EntryCount - pos) * sizeof(Entry));
+				m_Data->EntryCount++;
+				e->ImporterId = importerId;
+				e->SymbolIdx = symIndex;
+			}
+			e->ExporterId = exporterId;
+			e->ExportIdx = exportIndex;
+			m_Dirty = true;
+		}
+	}
+}
+
+#endif
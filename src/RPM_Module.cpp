@@ -9,26 +9,67 @@
 #include "RPM_DllApi.h"
 #include "RPM_ModuleFixLevel.h"
 #include "RPM_ModuleInit.h"
+#include "RPM_ImportObserver.h"
 #include "Util/exl_StrEq.h"
 #include <cstring>
 
 namespace rpm {
 	Module* Module::InitModule(rpm::init::ModuleAllocation alloc) {
+		return InitModule(alloc, nullptr, rpm::init::RPM_LOADFLAG_NONE);
+	}
+
+	Module* Module::InitModule(rpm::init::ModuleAllocation alloc, const rpm::init::ModuleLayout* layout, rpm::init::LoadFlags flags) {
 		RPM_ASSERT(alloc);
 		Module* module = reinterpret_cast<Module*>(alloc);
-		module->Expand();
-		module->RelocateControl();
+		module->Expand(layout, flags);
 		module->Prepare();
 		return module;
 	}
 
+	bool Module::QueryModuleLayout(const void* headerBytes, size_t headerSize, size_t fileSize, rpm::init::ModuleLayout* layout) {
+		RPM_ASSERT(layout);
+		if (!headerBytes || headerSize < sizeof(Module)) {
+			return false;
+		}
+		const Module* raw = static_cast<const Module*>(headerBytes);
+		size_t execOffset = reinterpret_cast<size_t>(raw->m_Exec);
+		if (raw->m_Magic != RPM_MAGIC || execOffset < sizeof(Module) || execOffset + sizeof(DllExec) > fileSize || raw->m_Size < fileSize) {
+			return false;
+		}
+		size_t bssSize = raw->m_Size - fileSize;
+		if (headerSize >= execOffset + sizeof(DllExec)) {
+			const DllExec* exec = reinterpret_cast<const DllExec*>(static_cast<const u8*>(headerBytes) + execOffset);
+			if (exec->Magic != DLLEXEC_MAGIC || exec->BSSSize != bssSize) {
+				return false;
+			}
+		}
+		layout->AllocSize = raw->m_Size;
+		layout->Alignment = RPM_MODULE_ALIGNMENT;
+		layout->FileSize = fileSize;
+		layout->BSSOffset = execOffset;
+		layout->BSSSize = bssSize;
+		layout->HeaderOffset = execOffset + bssSize;
+		return true;
+	}
+
+	size_t Module::CalcSplitImageSize(rpm::init::ModuleAllocation alloc) {
+		RPM_ASSERT(alloc);
+		Module* raw = reinterpret_cast<Module*>(alloc);
+		size_t prologSize = reinterpret_cast<size_t>(raw->m_Exec);
+		DllExec* exec = reinterpret_cast<DllExec*>(reinterpret_cast<u8*>(raw) + prologSize);
+		return CalcSplitExecOffset(prologSize, exec->BSSSize) + sizeof(SplitExec);
+	}
+
 	size_t Module::CalcFixedSize(rpm::FixLevel fixLevel) {
+		if (IsControlSplit()) {
+			return -1; //the persistent image can not be trimmed, see ModuleManager::ReleaseModuleControl
+		}
 		size_t newModuleSize = m_Size;
-		if (fixLevel >= rpm::FixLevel::ALL_NONCODE) {
+		if (fixLevel == rpm::FixLevel::ALL_NONCODE) {
 			//newModuleSize = (GetCode() + GetCodeSize()) - reinterpret_cast<u8*>(this);
-			newModuleSize = reinterpret_cast<u8*>(&m_Exec->Info) + sizeof(InfoSection) - reinterpret_cast<u8*>(this); //end of the info section
+			newModuleSize = reinterpret_cast<u8*>(m_Exec->Info.Get()) + sizeof(InfoSection) - reinterpret_cast<u8*>(this); //end of the info section
 		}
-		else if (fixLevel >= rpm::FixLevel::INTERNAL_RELOCATIONS) {
+		else if (fixLevel == rpm::FixLevel::INTERNAL_RELOCATIONS) {
 			RelocationSection* relSection = GetRelocations();
 			if (relSection) {
 				RelocationList* internals = relSection->InternalRelocations;
@@ -44,6 +85,268 @@ namespace rpm {
 		return -1;
 	}
 
+	u32 Module::CollectControlSections(ControlSectionRef* refs, u8* stringsEnd) {
+		InfoSection* info = m_Exec->Info;
+		u32 count = 0;
+		#define RPM_ADD_CONTROL_SECTION(ptr, size, kind) \
+			if (ptr) { \
+				refs[count].Slot = reinterpret_cast<RelPtr<u8>*>(&(ptr)); \
+				refs[count].Start = refs[count].Slot->Get(); \
+				refs[count].Size = (size); \
+				refs[count].Kind = (kind); \
+				count++; \
+			}
+
+		if (!IsControlSplit()) {
+			RPM_ADD_CONTROL_SECTION(m_Exec->Info, sizeof(InfoSection), CTRLSECT_INFO);
+		}
+		SymbolSection* symSect = info->Symbols;
+		RPM_ADD_CONTROL_SECTION(info->Symbols, sizeof(SymbolSection) + symSect->SymbolCount * sizeof(Symbol), CTRLSECT_SYMBOLS);
+		if (symSect) {
+			RPM_ADD_CONTROL_SECTION(symSect->ExternModules, sizeof(ModuleNameList) + symSect->ExternModules->Count * sizeof(RPM_NAMEOFS), CTRLSECT_SYMBOLS);
+			RPM_ADD_CONTROL_SECTION(symSect->ExportSymbolHashTable, symSect->ExportSymbolCount * sizeof(RPM_NAMEHASH), CTRLSECT_EXPORT_HASHES);
+			RPM_ADD_CONTROL_SECTION(symSect->ImportSymbolHashTable, symSect->ImportSymbolCount * sizeof(RPM_NAMEHASH), CTRLSECT_SYMBOLS);
+			RPM_ADD_CONTROL_SECTION(symSect->ImportAddressTable, symSect->ImportSymbolCount * sizeof(u32), CTRLSECT_SYMBOLS);
+			RPM_ADD_CONTROL_SECTION(symSect->ImportModuleTable, symSect->ImportSymbolCount * sizeof(u32), CTRLSECT_SYMBOLS);
+		}
+		RelocationSection* rels = info->Relocations;
+		RPM_ADD_CONTROL_SECTION(info->Relocations, sizeof(RelocationSection), CTRLSECT_RELOCATIONS);
+		if (rels) {
+			RPM_ADD_CONTROL_SECTION(rels->InternalRelocations, sizeof(RelocationList) + rels->InternalRelocations->Count * sizeof(Relocation), CTRLSECT_RELOCATIONS);
+			RPM_ADD_CONTROL_SECTION(rels->InternalImportRelocations, sizeof(RelocationList) + rels->InternalImportRelocations->Count * sizeof(Relocation), CTRLSECT_RELOCATIONS);
+			RPM_ADD_CONTROL_SECTION(rels->ExternalRelocations, sizeof(RelocationList) + rels->ExternalRelocations->Count * sizeof(Relocation), CTRLSECT_RELOCATIONS);
+			RPM_ADD_CONTROL_SECTION(rels->ExternModules, sizeof(ModuleNameList) + rels->ExternModules->Count * sizeof(RPM_NAMEOFS), CTRLSECT_RELOCATIONS);
+		}
+		RPM_ADD_CONTROL_SECTION(info->Strings, stringsEnd - reinterpret_cast<u8*>(info->Strings.Get()), CTRLSECT_STRINGS);
+		RPM_ADD_CONTROL_SECTION(info->MetaValueSection, sizeof(MetaDataSection) + info->MetaValueSection->MetaValues.ValueCount * sizeof(MetaValue), CTRLSECT_METADATA);
+		RPM_ADD_CONTROL_SECTION(info->StaticInitializers, sizeof(FuncArrayList) + info->StaticInitializers->Count * sizeof(u16), CTRLSECT_FUNC_ARRAYS);
+		RPM_ADD_CONTROL_SECTION(info->StaticDestructors, sizeof(FuncArrayList) + info->StaticDestructors->Count * sizeof(u16), CTRLSECT_FUNC_ARRAYS);
+
+		#undef RPM_ADD_CONTROL_SECTION
+		RPM_ASSERT(count <= RPM_MAX_CONTROL_SECTIONS);
+		return count;
+	}
+
+	u8* Module::GetControlEnd() {
+		return reinterpret_cast<u8*>(this) + m_Size;
+	}
+
+	u8* Module::CalcStringsEnd(ControlSectionRef* refs) {
+		u8* strings = reinterpret_cast<u8*>(m_Exec->Info->Strings.Get());
+		if (IsControlSplit()) {
+			return strings + GetSplitExec()->StringsSize;
+		}
+		u8* end = GetControlEnd();
+		if (strings) {
+			u32 count = CollectControlSections(refs, end);
+			for (u32 i = 0; i < count; i++) {
+				if (refs[i].Start > strings && refs[i].Start < end) {
+					end = refs[i].Start;
+				}
+			}
+		}
+		return end;
+	}
+
+	void Module::DropLocalSymbols() {
+		SymbolSection* symSect = GetSymbols();
+		if (!symSect) {
+			return;
+		}
+		InfoSection* info = m_Exec->Info;
+		FuncArrayList* funcLists[] = { info->StaticInitializers, info->StaticDestructors };
+		u32 exportStart = symSect->FirstExportSymbolIdx;
+		u32 exportEnd = symSect->ExportSymbolHashTable ? exportStart + symSect->ExportSymbolCount : exportStart;
+		u32 newExportStart = 0;
+		u32 count = 0;
+		//Symbols only move towards the start of the table, so the table can be compacted in place
+		for (u32 i = 0; i < symSect->SymbolCount; i++) {
+			bool keep = i >= exportStart && i < exportEnd;
+			for (u32 l = 0; l < NELEMS(funcLists); l++) {
+				FuncArrayList* list = funcLists[l];
+				if (list) {
+					for (u32 j = 0; j < list->Count; j++) {
+						if (list->SymbolIndices[j] == i) {
+							list->SymbolIndices[j] = count;
+							keep = true;
+						}
+					}
+				}
+			}
+			if (keep) {
+				if (i == exportStart) {
+					newExportStart = count;
+				}
+				symSect->Symbols[count++] = symSect->Symbols[i];
+			}
+		}
+		RPM_DEBUG_PRINTF("Dropped %d local symbols.\n", symSect->SymbolCount - count);
+		symSect->SymbolCount = count;
+		symSect->FirstExportSymbolIdx = newExportStart;
+		symSect->FirstImportSymbolIdx = 0xFFFF;
+		symSect->ImportSymbolCount = 0;
+		symSect->ImportSymbolHashTable = nullptr;
+		symSect->ImportAddressTable = nullptr;
+		symSect->ImportModuleTable = nullptr;
+		SetReserveFlag(RPM_RSVFLAG_ALL_IMPORTED);
+	}
+
+	void Module::StripControlSections(rpm::FixMask mask) {
+		InfoSection* info = m_Exec->Info;
+		if (mask & RPM_FIXMASK_LOCAL_SYMBOLS) {
+			mask |= RPM_FIXMASK_ALL_RELOCATIONS; //relocations refer to symbols by index
+			DropLocalSymbols();
+		}
+		RelocationSection* rels = info->Relocations;
+		if (rels) {
+			if (mask & RPM_FIXMASK_INTERNAL_RELOCATIONS) {
+				rels->InternalRelocations = nullptr;
+			}
+			if (mask & RPM_FIXMASK_IMPORT_RELOCATIONS) {
+				rels->InternalImportRelocations = nullptr;
+			}
+			if (mask & RPM_FIXMASK_EXTERNAL_RELOCATIONS) {
+				rels->ExternalRelocations = nullptr;
+			}
+			if (!rels->InternalRelocations && !rels->InternalImportRelocations && !rels->ExternalRelocations) {
+				info->Relocations = nullptr;
+			}
+		}
+		if (mask & RPM_FIXMASK_STRINGS) {
+			info->Strings = nullptr;
+			//The extern module lists consist of names only
+			if (info->Symbols) {
+				info->Symbols->ExternModules = nullptr;
+			}
+			if (info->Relocations) {
+				info->Relocations->ExternModules = nullptr;
+			}
+		}
+		if (mask & RPM_FIXMASK_METADATA) {
+			info->MetaValueSection = nullptr;
+		}
+	}
+
+	void Module::SortControlSections(ControlSectionRef* refs, u32 count) {
+		//An empty section can start where the next one does, so the larger of two sections at the same address is the one moved
+		for (u32 i = 1; i < count; i++) {
+			ControlSectionRef ref = refs[i];
+			u32 j = i;
+			for (; j > 0 && (refs[j - 1].Start > ref.Start || (refs[j - 1].Start == ref.Start && refs[j - 1].Size < ref.Size)); j--) {
+				refs[j] = refs[j - 1];
+			}
+			refs[j] = ref;
+		}
+	}
+
+	void Module::RelinkControlSections(ControlSectionRef* refs, u32 count) {
+		//The references themselves may live in moved sections
+		for (u32 i = 0; i < count; i++) {
+			u8* slot = reinterpret_cast<u8*>(refs[i].Slot);
+			if (!slot) {
+				continue;
+			}
+			for (u32 j = 0; j < count; j++) {
+				if (slot >= refs[j].Start && slot < refs[j].Start + refs[j].Size) {
+					slot += refs[j].NewStart - refs[j].Start;
+					break;
+				}
+			}
+			reinterpret_cast<RelPtr<u8>*>(slot)->Set(refs[i].NewStart);
+		}
+	}
+
+	size_t Module::CompactControl(rpm::FixMask mask) {
+		RPM_ASSERT(!IsControlSplit());
+		u8* base = reinterpret_cast<u8*>(this);
+		u8* cursor = reinterpret_cast<u8*>(m_Exec) + sizeof(DllExec);
+		ControlSectionRef refs[RPM_MAX_CONTROL_SECTIONS];
+
+		//The end of the strings has to be determined before any section is stripped
+		u8* stringsEnd = CalcStringsEnd(refs);
+		StripControlSections(mask);
+
+		u32 count = CollectControlSections(refs, stringsEnd);
+		//Sort by address so that every section is moved towards the start without overwriting the ones after it
+		SortControlSections(refs, count);
+		for (u32 i = 0; i < count; i++) {
+			ControlSectionRef* ref = &refs[i];
+			if (i && ref->Start == refs[i - 1].Start) {
+				ref->NewStart = refs[i - 1].NewStart; //shared between two references
+				continue;
+			}
+			//Keep the section's 4-byte alignment. This never moves it past its old start, which is where the next section may begin.
+			RPM_ASSERT(cursor <= ref->Start);
+			cursor += (ref->Start - cursor) & 3;
+			ref->NewStart = cursor;
+			memmove(cursor, ref->Start, ref->Size);
+			cursor += ref->Size;
+		}
+		RelinkControlSections(refs, count);
+		RPM_DEBUG_PRINTF("Compacted control sections to %tx bytes.\n", cursor - base);
+		return cursor - base;
+	}
+
+	void Module::InitSplitControl(ControlSectionRef* refs, u32 count, size_t controlSize) {
+		size_t splitOffset = CalcSplitExecOffset(reinterpret_cast<u8*>(m_Exec) - reinterpret_cast<u8*>(this), 0);
+		SplitExec* split = reinterpret_cast<SplitExec*>(reinterpret_cast<u8*>(this) + splitOffset);
+		InfoSection* info = m_Exec->Info;
+		//The new header may overlap the old one, so both are copied out first. Their links are set again below.
+		u8 execBytes[sizeof(DllExec)];
+		u8 infoBytes[sizeof(InfoSection)];
+		memcpy(execBytes, static_cast<void*>(m_Exec), sizeof(DllExec));
+		memcpy(infoBytes, static_cast<void*>(info), sizeof(InfoSection));
+		memcpy(static_cast<void*>(&split->Exec), execBytes, sizeof(DllExec));
+		memcpy(static_cast<void*>(&split->Info), infoBytes, sizeof(InfoSection));
+		split->Exec.Info = &split->Info;
+		split->Exec.HeaderSectionSize = sizeof(SplitExec);
+		split->ControlSize = controlSize;
+		split->StringsSize = 0;
+
+		u32 infoIndex = count;
+		for (u32 i = 0; i < count; i++) {
+			if (refs[i].Kind == CTRLSECT_INFO) {
+				refs[i].NewStart = reinterpret_cast<u8*>(&split->Info);
+				infoIndex = i;
+			}
+			else if (refs[i].Kind == CTRLSECT_STRINGS) {
+				split->StringsSize = refs[i].Size;
+			}
+		}
+		//The info section's own reference was in the old DllExec, which may now be overwritten, and has been set above
+		if (infoIndex < count) {
+			refs[infoIndex].Slot = nullptr;
+		}
+		RelinkControlSections(refs, count);
+
+		m_Exec = &split->Exec;
+		m_Size = splitOffset + sizeof(SplitExec);
+		SetReserveFlag(RPM_RSVFLAG_CONTROL_SPLIT);
+	}
+
+	u32 Module::StripSplitControl(rpm::FixMask mask, ControlSectionRef* released) {
+		ControlSectionRef refs[RPM_MAX_CONTROL_SECTIONS];
+		ControlSectionRef kept[RPM_MAX_CONTROL_SECTIONS];
+		u32 count = CollectControlSections(refs, CalcStringsEnd(refs));
+		StripControlSections(mask);
+		u32 keptCount = CollectControlSections(kept, CalcStringsEnd(kept));
+		//Every block starts with the section it was allocated for, and only sections at that same address share it
+		u32 releasedCount = 0;
+		for (u32 i = 0; i < count; i++) {
+			bool referenced = false;
+			for (u32 j = 0; j < keptCount; j++) {
+				referenced |= kept[j].Start == refs[i].Start;
+			}
+			for (u32 j = 0; j < releasedCount; j++) {
+				referenced |= released[j].Start == refs[i].Start;
+			}
+			if (!referenced) {
+				released[releasedCount++] = refs[i];
+			}
+		}
+		return releasedCount;
+	}
+
 	const char* Module::GetString(RPM_NAMEOFS offs) {
 		if (m_Exec) {
 			if (m_Exec->Info) {
@@ -59,10 +362,10 @@ namespace rpm {
 		SetReserveFlag(RPM_RSVFLAG_MODULE_LINK_READY);
 	}
 
-	bool Module::LinkWithModule(Module* other) {
+	bool Module::LinkWithModule(Module* other, rpm::mgr::ImportObserver* observer) {
 		RPM_ASSERT(other);
-		this->ImportModule(other);
-		return other->ImportModule(this) != 0;
+		this->ImportModule(other, observer);
+		return other->ImportModule(this, observer) != 0;
 	}
 
 	void Module::UnlinkFromModule(Module* other) {
@@ -70,7 +373,7 @@ namespace rpm {
 		other->UnimportModule(this);
 	}
 
-	u32 Module::ImportModule(Module* other) {
+	u32 Module::ImportModule(Module* other, rpm::mgr::ImportObserver* observer) {
 		if (GetReserveFlag(RPM_RSVFLAG_ALL_IMPORTED) || !GetReserveFlag(RPM_RSVFLAG_MODULE_LINK_READY)) {
 			return 0;
 		}
@@ -82,45 +385,64 @@ namespace rpm {
 			u32 firstImportSymbolIdx = symSect->FirstImportSymbolIdx;
 			u32 importSymbolCount = symSect->ImportSymbolCount;
 			u32 otherExportSymbolCount = otherSymSect->ExportSymbolCount;
-			u8* otherCode = other->GetCode();
 			RPM_NAMEHASH* exportHashArr = otherSymSect->ExportSymbolHashTable;
 
 			RPM_DEBUG_PRINTF("Linking module, import symbol ct %d other export symbol ct %d first import symbol index %d\n", importSymbolCount, otherExportSymbolCount, firstImportSymbolIdx);
 			
 			if (importSymbolCount && otherExportSymbolCount && firstImportSymbolIdx != 0xFFFF) {
-				Symbol* sym = &symSect->Symbols[firstImportSymbolIdx];
-				Symbol* extSym;
-				bool existAnyImportSymbol = false;
-				u32 importSymbolEnd = firstImportSymbolIdx + importSymbolCount;
-				for (u32 importSymbolIndex = firstImportSymbolIdx; importSymbolIndex < importSymbolEnd; importSymbolIndex++, sym++) {
-					if (sym->Attr & SymbolAttr::RPM_SYMATTR_IMPORT) {
-						RPM_NAMEHASH hash = sym->Addr.ImportHash;
-						u32 index = Util::BinarySearchExportTable(hash, exportHashArr, otherExportSymbolCount);
-						if (index != -1) {
-							//Hashes matched
-							extSym = &otherSymSect->Symbols[otherSymSect->FirstExportSymbolIdx + index];
-							if (!(extSym->Attr & SymbolAttr::RPM_SYMATTR_IMPORT)) {
-								RPM_DEBUG_PRINTF("Linking symbol %s (hash %x).\n", GetString(sym->Name), hash);
-								sym->Attr |= RPM_SYMATTR_GLOBAL; //always global offset
-								if (!(extSym->Attr & RPM_SYMATTR_GLOBAL)) {
-									sym->Addr.RawAddress = reinterpret_cast<u32>(otherCode + extSym->Addr.RawAddress);
-								}
-								else {
-									sym->Addr.RawAddress = extSym->Addr.RawAddress;
-								}
-								sym->Type = extSym->Type;
-
-								sym->Attr &= ~SymbolAttr::RPM_SYMATTR_IMPORT;
-								RelocateByImportSymbol(importSymbolIndex);
-								totalImportedCount++;
-							}
+				//Both the pending imports and the export hash table are sorted by hash, so they are merged in a single pass
+				Symbol* imports = &symSect->Symbols[firstImportSymbolIdx];
+				RPM_NAMEHASH* importHashArr = symSect->ImportSymbolHashTable;
+				Symbol* lastPending = nullptr;
+				u16 pendingHead = RPM_IMPORT_WORKLIST_END;
+				u32 exportIndex = 0;
+				u16 next;
+				if (GetImportWorklistHead() == RPM_IMPORT_WORKLIST_STALE) {
+					BuildImportWorklist();
+				}
+				for (u16 i = GetImportWorklistHead(); i != RPM_IMPORT_WORKLIST_END; i = next) {
+					Symbol* sym = &imports[i];
+					next = sym->Size;
+					RPM_NAMEHASH hash = importHashArr[i];
+					u32 index = -1;
+					if ((sym->Attr & SymbolAttr::RPM_SYMATTR_ORDINAL) && sym->ExportOrdinal < otherExportSymbolCount && exportHashArr[sym->ExportOrdinal] == hash) {
+						index = sym->ExportOrdinal;
+					}
+					else {
+						while (exportIndex < otherExportSymbolCount && exportHashArr[exportIndex] < hash) {
+							exportIndex++;
 						}
-						else {
-							existAnyImportSymbol = true; //there are still symbols yet to be imported
+						if (exportIndex < otherExportSymbolCount && exportHashArr[exportIndex] == hash) {
+							index = exportIndex;
+						}
+					}
+					if (index != -1) {
+						//Hashes matched
+						Symbol* extSym = &otherSymSect->Symbols[otherSymSect->FirstExportSymbolIdx + index];
+						if (!(extSym->Attr & SymbolAttr::RPM_SYMATTR_IMPORT)) {
+							RPM_DEBUG_PRINTF("Linking symbol %s (hash %x).\n", GetString(sym->Name), hash);
+							BindImport(firstImportSymbolIdx + i, other, extSym);
+							if (observer) {
+								observer->OnImport(this, firstImportSymbolIdx + i, other, index);
+							}
+							totalImportedCount++;
+							continue;
 						}
 					}
+					//Still pending, keep it in the worklist
+					if (lastPending) {
+						lastPending->Size = i;
+					}
+					else {
+						pendingHead = i;
+					}
+					lastPending = sym;
+				}
+				if (lastPending) {
+					lastPending->Size = RPM_IMPORT_WORKLIST_END;
 				}
-				if (!existAnyImportSymbol) {
+				SetImportWorklistHead(pendingHead);
+				if (pendingHead == RPM_IMPORT_WORKLIST_END) {
 					SetReserveFlag(RPM_RSVFLAG_ALL_IMPORTED);
 				}
 			}
@@ -129,33 +451,164 @@ namespace rpm {
 		return totalImportedCount;
 	}
 
-	void Module::UnimportModule(Module* other) {
+	void Module::BuildImportWorklist() {
+		SymbolSection* symSect = GetSymbols();
+		u16 head = RPM_IMPORT_WORKLIST_END;
+		if (symSect && symSect->ImportSymbolCount && symSect->FirstImportSymbolIdx != 0xFFFF) {
+			Symbol* imports = &symSect->Symbols[symSect->FirstImportSymbolIdx];
+			//Linked back to front so that the list stays in hash order
+			for (u32 i = symSect->ImportSymbolCount; i > 0; i--) {
+				Symbol* sym = &imports[i - 1];
+				if (sym->Attr & SymbolAttr::RPM_SYMATTR_IMPORT) {
+					sym->Size = head;
+					head = i - 1;
+				}
+			}
+		}
+		SetImportWorklistHead(head);
+	}
+
+	bool Module::ImportSymbol(u16 symIndex, Module* other, u16 exportIndex) {
+		SymbolSection* symSect = GetSymbols();
+		SymbolSection* otherSymSect = other->GetSymbols();
+		if (!symSect || !otherSymSect || !otherSymSect->ExportSymbolHashTable) {
+			return false;
+		}
+		if (symIndex < symSect->FirstImportSymbolIdx || symIndex >= symSect->FirstImportSymbolIdx + symSect->ImportSymbolCount || exportIndex >= otherSymSect->ExportSymbolCount) {
+			return false;
+		}
+		Symbol* sym = &symSect->Symbols[symIndex];
+		Symbol* extSym = &otherSymSect->Symbols[otherSymSect->FirstExportSymbolIdx + exportIndex];
+		if (!(sym->Attr & SymbolAttr::RPM_SYMATTR_IMPORT) || (extSym->Attr & SymbolAttr::RPM_SYMATTR_IMPORT)) {
+			return false;
+		}
+		if (otherSymSect->ExportSymbolHashTable[exportIndex] != symSect->ImportSymbolHashTable[symIndex - symSect->FirstImportSymbolIdx]) {
+			return false;
+		}
+		BindImport(symIndex, other, extSym);
+		//The bound symbol no longer links to the next pending one
+		SetImportWorklistHead(RPM_IMPORT_WORKLIST_STALE);
+		return true;
+	}
+
+	u32 Module::CalcImportAddress(Module* other, Symbol* extSym) {
+		if (!(extSym->Attr & RPM_SYMATTR_GLOBAL)) {
+			return static_cast<u32>(reinterpret_cast<size_t>(other->GetCode() + extSym->Addr.RawAddress));
+		}
+		return extSym->Addr.RawAddress;
+	}
+
+	void Module::BindImport(u32 symIndex, Module* other, Symbol* extSym) {
+		SetImportBinding(symIndex, other, extSym);
+		RelocateByImportSymbol(symIndex);
+	}
+
+	void Module::SetImportBinding(u32 symIndex, Module* other, Symbol* extSym) {
 		SymbolSection* symSect = GetSymbols();
+		Symbol* sym = &symSect->Symbols[symIndex];
 		SymbolSection* otherSymSect = other->GetSymbols();
+		sym->Attr |= RPM_SYMATTR_GLOBAL; //always global offset
+		sym->Addr.RawAddress = CalcImportAddress(other, extSym);
+		symSect->ImportAddressTable[symIndex - symSect->FirstImportSymbolIdx] = sym->Addr.RawAddress;
+		symSect->ImportModuleTable[symIndex - symSect->FirstImportSymbolIdx] = static_cast<u32>(reinterpret_cast<size_t>(other));
+		sym->Type = extSym->Type;
+		sym->Size = extSym->Size;
+		//Lets UnimportModule restore the import hash without searching
+		sym->ExportOrdinal = extSym - &otherSymSect->Symbols[otherSymSect->FirstExportSymbolIdx];
+
+		sym->Attr &= ~SymbolAttr::RPM_SYMATTR_IMPORT;
+	}
 
-		if (symSect && otherSymSect && otherSymSect->ExportSymbolHashTable) {
-			u32 firstImportSymbolIdx = symSect->FirstImportSymbolIdx;
-			u32 otherExportSymbolCount = otherSymSect->ExportSymbolCount;
-			
-			if (symSect->ImportSymbolCount && otherExportSymbolCount && firstImportSymbolIdx != 0xFFFF) {
-				rpm::Symbol* symArray = &symSect->Symbols[firstImportSymbolIdx];
-				RPM_NAMEHASH* exportHashArr = otherSymSect->ExportSymbolHashTable;
-				u32 importSymCount = symSect->ImportSymbolCount;
-				bool anyUnimported = false;
-				for (u32 i = 0; i < otherExportSymbolCount; i++) {
-					RPM_NAMEHASH exportedHash = exportHashArr[i];
-					rpm::Symbol* imSym = Util::BinarySearchImportTable(exportedHash, symArray, importSymCount);
-					if (imSym != nullptr) {
-						RPM_DEBUG_PRINTF("Unlinked symbol 0x%x.\n", imSym->Addr.ImportHash);
-						imSym->Attr |= SymbolAttr::RPM_SYMATTR_IMPORT; //flag as needs-import
-						anyUnimported = true;
-					}
-				}
-				if (anyUnimported) {
-					ClearReserveFlag(RPM_RSVFLAG_ALL_IMPORTED);
+	void Module::UnbindImport(u32 importIndex) {
+		SymbolSection* symSect = GetSymbols();
+		Symbol* imSym = &symSect->Symbols[symSect->FirstImportSymbolIdx + importIndex];
+		imSym->Addr.ImportHash = symSect->ImportSymbolHashTable[importIndex];
+		RPM_DEBUG_PRINTF("Unlinked symbol 0x%x.\n", imSym->Addr.ImportHash);
+		imSym->Attr |= SymbolAttr::RPM_SYMATTR_IMPORT; //flag as needs-import
+		symSect->ImportAddressTable[importIndex] = 0;
+		symSect->ImportModuleTable[importIndex] = 0;
+	}
+
+	bool Module::ImportsFrom(Module* other) {
+		SymbolSection* symSect = GetSymbols();
+		if (!symSect || !symSect->ImportSymbolCount || symSect->FirstImportSymbolIdx == 0xFFFF) {
+			return false;
+		}
+		u32 otherAddr = static_cast<u32>(reinterpret_cast<size_t>(other));
+		//Pending imports have an exporter of 0, which is never a module
+		u32* exporters = symSect->ImportModuleTable;
+		for (u32 i = 0; i < symSect->ImportSymbolCount; i++) {
+			if (exporters[i] == otherAddr) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void Module::UnimportModule(Module* other) {
+		SymbolSection* symSect = GetSymbols();
+
+		if (symSect && symSect->ImportSymbolCount && symSect->FirstImportSymbolIdx != 0xFFFF) {
+			u32 otherAddr = static_cast<u32>(reinterpret_cast<size_t>(other));
+			u32* exporters = symSect->ImportModuleTable;
+			bool anyUnimported = false;
+			//Only the exporter column is scanned, which also covers imports of absolute addresses that do not point into the module
+			for (u32 i = 0; i < symSect->ImportSymbolCount; i++) {
+				if (exporters[i] == otherAddr) {
+					UnbindImport(i);
+					anyUnimported = true;
 				}
 			}
+			if (anyUnimported) {
+				BuildImportWorklist();
+				ClearReserveFlag(RPM_RSVFLAG_ALL_IMPORTED);
+			}
+		}
+	}
+
+	u32 Module::RebindImports(Module* from, Module* to) {
+		SymbolSection* symSect = GetSymbols();
+		if (!symSect || !symSect->ImportSymbolCount || symSect->FirstImportSymbolIdx == 0xFFFF) {
+			return 0;
+		}
+		SymbolSection* toSymSect = to->GetSymbols();
+		RPM_NAMEHASH* exportHashArr = toSymSect ? toSymSect->ExportSymbolHashTable.Get() : nullptr;
+		u32 exportCount = exportHashArr ? toSymSect->ExportSymbolCount : 0;
+		u32 firstImportSymbolIdx = symSect->FirstImportSymbolIdx;
+		RPM_NAMEHASH* importHashArr = symSect->ImportSymbolHashTable;
+		u32* exporters = symSect->ImportModuleTable;
+		u32 fromAddr = static_cast<u32>(reinterpret_cast<size_t>(from));
+
+		u32 reboundCount = 0;
+		bool anyUnbound = false;
+		u32 exportIndex = 0;
+		//Both hash columns are sorted, so every rebound import is matched in one merged pass
+		for (u32 i = 0; i < symSect->ImportSymbolCount; i++) {
+			if (exporters[i] != fromAddr) {
+				continue;
+			}
+			RPM_NAMEHASH hash = importHashArr[i];
+			while (exportIndex < exportCount && exportHashArr[exportIndex] < hash) {
+				exportIndex++;
+			}
+			Symbol* extSym = nullptr;
+			if (exportIndex < exportCount && exportHashArr[exportIndex] == hash) {
+				extSym = &toSymSect->Symbols[toSymSect->FirstExportSymbolIdx + exportIndex];
+			}
+			if (extSym && !(extSym->Attr & RPM_SYMATTR_IMPORT)) {
+				BindImport(firstImportSymbolIdx + i, to, extSym);
+				reboundCount++;
+			}
+			else {
+				UnbindImport(i);
+				anyUnbound = true;
+			}
+		}
+		if (anyUnbound) {
+			BuildImportWorklist();
+			ClearReserveFlag(RPM_RSVFLAG_ALL_IMPORTED);
 		}
+		return reboundCount;
 	}
 
 	u16 Module::FindSymbolIdx(const char* name) {
@@ -210,6 +663,45 @@ namespace rpm {
 		return NULL;
 	}
 
+	u32 Module::BindProcTable(ProcTable* table) {
+		RPM_ASSERT(table);
+		ProcBinding* bindings = table->Bindings;
+		if (!table->Sorted) {
+			for (u32 i = 1; i < table->Count; i++) {
+				ProcBinding binding = bindings[i];
+				u32 j = i;
+				for (; j > 0 && bindings[j - 1].Hash > binding.Hash; j--) {
+					bindings[j] = bindings[j - 1];
+				}
+				bindings[j] = binding;
+			}
+			table->Sorted = true;
+		}
+
+		SymbolSection* symSect = GetSymbols();
+		RPM_NAMEHASH* exportHashArr = symSect ? symSect->ExportSymbolHashTable.Get() : nullptr;
+		u32 exportCount = exportHashArr ? symSect->ExportSymbolCount : 0;
+		u32 exportIndex = 0;
+		u32 missingCount = 0;
+		//Both the bindings and the export hash table are sorted by hash, so they are merged in a single pass
+		for (u32 i = 0; i < table->Count; i++) {
+			ProcBinding* binding = &bindings[i];
+			while (exportIndex < exportCount && exportHashArr[exportIndex] < binding->Hash) {
+				exportIndex++;
+			}
+			void* addr = nullptr;
+			if (exportIndex < exportCount && exportHashArr[exportIndex] == binding->Hash) {
+				addr = GetSymbolAddressAbsolute(&symSect->Symbols[symSect->FirstExportSymbolIdx + exportIndex]);
+			}
+			if (!addr) {
+				RPM_DEBUG_PRINTF("Could not bind proc with hash %x.\n", binding->Hash);
+				missingCount++;
+			}
+			*binding->Slot = addr;
+		}
+		return missingCount;
+	}
+
 	Symbol* Module::GetSymbol(u16 index) {
 		SymbolSection* ssec = GetSymbols();
 		if (ssec) {
@@ -267,88 +759,96 @@ namespace rpm {
 		return NULL;
 	}
 
-	void Module::RelocHeaderPtr(void* pptr) {
-		Util::RelocPtr(pptr, static_cast<void*>(m_Exec));
-	}
-
-	void Module::RelocHeaderPtrNonNull(void* pptr) {
-		void** test = static_cast<void**>(pptr);
-		void* ptr = *test;
-		if (ptr != reinterpret_cast<void*>(0xFFFFFFFF)) {
-			if (ptr != NULL) {
-				RelocHeaderPtr(pptr);
+	void Module::Expand(const rpm::init::ModuleLayout* layout, rpm::init::LoadFlags flags) {
+		if (layout && (flags & rpm::init::RPM_LOADFLAG_PRE_EXPANDED)) {
+			//The header section has been read to its final position already
+			m_Exec = reinterpret_cast<DllExec*>(reinterpret_cast<u8*>(this) + layout->HeaderOffset);
+			if (!(flags & rpm::init::RPM_LOADFLAG_ZEROED)) {
+				memset(reinterpret_cast<u8*>(this) + layout->BSSOffset, 0, layout->BSSSize);
 			}
+			return;
 		}
-		else {
-			*test = NULL;
-		}
-	}
-
-	void Module::Expand() {
 		Util::RelocPtr(&m_Exec, this);
 		u32 bssSize = m_Exec->BSSSize;
 		if (bssSize > 0) {
 			DllExec* newHeaderPos = reinterpret_cast<DllExec*>(reinterpret_cast<char*>(m_Exec) + bssSize);
 			void* bssStart = m_Exec;
-			memmove(newHeaderPos, m_Exec, m_Exec->HeaderSectionSize);
-			memset(bssStart, 0, bssSize); //Fill BSS
-			m_Exec = newHeaderPos;
-		}
-	}
-
-	void Module::RelocateControl() {
-		if (!GetReserveFlag(RPM_RSVFLAG_CONTROL_RELOCATED)) {
-			RelocHeaderPtrNonNull(&m_Exec->Info);
-			Util::RelocPtr(&m_Exec->Info->Code, this); //Relative to file, not header
-			RelocHeaderPtrNonNull(&m_Exec->Info->Symbols);
-			RelocHeaderPtrNonNull(&m_Exec->Info->Strings);
-			RelocHeaderPtrNonNull(&m_Exec->Info->Relocations);
-			RelocHeaderPtrNonNull(&m_Exec->Info->MetaValueSection);
-			RelocHeaderPtrNonNull(&m_Exec->Info->StaticInitializers);
-			RelocHeaderPtrNonNull(&m_Exec->Info->StaticDestructors);
-			if (m_Exec->Info->Symbols) {
-				RelocHeaderPtrNonNull(&m_Exec->Info->Symbols->ExternModules);
-				RelocHeaderPtrNonNull(&m_Exec->Info->Symbols->ExportSymbolHashTable);
+			u32 headerSectionSize = m_Exec->HeaderSectionSize;
+			//The control section links are self-relative RelPtrs, which stay valid as long as the header section moves as a whole
+			memmove(static_cast<void*>(newHeaderPos), static_cast<const void*>(m_Exec), headerSectionSize);
+			if (flags & rpm::init::RPM_LOADFLAG_ZEROED) {
+				//Only the part of the BSS that held the header section before the move is dirty
+				memset(bssStart, 0, bssSize < headerSectionSize ? bssSize : headerSectionSize);
 			}
-			if (m_Exec->Info->Relocations) {
-				RelocHeaderPtrNonNull(&m_Exec->Info->Relocations->InternalRelocations);
-				RelocHeaderPtrNonNull(&m_Exec->Info->Relocations->InternalImportRelocations);
-				RelocHeaderPtrNonNull(&m_Exec->Info->Relocations->ExternalRelocations);
-				RelocHeaderPtrNonNull(&m_Exec->Info->Relocations->ExternModules);
+			else {
+				memset(bssStart, 0, bssSize); //Fill BSS
 			}
-			SetReserveFlag(RPM_RSVFLAG_CONTROL_RELOCATED);
+			m_Exec = newHeaderPos;
 		}
 	}
 
 	void Module::Prepare() {
+		SetReserveFlag(RPM_RSVFLAG_CONTROL_READY);
 		rpm::Module::SymbolSection* symSect = GetSymbols();
 		if (symSect == nullptr || symSect->ImportSymbolCount == 0) {
 			SetReserveFlag(RPM_RSVFLAG_ALL_IMPORTED);
 		}
+		else {
+			BuildImportWorklist();
+		}
+		RelocationSection* rel = GetRelocations();
+		RelocationList* importRels = rel ? rel->InternalImportRelocations.Get() : nullptr;
+		if (importRels) {
+			//Lets the relocations of an import be found without going through all of them
+			Util::SortRelocationsBySymbol(importRels->Relocations, importRels->Count);
+		}
 	}
 
 	void Module::RelocateInternal() {
+		u32 next = 0;
+		RelocateInternal(&next, 0xFFFFFFFF);
+	}
+
+	bool Module::RelocateInternal(u32* pNext, u32 maxCount) {
 		if (!GetReserveFlag(RPM_RSVFLAG_CODE_RELOCATED_INTERNAL)) {
 			RelocationSection* rel = GetRelocations();
 			if (rel) {
 				RelocationList* internals = rel->InternalRelocations;
 
 				if (internals) {
-					for (int i = 0; i < internals->Count; i++) {
+					u32 i = *pNext;
+					u32 end = internals->Count;
+					if (end - i > maxCount) {
+						end = i + maxCount;
+					}
+					u8* codeBase = GetCode();
+					while (i < end) {
 						Relocation* r = &internals->Relocations[i];
 
+						u32 runLength = Util::DoOffsetRelocationRun(codeBase, this, r, end - i);
+						if (runLength) {
+							i += runLength;
+							continue;
+						}
+
 						u32 addr = r->Target.Offset;
 						Util::CutAlign16(&addr);
 
-						u8* code = GetCode() + addr;
+						u8* code = codeBase + addr;
 
 						Util::DoRelocation(code, this, r);
+						i++;
+					}
+					*pNext = i;
+					if (i < internals->Count) {
+						return false;
 					}
 				}
 
 				SetReserveFlag(RPM_RSVFLAG_CODE_RELOCATED_INTERNAL);
 			}
 		}
+		return true;
 	}
 
 	void Module::RelocateByImportSymbol(u32 symIndex) {
@@ -357,25 +857,36 @@ namespace rpm {
 			RelocationList* importRels = rel->InternalImportRelocations;
 
 			if (importRels) {
-				for (int i = 0; i < importRels->Count; i++) {
+				//Sorted by symbol in Prepare
+				for (u32 i = Util::LowerBoundRelocationSymbol(symIndex, importRels->Relocations, importRels->Count); i < importRels->Count; i++) {
 					Relocation* r = &importRels->Relocations[i];
 
-					if (r->Source.SymbNo == symIndex) {
-						u32 addr = r->Target.Offset;
-						Util::CutAlign16(&addr);
+					if (r->Source.SymbNo != symIndex) {
+						break;
+					}
+					u32 addr = r->Target.Offset;
+					Util::CutAlign16(&addr);
 
-						u8* code = GetCode() + addr;
-						RPM_DEBUG_PRINTF("Relocating by import symbol @ %p (rel. %p) -> %p\n", code, addr);
+					u8* code = GetCode() + addr;
+					RPM_DEBUG_PRINTF("Relocating by import symbol @ %p (rel. %p) -> %p\n", code, addr);
 
-						Util::DoRelocation(code, this, r);
-					}
+					Util::DoRelocation(code, this, r);
 				}
 			}
 		}
 	}
 
+	bool Module::IsImageComplete() {
+		u8* end = reinterpret_cast<u8*>(this) + m_Size;
+		if (!m_Exec || reinterpret_cast<u8*>(m_Exec) < reinterpret_cast<u8*>(this) || reinterpret_cast<u8*>(m_Exec) + sizeof(DllExec) > end) {
+			return false;
+		}
+		u8* info = reinterpret_cast<u8*>(m_Exec->Info.Get());
+		return info >= reinterpret_cast<u8*>(this) && info + sizeof(InfoSection) <= end;
+	}
+
 	bool Module::Verify() {
-		if (!GetReserveFlag(RPM_RSVFLAG_CONTROL_RELOCATED)) {
+		if (!GetReserveFlag(RPM_RSVFLAG_CONTROL_READY)) {
 			return false;
 		}
 		if (!m_Exec) {
@@ -394,8 +905,14 @@ namespace rpm {
 		if (info->Magic != INFO_MAGIC) {
 			return false;
 		}
-		if (info->Symbols && info->Symbols->Magic != SYM0_MAGIC) {
-			return false;
+		if (info->Symbols) {
+			SymbolSection* symSect = info->Symbols;
+			if (symSect->Magic != SYM0_MAGIC) {
+				return false;
+			}
+			if (symSect->ImportSymbolCount && (!symSect->ImportSymbolHashTable || !symSect->ImportAddressTable || !symSect->ImportModuleTable)) {
+				return false;
+			}
 		}
 		if (info->Relocations && info->Relocations->Magic != REL0_MAGIC) {
 			return false;
@@ -0,0 +1,127 @@
+#ifndef __RPM_MODULEINSTANCE_CPP
+#define __RPM_MODULEINSTANCE_CPP
+
+#include "RPM_Types.h"
+#include "RPM_Module.h"
+#include "RPM_ModuleInstance.h"
+#include "RPM_MetaData.h"
+#include "RPM_Util.h"
+
+namespace rpm {
+	namespace mgr {
+		bool ModuleInstance::GetInstanceData(rpm::Module* module, u8** pData, u32* pSize, u32* pSiteCount) {
+			RPM_ASSERT(module);
+			MetaData* meta = module->GetMetaData();
+			rpm::Module::RelocationSection* rels = module->GetRelocations();
+			if (!meta || !rels || !rels->InternalRelocations) {
+				return false;
+			}
+			int offset = meta->GetInt(module, RPM_METAVALUE_INSTANCE_DATA_OFFSET, -1);
+			if (offset < 0 || static_cast<u32>(offset) > module->GetCodeSize()) {
+				return false;
+			}
+			u8* data = module->GetCode() + offset;
+			u8* dataEnd = module->GetBSSEnd();
+
+			u32 siteCount = 0;
+			RelocationList* internals = rels->InternalRelocations;
+			for (u32 i = 0; i < internals->Count; i++) {
+				Relocation* r = &internals->Relocations[i];
+				u32 addr = r->Target.Offset;
+				Util::CutAlign16(&addr);
+				u8* location = module->GetCode() + addr;
+				u8* target = module->GetSymbolAddressAbsolute(module->GetSymbol(r->Source.SymbNo));
+				bool targetInData = target >= data && target < dataEnd;
+				if (location < data) {
+					if (targetInData) {
+						if (r->Target.RelProcType != RPM_REL_TGTTYPE_OFFSET) {
+							RPM_DEBUG_PRINTF("Shared code at %p references instance data at %p other than by an absolute word.\n", location, target);
+							return false;
+						}
+						siteCount++;
+					}
+				}
+				else if (!targetInData && r->Target.RelProcType != RPM_REL_TGTTYPE_OFFSET) {
+					//PC-relative references out of the instance data would differ for each copy
+					return false;
+				}
+			}
+
+			*pData = data;
+			*pSize = dataEnd - data;
+			*pSiteCount = siteCount;
+			return true;
+		}
+
+		void ModuleInstance::CollectSites() {
+			rpm::Module* module = m_Template;
+			RelocationList* internals = module->GetRelocations()->InternalRelocations;
+			u8* dataEnd = m_TemplateData + m_DataSize;
+			u32 siteIndex = 0;
+			for (u32 i = 0; i < internals->Count && siteIndex < m_SiteCount; i++) {
+				Relocation* r = &internals->Relocations[i];
+				u32 addr = r->Target.Offset;
+				Util::CutAlign16(&addr);
+				if (module->GetCode() + addr < m_TemplateData) {
+					u8* target = module->GetSymbolAddressAbsolute(module->GetSymbol(r->Source.SymbNo));
+					if (target >= m_TemplateData && target < dataEnd) {
+						m_Sites[siteIndex].Offset = addr;
+						m_Sites[siteIndex].Target = target - m_TemplateData;
+						siteIndex++;
+					}
+				}
+			}
+		}
+
+		void ModuleInstance::RebaseData() {
+			rpm::Module* module = m_Template;
+			RelocationList* internals = module->GetRelocations()->InternalRelocations;
+			u8* dataEnd = m_TemplateData + m_DataSize;
+			size_t delta = m_Data - m_TemplateData;
+			for (u32 i = 0; i < internals->Count; i++) {
+				Relocation* r = &internals->Relocations[i];
+				//Relative relocations within the instance data stay valid, only absolute ones have to be rebased
+				if (r->Target.RelProcType == RPM_REL_TGTTYPE_OFFSET) {
+					u32 addr = r->Target.Offset;
+					Util::CutAlign16(&addr);
+					u8* location = module->GetCode() + addr;
+					if (location >= m_TemplateData && location < dataEnd) {
+						u8* target = module->GetSymbolAddressAbsolute(module->GetSymbol(r->Source.SymbNo));
+						if (target >= m_TemplateData && target < dataEnd) {
+							*reinterpret_cast<u32*>(location + delta) = static_cast<u32>(reinterpret_cast<size_t>(target + delta));
+						}
+					}
+				}
+			}
+		}
+
+		u32 ModuleInstance::GetActiveBase() {
+			if (!m_SiteCount) {
+				return GetBase(m_Data);
+			}
+			return *reinterpret_cast<u32*>(m_Template->GetCode() + m_Sites[0].Offset) - m_Sites[0].Target;
+		}
+
+		void ModuleInstance::PointSitesAt(u32 base) {
+			u8* code = m_Template->GetCode();
+			for (u32 i = 0; i < m_SiteCount; i++) {
+				*reinterpret_cast<u32*>(code + m_Sites[i].Offset) = base + m_Sites[i].Target;
+			}
+		}
+
+		void* ModuleInstance::TranslateAddress(void* addr) {
+			u8* p = static_cast<u8*>(addr);
+			if (p >= m_TemplateData && p < m_TemplateData + m_DataSize) {
+				return m_Data + (p - m_TemplateData);
+			}
+			return addr;
+		}
+
+		void* ModuleInstance::GetProcAddress(const char* name) {
+			void* addr = m_Template->GetProcAddress(name);
+			return addr ? TranslateAddress(addr) : nullptr;
+		}
+	}
+}
+
+#endif
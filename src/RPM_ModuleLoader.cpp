@@ -0,0 +1,144 @@
+#ifndef __RPM_MODULELOADER_CPP
+#define __RPM_MODULELOADER_CPP
+
+#include "RPM_Types.h"
+#include "RPM_Module.h"
+#include "RPM_ModuleLoader.h"
+#include "RPM_ModuleManager.h"
+#include "RPM_Util.h"
+
+namespace rpm {
+	namespace mgr {
+		ModuleLoader::ModuleLoader(ModuleManager* mgr, rpm::init::ModuleAllocation data, rpm::FixLevel fixLevel) 
+			: ModuleLoader(mgr, data, nullptr, rpm::init::RPM_LOADFLAG_NONE, fixLevel) {
+		}
+
+		ModuleLoader::ModuleLoader(ModuleManager* mgr, rpm::init::ModuleAllocation data, const rpm::init::ModuleLayout* layout, rpm::init::LoadFlags flags, rpm::FixLevel fixLevel) {
+			RPM_ASSERT(mgr);
+			RPM_ASSERT(data);
+			m_Manager = mgr;
+			m_Data = data;
+			m_Layout = layout;
+			m_Flags = flags;
+			m_FixLevel = fixLevel;
+			m_Module = nullptr;
+			m_Stage = EXPAND;
+			m_RelocCursor = 0;
+			m_FuncListCursor = 0;
+			m_FuncCursor = 0;
+		}
+
+		ModuleLoader::~ModuleLoader() {
+			if (m_Stage == LINK) {
+				RPM_SYNC_WRITE_SCOPE(m_Manager->m_WriteLock);
+				m_Manager->EndLinkModule(&m_LinkCursor);
+			}
+		}
+
+		bool ModuleLoader::Step(u32 budget) {
+			RPM_ASSERT(budget);
+			RPM_SYNC_WRITE_SCOPE(m_Manager->m_WriteLock);
+			while (budget && !IsFinished()) {
+				switch (m_Stage) {
+					case EXPAND:
+						RPM_TRACE_EVENT(m_Manager->m_Trace, TRACE_LOAD, TRACE_BEGIN, nullptr, m_Data, m_Flags);
+						m_Module = m_Manager->PlaceModule(m_Data, m_Layout, m_Flags);
+						m_Stage = m_Module ? PREPARE : FAILED;
+						budget--;
+						break;
+					case PREPARE:
+						m_Module->Prepare();
+						m_Stage = REGISTER;
+						budget--;
+						break;
+					case REGISTER:
+						m_Module = m_Manager->RegisterModule(m_Module);
+						RPM_TRACE_EVENT(m_Manager->m_Trace, TRACE_LOAD, TRACE_END, m_Module, m_Data, m_Flags);
+						if (m_Module) {
+							RPM_DEBUG_PRINTF("Starting module...\n");
+							m_Manager->BeginLinkModule(m_Module, &m_LinkCursor);
+							m_Stage = LINK;
+						}
+						else {
+							m_Stage = FAILED;
+						}
+						budget--;
+						break;
+					case LINK:
+					{
+						bool usedByStarted = false; //the module is started by the following stages anyway
+						if (m_Manager->LinkModuleStep(m_Module, &m_LinkCursor, &usedByStarted)) {
+							budget--;
+						}
+						else {
+							m_Manager->CallModuleListeners(m_Module, EXEC_UPDATED);
+							m_Stage = RELOCATE_INTERNAL;
+						}
+						break;
+					}
+					case RELOCATE_INTERNAL:
+					{
+						u32 start = m_RelocCursor;
+						RPM_TRACE_EVENT(m_Manager->m_Trace, TRACE_RELOCATE, TRACE_BEGIN, m_Module, nullptr, budget);
+						if (m_Module->RelocateInternal(&m_RelocCursor, budget)) {
+							m_Manager->CaptureModule(m_Module, m_FixLevel);
+							m_Stage = STATIC_INITIALIZERS;
+						}
+						u32 done = m_RelocCursor - start;
+						RPM_TRACE_EVENT(m_Manager->m_Trace, TRACE_RELOCATE, TRACE_END, m_Module, nullptr, done);
+						budget -= (done < budget) ? done : budget;
+						break;
+					}
+					case STATIC_INITIALIZERS:
+					{
+						RPM_TRACE_SCOPE(m_Manager->m_Trace, TRACE_STATIC_INITIALIZERS, m_Module, nullptr, budget);
+						budget -= StepStaticInitializers(budget);
+						break;
+					}
+					case FIX:
+						m_Manager->ReadyModule(m_Module, m_FixLevel);
+						m_Stage = DLLMAIN;
+						budget--;
+						break;
+					case DLLMAIN:
+						m_Manager->ControlModule(m_Module, rpm::DllMainReason::MODULE_LOAD);
+						m_Manager->CompleteStartModule(m_Module);
+						m_Stage = DONE;
+						budget--;
+						break;
+					default:
+						break;
+				}
+			}
+			return IsFinished();
+		}
+
+		u32 ModuleLoader::StepStaticInitializers(u32 budget) {
+			rpm::FuncArrayList* funcArray = m_Module->m_Exec->Info->StaticInitializers;
+			u32 used = 0;
+			if (funcArray) {
+				while (m_FuncListCursor < funcArray->Count) {
+					rpm::Symbol* sym = m_Module->GetSymbol(funcArray->SymbolIndices[m_FuncListCursor]);
+					if (sym) {
+						VoidFn* funcptr = reinterpret_cast<VoidFn*>(m_Module->GetSymbolAddressAbsolute(sym));
+						u32 fnCount = (sym->Size) >> 2;
+						while (m_FuncCursor < fnCount) {
+							if (used == budget) {
+								return used;
+							}
+							funcptr[m_FuncCursor]();
+							m_FuncCursor++;
+							used++;
+						}
+					}
+					m_FuncListCursor++;
+					m_FuncCursor = 0;
+				}
+			}
+			m_Stage = FIX;
+			return used;
+		}
+	}
+}
+
+#endif
@@ -10,6 +10,8 @@
 #include "RPM_ModuleManager.h"
 #include "RPM_ModuleInit.h"
 #include "RPM_Util.h"
+#include "RPM_Version.h"
+#include <cstring>
 
 namespace rpm {
 	namespace mgr {
@@ -17,44 +19,192 @@ namespace rpm {
 			m_LastModule = nullptr;
 			m_ExternRelocator = nullptr;
 			m_ListenerHead = nullptr;
+			m_ImportCache = nullptr;
+			m_Trace = nullptr;
+			m_PressureHandler = nullptr;
 			m_ModuleHeap = moduleHeap;
+			m_WorkMemoryBlocks = nullptr;
+			m_WorkMemoryCapacity = 0;
+			m_WorkMemoryCount = 0;
+			m_WorkMemorySize = 0;
+			m_WorkArenaHead = nullptr;
+			m_InstanceMemorySize = 0;
+			m_MemoryInUse = 0;
+			m_PeakMemorySize = 0;
+			m_NameTable = nullptr;
+			m_NameTableCapacity = 0;
+			m_NameCount = 0;
+			m_LinkCursorHead = nullptr;
+			m_SnapshotHeap = nullptr;
+			m_SnapshotCaptureHead = nullptr;
+			m_Dependencies = nullptr;
+			m_DependencyCapacity = 0;
+			m_DependencyCount = 0;
+			m_DependencyOverflow = false;
+			m_Replacement = nullptr;
+		}
+
+		void* ModuleManager::AllocHeap(size_t size) {
+			void* mem = m_ModuleHeap->Alloc(size);
+			if (!mem && m_PressureHandler && m_PressureHandler->OnMemoryPressure(this, size)) {
+				mem = m_ModuleHeap->Alloc(size);
+			}
+			return mem;
 		}
 
 		rpm::init::ModuleAllocation ModuleManager::AllocModule(size_t size) {
-			return m_ModuleHeap->Alloc(size);
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			return AllocHeap(size);
 		}
 
 		void ModuleManager::FreeModule(rpm::Module* module) {
-			m_ModuleHeap->Free(module);
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			if (module->GetControlBlockSize()) {
+				ReleaseModuleControl(module);
+			}
+			if (!module->IsExternalImage()) {
+				m_ModuleHeap->Free(module);
+			}
 		}
 
 		void* ModuleManager::AllocModuleWorkMemory(size_t size) {
-			return m_ModuleHeap->Alloc(size);
+			return AllocModuleWorkMemory(size, nullptr);
+		}
+
+		void* ModuleManager::AllocModuleWorkMemory(size_t size, rpm::Module* owner) {
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			WorkArenaHeader* arena = owner ? FindWorkArena(owner) : nullptr;
+			if (arena) {
+				size_t offset = (arena->Used + RPM_WORK_ARENA_ALIGNMENT - 1) & ~(RPM_WORK_ARENA_ALIGNMENT - 1);
+				if (offset < arena->Size && size <= arena->Size - offset) {
+					arena->Used = offset + size;
+					arena->LiveCount++;
+					return arena->GetMemory() + offset;
+				}
+				//Blocks that do not fit go to the heap like for modules without an arena
+			}
+			void* mem = AllocHeap(size);
+			if (!mem) {
+				return nullptr;
+			}
+			if (!InsertWorkMemoryBlock(mem, owner, size)) {
+				m_ModuleHeap->Free(mem);
+				return nullptr;
+			}
+			m_WorkMemorySize += size;
+			m_MemoryInUse += size;
+			UpdateMemoryPeak();
+			return mem;
 		}
 
 		void ModuleManager::FreeModuleWorkMemory(void* mem) {
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			WorkArenaHeader* arena = FindWorkArenaOf(mem);
+			if (arena) {
+				if (!--arena->LiveCount) {
+					arena->Used = 0;
+				}
+				return;
+			}
+			u32 index = FindWorkMemoryBlock(mem);
+			if (index < m_WorkMemoryCount && m_WorkMemoryBlocks[index].Memory == mem) {
+				m_WorkMemorySize -= m_WorkMemoryBlocks[index].Size;
+				m_MemoryInUse -= m_WorkMemoryBlocks[index].Size;
+				RemoveWorkMemoryBlock(index);
+			}
 			m_ModuleHeap->Free(mem);
 		}
 
+		u32 ModuleManager::FindWorkMemoryBlock(void* mem) {
+			u32 low = 0;
+			u32 high = m_WorkMemoryCount;
+			while (low < high) {
+				u32 mid = (low + high) >> 1;
+				if (m_WorkMemoryBlocks[mid].Memory < mem) {
+					low = mid + 1;
+				}
+				else {
+					high = mid;
+				}
+			}
+			return low;
+		}
+
+		bool ModuleManager::InsertWorkMemoryBlock(void* mem, rpm::Module* owner, size_t size) {
+			if (m_WorkMemoryCount == m_WorkMemoryCapacity) {
+				u32 newCapacity = m_WorkMemoryCapacity ? m_WorkMemoryCapacity * 2 : 16;
+				WorkMemoryBlock* newBlocks = static_cast<WorkMemoryBlock*>(AllocHeap(newCapacity * sizeof(WorkMemoryBlock)));
+				if (!newBlocks) {
+					return false;
+				}
+				if (m_WorkMemoryBlocks) {
+					memcpy(newBlocks, m_WorkMemoryBlocks, m_WorkMemoryCount * sizeof(WorkMemoryBlock));
+					m_ModuleHeap->Free(m_WorkMemoryBlocks);
+				}
+				m_MemoryInUse += (newCapacity - m_WorkMemoryCapacity) * sizeof(WorkMemoryBlock);
+				m_WorkMemoryBlocks = newBlocks;
+				m_WorkMemoryCapacity = newCapacity;
+			}
+			u32 index = FindWorkMemoryBlock(mem);
+			memmove(&m_WorkMemoryBlocks[index + 1], &m_WorkMemoryBlocks[index], (m_WorkMemoryCount - index) * sizeof(WorkMemoryBlock));
+			m_WorkMemoryBlocks[index].Memory = mem;
+			m_WorkMemoryBlocks[index].Owner = owner;
+			m_WorkMemoryBlocks[index].Size = size;
+			m_WorkMemoryCount++;
+			return true;
+		}
+
+		void ModuleManager::RemoveWorkMemoryBlock(u32 index) {
+			m_WorkMemoryCount--;
+			memmove(&m_WorkMemoryBlocks[index], &m_WorkMemoryBlocks[index + 1], (m_WorkMemoryCount - index) * sizeof(WorkMemoryBlock));
+			if (!m_WorkMemoryCount) {
+				m_ModuleHeap->Free(m_WorkMemoryBlocks);
+				m_MemoryInUse -= m_WorkMemoryCapacity * sizeof(WorkMemoryBlock);
+				m_WorkMemoryBlocks = nullptr;
+				m_WorkMemoryCapacity = 0;
+			}
+		}
+
 		void ModuleManager::BindExternalRelocator(ExternalRelocator* relocator) {
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
 			m_ExternRelocator = relocator;
 		}
 
 		void ModuleManager::BindModuleListener(ModuleListener* listener) {
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
 			listener->m_Next = m_ListenerHead;
-			m_ListenerHead = listener;
+			RPM_ATOMIC_STORE(m_ListenerHead, listener);
+		}
+
+		void ModuleManager::BindImportCache(ImportCache* cache) {
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			RPM_ASSERT(!m_ImportCache);
+			m_ImportCache = cache;
+			BindModuleListener(cache);
+		}
+
+		void ModuleManager::BindTraceBuffer(TraceBuffer* trace) {
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			m_Trace = trace;
+		}
+
+		void ModuleManager::BindMemoryPressureHandler(MemoryPressureHandler* handler) {
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			m_PressureHandler = handler;
 		}
 
 		void ModuleManager::CallModuleListeners(rpm::Module* module, ModuleEvent event) {
 			ModuleListener* l = m_ListenerHead;
 			while (l) {
+				RPM_TRACE_SCOPE(m_Trace, TRACE_LISTENER, module, l, event);
 				l->OnEvent(this, module, event);
 				l = l->m_Next;
 			}
 		}
 
-		void CallFuncArray(rpm::Module* mod, rpm::FuncArrayList* funcArray) {
+		void ModuleManager::CallFuncArray(rpm::Module* mod, rpm::FuncArrayList* funcArray, TraceEventType type) {
 			if (funcArray) {
+				RPM_TRACE_SCOPE(m_Trace, type, mod, nullptr, funcArray->Count);
 				for (u32 i = 0; i < funcArray->Count; i++) {
 					rpm::Symbol* sym = mod->GetSymbol(funcArray->SymbolIndices[i]);
 					if (sym) {
@@ -70,32 +220,155 @@ namespace rpm {
 		}
 
 		rpm::Module* ModuleManager::LoadModule(rpm::init::ModuleAllocation data) {
+			return LoadModule(data, rpm::init::RPM_LOADFLAG_NONE);
+		}
+
+		rpm::Module* ModuleManager::LoadModule(rpm::init::ModuleAllocation data, rpm::init::LoadFlags flags) {
+			return LoadModule(data, nullptr, flags);
+		}
+
+		rpm::Module* ModuleManager::LoadModule(rpm::init::ModuleAllocation data, const rpm::init::ModuleLayout* layout, rpm::init::LoadFlags flags) {
 			RPM_ASSERT(data);
-			//Reallocate for BSS expansion. If the parent framework is smart, the allocation is already big enough and nothing is changed.
-			data = exl::heap::Allocator::ReallocStatic(data, reinterpret_cast<rpm::Module*>(data)->GetModuleSize());
-			rpm::Module* module = rpm::Module::InitModule(data);
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			RPM_TRACE_EVENT(m_Trace, TRACE_LOAD, TRACE_BEGIN, nullptr, data, flags);
+			rpm::Module* module = PlaceModule(data, layout, flags);
+			if (module) {
+				module->Prepare();
+				module = RegisterModule(module);
+			}
+			RPM_TRACE_EVENT(m_Trace, TRACE_LOAD, TRACE_END, module, data, flags);
+			return module;
+		}
 
-			if (m_LastModule) {
-				m_LastModule->SetNextModule(module);
-				module->SetPrevModule(m_LastModule);
-				m_LastModule = module;
+		rpm::Module* ModuleManager::LoadModule(ModuleSource* source, rpm::init::LoadFlags flags) {
+			RPM_ASSERT(source);
+			RPM_ASSERT(!(flags & rpm::init::RPM_LOADFLAG_SPLIT_CONTROL));
+			rpm::init::ModuleLayout layout;
+			rpm::init::ModuleAllocation data = ReadModuleImage(source, &layout, &flags);
+			if (!data) {
+				return nullptr;
 			}
-			else {
-				m_LastModule = module;
+			return LoadModule(data, &layout, flags);
+		}
+
+		rpm::init::ModuleAllocation ModuleManager::ReadModuleImage(ModuleSource* source, rpm::init::ModuleLayout* layout, rpm::init::LoadFlags* flags) {
+			u8 head[sizeof(rpm::Module)];
+			if (!source->Read(head, 0, sizeof(head)) || !rpm::Module::QueryModuleLayout(head, sizeof(head), source->GetSize(), layout)) {
+				RPM_DEBUG_PRINTF("Module source is not a valid module.\n");
+				return nullptr;
+			}
+			rpm::init::ModuleAllocation data = source->MapImage(layout);
+			if (data) {
+				*flags |= rpm::init::RPM_LOADFLAG_PRE_EXPANDED | rpm::init::RPM_LOADFLAG_ZEROED | rpm::init::RPM_LOADFLAG_EXTERNAL_IMAGE;
+				return data;
 			}
+			data = AllocModule(layout->AllocSize);
+			if (!data) {
+				return nullptr;
+			}
+			//The header section goes straight to its place after the BSS
+			u8* image = static_cast<u8*>(data);
+			if (!source->Read(image, 0, layout->BSSOffset) || !source->Read(image + layout->HeaderOffset, layout->BSSOffset, layout->FileSize - layout->BSSOffset)) {
+				RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+				m_ModuleHeap->Free(data);
+				return nullptr;
+			}
+			*flags |= rpm::init::RPM_LOADFLAG_PRE_EXPANDED;
+			return data;
+		}
+
+		rpm::Module* ModuleManager::PlaceModule(rpm::init::ModuleAllocation data, const rpm::init::ModuleLayout* layout, rpm::init::LoadFlags flags) {
+			if (flags & rpm::init::RPM_LOADFLAG_SPLIT_CONTROL) {
+				RPM_ASSERT(!(flags & rpm::init::RPM_LOADFLAG_PRE_EXPANDED));
+				RPM_ASSERT(!(flags & rpm::init::RPM_LOADFLAG_EXTERNAL_IMAGE));
+				//The split execution header may take more room than the header section it replaces
+				size_t size = reinterpret_cast<rpm::Module*>(data)->GetModuleSize();
+				size_t splitSize = rpm::Module::CalcSplitImageSize(data);
+				data = exl::heap::Allocator::ReallocStatic(data, size > splitSize ? size : splitSize);
+				rpm::Module* module = reinterpret_cast<rpm::Module*>(data);
+				module->Expand(nullptr, flags);
+				if (!SplitModuleControl(module)) {
+					return nullptr;
+				}
+				return module;
+			}
+			if (!layout && !(flags & rpm::init::RPM_LOADFLAG_EXTERNAL_IMAGE)) {
+				//Reallocate for BSS expansion. If the parent framework is smart, the allocation is already big enough and nothing is changed.
+				data = exl::heap::Allocator::ReallocStatic(data, reinterpret_cast<rpm::Module*>(data)->GetModuleSize());
+			}
+			rpm::Module* module = reinterpret_cast<rpm::Module*>(data);
+			module->Expand(layout, flags);
+			if (flags & rpm::init::RPM_LOADFLAG_EXTERNAL_IMAGE) {
+				module->SetReserveFlag(rpm::Module::ReserveFlag::RPM_RSVFLAG_EXTERNAL_IMAGE);
+			}
+			return module;
+		}
 
+		rpm::Module* ModuleManager::RegisterModule(rpm::Module* module) {
 			if (!module->Verify()) {
 				RPM_DEBUG_PRINTF("Module verification failed!!");
-				m_ModuleHeap->Free(data);
+				FreeModule(module);
 				return nullptr;
 			}
+
+			//The module is fully set up before it is published to concurrent readers
+			if (m_LastModule) {
+				module->SetPrevModule(m_LastModule);
+				m_LastModule->SetNextModule(module);
+			}
+			RPM_ATOMIC_STORE(m_LastModule, module);
+
+			rpm::MetaData* meta = module->GetMetaData();
+			if (meta) {
+				const char* name = meta->GetString(module, RPM_METAVALUE_MODULE_NAME, nullptr);
+				if (name && !InsertModuleName(Util::HashName(name), module)) {
+					RPM_DEBUG_PRINTF("Could not register module name %s.\n", name);
+				}
+			}
+
+			CreateWorkArena(module);
+
 			CallModuleListeners(module, LOADED);
+			//Modules are registered before being fixed, which is when they are the largest
+			m_MemoryInUse += GetModuleFootprint(module);
+			UpdateMemoryPeak();
+
+			return module;
+		}
 
+		rpm::Module* ModuleManager::RegisterDeferredImage(rpm::Module* module, u32 cacheId) {
+			module->SetPrevModule(nullptr);
+			module->SetNextModule(nullptr);
+			module = RegisterModule(module);
+			if (module) {
+				if (m_ImportCache && cacheId) {
+					m_ImportCache->SetModuleId(module, cacheId);
+				}
+				AddBoundDependencies(module);
+				bool usedByStarted = LinkModuleAll(module);
+				CallModuleListeners(module, READY);
+				CallModuleListeners(module, EXEC_UPDATED);
+				if (usedByStarted) {
+					ActivateModule(module);
+				}
+			}
 			return module;
 		}
 
 		void ModuleManager::UnloadModule(rpm::Module* module) {
 			RPM_ASSERT(module);
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			RetireModule(module, true);
+		}
+
+		void ModuleManager::RetireModule(rpm::Module* module, bool unlink) {
+			RPM_TRACE_SCOPE(m_Trace, TRACE_UNLOAD, module, nullptr, 0);
+			//Incremental loads resume from the next module in their link order
+			for (LinkCursor* cursor = m_LinkCursorHead; cursor; cursor = cursor->Next) {
+				if (cursor->Other == module) {
+					cursor->Other = module->GetPrevModule();
+				}
+			}
 			bool started = module->GetReserveFlag(rpm::Module::ReserveFlag::RPM_RSVFLAG_MODULE_STARTED);
 			if (started) {
 				ControlModule(module, rpm::DllMainReason::MODULE_UNLOAD);
@@ -109,31 +382,177 @@ namespace rpm {
 			if (module == m_LastModule) {
 				//Last module shall only have a PrevModule, not NextModule
 				//If module->PrevModule is NULL, this is the last module being unloaded
-				m_LastModule = module->GetPrevModule();
+				RPM_ATOMIC_STORE(m_LastModule, module->GetPrevModule());
 			}
 			if (started) {
-				CallFuncArray(module, module->m_Exec->Info->StaticDestructors);
+				CallFuncArray(module, module->m_Exec->Info->StaticDestructors, TRACE_STATIC_DESTRUCTORS);
 				module->ClearReserveFlag(rpm::Module::ReserveFlag::RPM_RSVFLAG_MODULE_STARTED);
 			}
-			UnlinkModule(module);
+			if (unlink) {
+				UnlinkModule(module);
+			}
+			RemoveModuleName(module);
 			CallModuleListeners(module, UNLOADED);
+			//Readers may still be walking through the module
+			RPM_SYNC_SYNCHRONIZE(m_ReadDomain);
+			ReleaseWorkArena(module);
+			ReleaseWorkMemory(module);
+			if (m_SnapshotCaptureHead) {
+				ReleaseSnapshotCapture(module);
+			}
+			RemoveModuleDependencies(module);
+			if (!m_LastModule) {
+				m_DependencyOverflow = false;
+			}
+			m_MemoryInUse -= GetModuleFootprint(module);
 			FreeModule(module);
 		}
 
+		rpm::Module* ModuleManager::ReloadModule(rpm::Module* old, rpm::init::ModuleAllocation data, rpm::FixLevel fixLevel) {
+			RPM_ASSERT(old);
+			RPM_ASSERT(data);
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			if (m_DependencyOverflow) {
+				RPM_DEBUG_PRINTF("The dependents of %p are not fully known and can not be rebound.\n", old);
+				m_ModuleHeap->Free(data);
+				return nullptr;
+			}
+			//Rebinding the dependents needs their import relocations
+			for (u32 i = FindModuleDependency(old, nullptr); i < m_DependencyCount && m_Dependencies[i].Exporter == old; i++) {
+				rpm::Module* other = m_Dependencies[i].Importer;
+				rpm::Module::RelocationSection* rel = other->GetRelocations();
+				if ((!rel || !rel->InternalImportRelocations) && other->ImportsFrom(old)) {
+					RPM_DEBUG_PRINTF("Module %p has been fixed past its import relocations and can not be rebound.\n", other);
+					m_ModuleHeap->Free(data);
+					return nullptr;
+				}
+			}
+
+			//The name is released first so that a new module with the same name can register it
+			RPM_NAMEHASH nameHash = 0;
+			ModuleNameEntry* nameEntry = m_NameCount ? FindModuleNameEntry(old) : nullptr;
+			if (nameEntry) {
+				nameHash = nameEntry->Hash;
+				RemoveModuleName(old);
+			}
+			rpm::Module* module = LoadModule(data);
+			if (!module) {
+				if (nameEntry) {
+					InsertModuleName(nameHash, old);
+				}
+				return nullptr;
+			}
+			if (nameEntry && !FindModuleNameEntry(module)) {
+				InsertModuleName(nameHash, module);
+			}
+			RPM_DEBUG_PRINTF("Linking replacement...\n");
+			LinkModuleImports(module, old);
+			StartLinkedModule(module, fixLevel);
+
+			//The dependency records of the old module are moved over to the new one as its dependents are rebound
+			u32 index;
+			while ((index = FindModuleDependency(old, nullptr)) < m_DependencyCount && m_Dependencies[index].Exporter == old) {
+				rpm::Module* other = m_Dependencies[index].Importer;
+				m_DependencyCount--;
+				memmove(&m_Dependencies[index], &m_Dependencies[index + 1], (m_DependencyCount - index) * sizeof(ModuleDependency));
+				other->RebindImports(old, module);
+				if (!other->IsFullyImported()) {
+					other->ImportModule(module, m_ImportCache);
+				}
+				AddModuleDependency(module, other);
+				CallModuleListeners(other, EXEC_UPDATED);
+			}
+			m_Replacement = module;
+			RetireModule(old, false);
+			m_Replacement = nullptr;
+			return module;
+		}
+
 		void ModuleManager::StartModule(rpm::Module* module, rpm::FixLevel fixLevel) {
 			RPM_ASSERT(module);
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
 			RPM_DEBUG_PRINTF("Starting module...\n");
 			RPM_DEBUG_PRINTF("Linking...\n");
 			LinkModule(module);
+			StartLinkedModule(module, fixLevel);
+		}
+
+		void ModuleManager::StartLinkedModule(rpm::Module* module, rpm::FixLevel fixLevel) {
 			RPM_DEBUG_PRINTF("Processing internal relocations...\n");
-			module->RelocateInternal();
-			CallFuncArray(module, module->m_Exec->Info->StaticInitializers);
+			{
+				RPM_TRACE_SCOPE(m_Trace, TRACE_RELOCATE, module, nullptr, 0);
+				module->RelocateInternal();
+			}
+			CaptureModule(module, fixLevel);
+			CallFuncArray(module, module->m_Exec->Info->StaticInitializers, TRACE_STATIC_INITIALIZERS);
+			ReadyModule(module, fixLevel);
+			ControlModule(module, rpm::DllMainReason::MODULE_LOAD); //todo: failure ?
+			CompleteStartModule(module);
+		}
+
+		void ModuleManager::StartModuleDeferred(rpm::Module* module, rpm::FixLevel fixLevel) {
+			RPM_ASSERT(module);
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			RPM_DEBUG_PRINTF("Starting module deferred...\n");
+			//Flagged before linking so that deferred dependencies stay deferred too
+			module->SetDeferredFixLevel(fixLevel);
+			module->SetReserveFlag(rpm::Module::ReserveFlag::RPM_RSVFLAG_START_DEFERRED);
+			bool usedByStarted = LinkModuleAll(module);
+			CallModuleListeners(module, EXEC_UPDATED);
+			{
+				RPM_TRACE_SCOPE(m_Trace, TRACE_RELOCATE, module, nullptr, 0);
+				module->RelocateInternal();
+			}
+			CaptureModule(module, fixLevel);
+			//The initializer tables are needed on activation
+			ReadyModule(module, fixLevel < rpm::FixLevel::INTERNAL_RELOCATIONS ? fixLevel : rpm::FixLevel::INTERNAL_RELOCATIONS);
+			if (usedByStarted) {
+				//A running module can already call into this one
+				ActivateModule(module);
+			}
+		}
+
+		void ModuleManager::ActivateModule(rpm::Module* module) {
+			RPM_ASSERT(module);
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			if (!module->IsStartDeferred()) {
+				return;
+			}
+			RPM_DEBUG_PRINTF("Activating deferred module...\n");
+			module->ClearReserveFlag(rpm::Module::ReserveFlag::RPM_RSVFLAG_START_DEFERRED);
+			//Dependencies are initialized first, as they would have been on a regular start
+			rpm::Module* other = m_LastModule;
+			while (other) {
+				if (other != module && other->IsStartDeferred() && module->ImportsFrom(other)) {
+					ActivateModule(other);
+				}
+				other = other->GetPrevModule();
+			}
+			CallFuncArray(module, module->m_Exec->Info->StaticInitializers, TRACE_STATIC_INITIALIZERS);
+			FixModule(module, module->GetDeferredFixLevel());
+			ControlModule(module, rpm::DllMainReason::MODULE_LOAD);
+			CompleteStartModule(module);
+		}
+
+		void ModuleManager::ActivateFoundModule(rpm::Module* module) {
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			//The module may have been unloaded between the lookup and taking the lock, in which case it must not be touched
+			for (rpm::Module* other = m_LastModule; other; other = other->GetPrevModule()) {
+				if (other == module) {
+					ActivateModule(module);
+					return;
+				}
+			}
+		}
+
+		void ModuleManager::ReadyModule(rpm::Module* module, rpm::FixLevel fixLevel) {
 			RPM_DEBUG_PRINTF("Fixing %d.\n", fixLevel);
 			FixModule(module, fixLevel);
 			CallModuleListeners(module, READY);
 			CallModuleListeners(module, EXEC_UPDATED);
-			//TODO static initializers
-			ControlModule(module, rpm::DllMainReason::MODULE_LOAD); //todo: failure ?
+		}
+
+		void ModuleManager::CompleteStartModule(rpm::Module* module) {
 			CallModuleListeners(module, STARTED);
 			module->SetReserveFlag(rpm::Module::ReserveFlag::RPM_RSVFLAG_MODULE_STARTED);
 			RPM_DEBUG_PRINTF("Module started\n");
@@ -141,38 +560,525 @@ namespace rpm {
 
 		void* ModuleManager::GetProcAddress(rpm::Module* module, const char* name) {
 			if (module) {
-				return module->GetProcAddress(name);
+				void* addr;
+				bool deferred;
+				{
+					RPM_SYNC_READ_SCOPE(m_ReadDomain);
+					addr = module->GetProcAddress(name);
+					deferred = addr && module->IsStartDeferred();
+				}
+				//Activation fixes the module, which waits for readers, so it is done outside the read scope
+				if (deferred) {
+					ActivateFoundModule(module);
+				}
+				return addr;
 			}
 			return nullptr;
 		}
 
+		rpm::Module* ModuleManager::GetLastModule() {
+			return RPM_ATOMIC_LOAD(m_LastModule);
+		}
+
+		void* ModuleManager::FindProcAddress(const char* name, rpm::Module** pModule) {
+			rpm::Module* module;
+			void* addr = nullptr;
+			bool deferred = false;
+			{
+				RPM_SYNC_READ_SCOPE(m_ReadDomain);
+				module = GetLastModule();
+				while (module) {
+					addr = module->GetProcAddress(name);
+					if (addr) {
+						deferred = module->IsStartDeferred();
+						break;
+					}
+					module = module->GetPrevModule();
+				}
+			}
+			if (!addr) {
+				return nullptr;
+			}
+			if (deferred) {
+				ActivateFoundModule(module);
+			}
+			if (pModule) {
+				*pModule = module;
+			}
+			return addr;
+		}
+
 		void ModuleManager::FixModule(rpm::Module* module, rpm::FixLevel fixLevel) {
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			RPM_TRACE_SCOPE(m_Trace, TRACE_FIX, module, nullptr, fixLevel);
+			//The control sections are modified in place
+			RPM_SYNC_EXCLUSIVE_SCOPE(m_ReadDomain);
+			size_t footprint = GetModuleFootprint(module);
+			ApplyFixLevel(module, fixLevel);
+			m_MemoryInUse -= footprint - GetModuleFootprint(module);
+		}
+
+		void ModuleManager::ApplyFixLevel(rpm::Module* module, rpm::FixLevel fixLevel) {
+			//The stripped sections are not necessarily the last ones, so the remaining ones are moved together
+			switch (fixLevel) {
+				case rpm::FixLevel::INTERNAL_RELOCATIONS:
+					CompactModule(module, rpm::RPM_FIXMASK_INTERNAL_RELOCATIONS);
+					return;
+				case rpm::FixLevel::EXPORTS_ONLY:
+					CompactModule(module, rpm::RPM_FIXMASK_ALL_BUT_EXPORTS);
+					return;
+				default:
+					break;
+			}
+			if (module->IsControlSplit()) {
+				if (fixLevel == rpm::FixLevel::ALL_NONCODE && module->GetControlBlockSize()) {
+					ReleaseModuleControl(module);
+					CallModuleListeners(module, FIXED);
+				}
+				return;
+			}
 			size_t fixedSize = module->CalcFixedSize(fixLevel);
 			if (fixedSize != -1) {
-				module = static_cast<rpm::Module*>(m_ModuleHeap->Realloc(module, fixedSize)); 
+				if (!module->IsExternalImage()) {
+					module = static_cast<rpm::Module*>(m_ModuleHeap->Realloc(module, fixedSize));
+				}
 				//The realloc should NEVER return a different pointer as the size is shrinking, but just for sanity...
 				RPM_ASSERT(module);
 
-				switch (fixLevel) {
-					case rpm::FixLevel::INTERNAL_RELOCATIONS:
-					{
-						rpm::Module::RelocationSection* rels = module->GetRelocations();
-						if (rels) {
-							rels->InternalRelocations = nullptr;
+				if (fixLevel == rpm::FixLevel::ALL_NONCODE) {
+					module->DisableControl();
+				}
+
+				module->UpdateModuleSizeAfterFixing(fixedSize);
+				CallModuleListeners(module, FIXED);
+			}
+		}
+
+		void ModuleManager::FixModuleSections(rpm::Module* module, rpm::FixMask mask) {
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			RPM_TRACE_SCOPE(m_Trace, TRACE_FIX, module, nullptr, mask);
+			RPM_SYNC_EXCLUSIVE_SCOPE(m_ReadDomain);
+			size_t footprint = GetModuleFootprint(module);
+			CompactModule(module, mask);
+			m_MemoryInUse -= footprint - GetModuleFootprint(module);
+		}
+
+		void ModuleManager::CompactModule(rpm::Module* module, rpm::FixMask mask) {
+			if (module->IsControlSplit()) {
+				rpm::Module::ControlSectionRef released[RPM_MAX_CONTROL_SECTIONS];
+				u32 count = module->StripSplitControl(mask, released);
+				if (count) {
+					size_t controlSize = module->GetControlBlockSize();
+					for (u32 i = 0; i < count; i++) {
+						controlSize -= FreeControlBlock(released[i].Start);
+					}
+					module->UpdateControlBlockSize(controlSize);
+					CallModuleListeners(module, FIXED);
+				}
+			}
+			else {
+				size_t fixedSize = module->CompactControl(mask);
+				if (fixedSize != module->GetModuleSize()) {
+					if (!module->IsExternalImage()) {
+						module = static_cast<rpm::Module*>(m_ModuleHeap->Realloc(module, fixedSize));
+					}
+					RPM_ASSERT(module);
+					module->UpdateModuleSizeAfterFixing(fixedSize);
+					CallModuleListeners(module, FIXED);
+				}
+			}
+		}
+
+		void ModuleManager::ReleaseModuleControl(rpm::Module* module) {
+			rpm::Module::ControlSectionRef refs[RPM_MAX_CONTROL_SECTIONS];
+			u32 count = module->CollectControlSections(refs, module->CalcStringsEnd(refs));
+			rpm::Module::SortControlSections(refs, count);
+			module->DisableControl();
+			for (u32 i = 0; i < count; i++) {
+				if (!i || refs[i].Start != refs[i - 1].Start) {
+					FreeControlBlock(refs[i].Start);
+				}
+			}
+			module->UpdateControlBlockSize(0);
+		}
+
+		bool ModuleManager::SplitModuleControl(rpm::Module* module) {
+			rpm::Module::ControlSectionRef refs[RPM_MAX_CONTROL_SECTIONS];
+			u32 count = module->CollectControlSections(refs, module->CalcStringsEnd(refs));
+			rpm::Module::SortControlSections(refs, count);
+			size_t controlSize = 0;
+			for (u32 i = 0; i < count; i++) {
+				rpm::Module::ControlSectionRef* ref = &refs[i];
+				ref->NewStart = nullptr;
+				if (ref->Kind == rpm::Module::CTRLSECT_INFO) {
+					continue; //placed in the persistent image
+				}
+				if (i && ref->Start == refs[i - 1].Start) {
+					ref->NewStart = refs[i - 1].NewStart; //an empty section sharing the block of the larger one sorted before it
+					continue;
+				}
+				size_t blockSize = sizeof(ControlBlockHeader) + ref->Size;
+				ControlBlockHeader* header = static_cast<ControlBlockHeader*>(AllocHeap(blockSize));
+				if (!header) {
+					for (u32 j = 0; j < i; j++) {
+						if (refs[j].NewStart && (!j || refs[j].NewStart != refs[j - 1].NewStart)) {
+							FreeControlBlock(refs[j].NewStart);
+						}
+					}
+					return false;
+				}
+				header->Size = blockSize;
+				ref->NewStart = reinterpret_cast<u8*>(header + 1);
+				memcpy(ref->NewStart, ref->Start, ref->Size);
+				controlSize += blockSize;
+			}
+			module->InitSplitControl(refs, count, controlSize);
+			//The image only shrinks here, and the control blocks link into it, so it must not move
+			if (exl::heap::Allocator::ReallocStatic(module, module->GetModuleSize()) != module) {
+				RPM_ASSERT(false);
+			}
+			return true;
+		}
+
+		size_t ModuleManager::FreeControlBlock(u8* block) {
+			ControlBlockHeader* header = reinterpret_cast<ControlBlockHeader*>(block) - 1;
+			size_t size = header->Size;
+			m_ModuleHeap->Free(header);
+			return size;
+		}
+
+		rpm::Module* ModuleManager::GetFirstModule() {
+			rpm::Module* module = m_LastModule;
+			if (module) {
+				while (module->GetPrevModule()) {
+					module = module->GetPrevModule();
+				}
+			}
+			return module;
+		}
+
+		size_t ModuleManager::CalcSnapshotSize() {
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			size_t size = sizeof(SnapshotHeader);
+			for (rpm::Module* module = m_LastModule; module; module = module->GetPrevModule()) {
+				SnapshotCapture* capture = FindSnapshotCapture(module);
+				if (!capture) {
+					RPM_DEBUG_PRINTF("Module %p of %zu bytes has no snapshot image.\n", module, module->GetModuleSize());
+					return 0;
+				}
+				if (!module->IsStartDeferred() && !module->GetReserveFlag(rpm::Module::ReserveFlag::RPM_RSVFLAG_MODULE_STARTED)) {
+					RPM_DEBUG_PRINTF("Module %p is still being loaded.\n", module);
+					return 0;
+				}
+				size += sizeof(SnapshotModule) + ((capture->Size + 3) & ~3) + capture->ExternWordCount * sizeof(u32);
+			}
+			return size;
+		}
+
+		size_t ModuleManager::SaveSnapshot(void* buffer, size_t bufferSize, const u32* stamps) {
+			RPM_ASSERT(buffer);
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			size_t size = CalcSnapshotSize();
+			if (!size || size > bufferSize) {
+				return 0;
+			}
+			SnapshotHeader* header = static_cast<SnapshotHeader*>(buffer);
+			header->Magic = SNAPSHOT_MAGIC;
+			header->Version = LIBRPM_VERSION;
+			header->TotalSize = size;
+			header->ModuleCount = 0;
+			for (rpm::Module* module = m_LastModule; module; module = module->GetPrevModule()) {
+				header->ModuleCount++;
+			}
+
+			u32 dataOffset = sizeof(SnapshotHeader) + header->ModuleCount * sizeof(SnapshotModule);
+			SnapshotModule* entry = header->Modules;
+			for (rpm::Module* module = GetFirstModule(); module; module = module->GetNextModule(), entry++) {
+				SnapshotCapture* capture = FindSnapshotCapture(module);
+				entry->Address = module;
+				entry->Size = capture->Size;
+				entry->DataOffset = dataOffset;
+				entry->Stamp = stamps ? stamps[entry - header->Modules] : 0;
+				entry->CacheId = m_ImportCache ? m_ImportCache->GetModuleId(module) : 0;
+				entry->FixLevel = capture->FixLevel;
+				entry->Flags = 0;
+				if (module->GetReserveFlag(rpm::Module::ReserveFlag::RPM_RSVFLAG_MODULE_STARTED)) {
+					entry->Flags |= SNAPSHOT_MODULE_STARTED;
+				}
+				if (capture->ExternAll) {
+					entry->Flags |= SNAPSHOT_MODULE_EXTERN_ALL;
+				}
+				entry->ExternWordCount = capture->ExternWordCount;
+				u8* data = static_cast<u8*>(buffer) + dataOffset;
+				memcpy(data, capture->GetImage(), entry->Size);
+				dataOffset += (entry->Size + 3) & ~3;
+				memcpy(static_cast<u8*>(buffer) + dataOffset, capture->GetExternMask(), entry->ExternWordCount * sizeof(u32));
+				dataOffset += entry->ExternWordCount * sizeof(u32);
+			}
+			return size;
+		}
+
+		bool ModuleManager::ValidateSnapshot(const SnapshotHeader* header, size_t size, const u32* stamps, u32 stampCount) {
+			if (size < sizeof(SnapshotHeader) || header->Magic != SNAPSHOT_MAGIC || header->Version != LIBRPM_VERSION || header->TotalSize != size) {
+				return false;
+			}
+			if (header->ModuleCount != stampCount || sizeof(SnapshotHeader) + header->ModuleCount * sizeof(SnapshotModule) > size) {
+				return false;
+			}
+			for (u32 i = 0; i < header->ModuleCount; i++) {
+				const SnapshotModule* entry = &header->Modules[i];
+				if (entry->DataOffset > size || entry->Size > size - entry->DataOffset) {
+					return false;
+				}
+				size_t externOffset = entry->DataOffset + ((entry->Size + 3) & ~3);
+				if (externOffset > size || entry->ExternWordCount > (size - externOffset) / sizeof(u32)) {
+					return false;
+				}
+				if (stamps && entry->Stamp != stamps[i]) {
+					RPM_DEBUG_PRINTF("Snapshot module %d stamp mismatch.\n", i);
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool ModuleManager::RestoreSnapshot(const void* snapshot, size_t size, const u32* stamps, u32 stampCount) {
+			RPM_ASSERT(snapshot);
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			const SnapshotHeader* header = static_cast<const SnapshotHeader*>(snapshot);
+			if (m_LastModule || !ValidateSnapshot(header, size, stamps, stampCount)) {
+				return false;
+			}
+			for (u32 i = 0; i < header->ModuleCount; i++) {
+				const SnapshotModule* entry = &header->Modules[i];
+				//Modules are started one by one, so that their work memory is allocated in the same order as when they were loaded
+				rpm::init::ModuleAllocation alloc = AllocModule(entry->Size);
+				rpm::Module* module = nullptr;
+				if (alloc == entry->Address) {
+					memcpy(alloc, static_cast<const u8*>(snapshot) + entry->DataOffset, entry->Size);
+					module = static_cast<rpm::Module*>(alloc);
+					if (module->GetModuleSize() == entry->Size && module->IsImageComplete()) {
+						module->SetPrevModule(nullptr);
+						module->SetNextModule(nullptr);
+						module = RegisterModule(module);
+						if (module && m_ImportCache && entry->CacheId) {
+							m_ImportCache->SetModuleId(module, entry->CacheId);
+						}
+						if (module) {
+							AddBoundDependencies(module);
+						}
+					}
+					else {
+						RPM_DEBUG_PRINTF("Snapshot module %d image is truncated.\n", i);
+						m_ModuleHeap->Free(alloc);
+						module = nullptr;
+					}
+				}
+				else if (alloc) {
+					RPM_DEBUG_PRINTF("Snapshot module %d allocated at %p instead of %p.\n", i, alloc, entry->Address);
+					m_ModuleHeap->Free(alloc);
+				}
+				if (!module) {
+					while (m_LastModule) {
+						UnloadModule(m_LastModule);
+					}
+					return false;
+				}
+
+				rpm::FixLevel fixLevel = static_cast<rpm::FixLevel>(entry->FixLevel);
+				CaptureModule(module, fixLevel);
+				//Modules loaded after this one have linked their imports into the live image, but not into the copy
+				LinkModule(module);
+				if (entry->Flags & SNAPSHOT_MODULE_EXTERN_ALL) {
+					ApplyExternRelocations(module, RPM_EXTERN_MODULE_ALL);
+				}
+				else {
+					const u32* externMask = reinterpret_cast<const u32*>(static_cast<const u8*>(snapshot) + entry->DataOffset + ((entry->Size + 3) & ~3));
+					for (u32 extModIndex = 0; extModIndex < entry->ExternWordCount * 32; extModIndex++) {
+						if (externMask[extModIndex >> 5] & (1u << (extModIndex & 31))) {
+							ApplyExternRelocations(module, extModIndex);
 						}
-						break;
 					}
-					case rpm::FixLevel::ALL_NONCODE:
-						module->DisableControl();
+				}
+				bool started = entry->Flags & SNAPSHOT_MODULE_STARTED;
+				if (module->IsStartDeferred()) {
+					rpm::FixLevel deferredFixLevel = module->GetDeferredFixLevel();
+					ReadyModule(module, deferredFixLevel < rpm::FixLevel::INTERNAL_RELOCATIONS ? deferredFixLevel : rpm::FixLevel::INTERNAL_RELOCATIONS);
+					if (started) {
+						ActivateModule(module);
+					}
+				}
+				else if (started) {
+					CallFuncArray(module, module->m_Exec->Info->StaticInitializers, TRACE_STATIC_INITIALIZERS);
+					ReadyModule(module, fixLevel);
+					ControlModule(module, rpm::DllMainReason::MODULE_LOAD);
+					CompleteStartModule(module);
+				}
+			}
+			return true;
+		}
+
+		ModuleInstance* ModuleManager::CreateModuleInstance(rpm::Module* templ) {
+			RPM_ASSERT(templ);
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			u8* templData;
+			u32 dataSize;
+			u32 siteCount;
+			if (!templ->IsStartDeferred() || !ModuleInstance::GetInstanceData(templ, &templData, &dataSize, &siteCount)) {
+				return nullptr;
+			}
+			size_t headerSize = (sizeof(ModuleInstance) + RPM_MODULE_ALIGNMENT - 1) & ~(RPM_MODULE_ALIGNMENT - 1);
+			size_t sitesOffset = (headerSize + dataSize + sizeof(u32) - 1) & ~(sizeof(u32) - 1);
+			size_t instanceSize = sitesOffset + siteCount * sizeof(ModuleInstance::Site);
+			u8* mem = static_cast<u8*>(AllocHeap(instanceSize));
+			if (!mem) {
+				return nullptr;
+			}
+			ModuleInstance* instance = reinterpret_cast<ModuleInstance*>(mem);
+			instance->m_Template = templ;
+			instance->m_TemplateData = templData;
+			instance->m_DataSize = dataSize;
+			instance->m_Data = mem + headerSize;
+			instance->m_SiteCount = siteCount;
+			instance->m_Sites = reinterpret_cast<ModuleInstance::Site*>(mem + sitesOffset);
+			instance->CollectSites();
+			memcpy(instance->m_Data, templData, dataSize);
+			instance->RebaseData();
+			m_InstanceMemorySize += instanceSize;
+			m_MemoryInUse += instanceSize;
+			UpdateMemoryPeak();
+
+			//The initializers reach the instance's globals through the shared code
+			u32 prevBase = instance->GetActiveBase();
+			instance->PointSitesAt(ModuleInstance::GetBase(instance->m_Data));
+			CallFuncArray(templ, templ->m_Exec->Info->StaticInitializers, TRACE_STATIC_INITIALIZERS);
+			ControlModule(templ, rpm::DllMainReason::MODULE_LOAD);
+			instance->PointSitesAt(prevBase);
+			return instance;
+		}
+
+		void ModuleManager::ActivateModuleInstance(ModuleInstance* instance) {
+			RPM_ASSERT(instance);
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			instance->PointSitesAt(ModuleInstance::GetBase(instance->m_Data));
+		}
+
+		void ModuleManager::DestroyModuleInstance(ModuleInstance* instance) {
+			RPM_ASSERT(instance);
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			u32 base = ModuleInstance::GetBase(instance->m_Data);
+			u32 prevBase = instance->GetActiveBase();
+			instance->PointSitesAt(base);
+			ControlModule(instance->m_Template, rpm::DllMainReason::MODULE_UNLOAD);
+			CallFuncArray(instance->m_Template, instance->m_Template->m_Exec->Info->StaticDestructors, TRACE_STATIC_DESTRUCTORS);
+			instance->PointSitesAt(prevBase == base ? ModuleInstance::GetBase(instance->m_TemplateData) : prevBase);
+
+			size_t instanceSize = reinterpret_cast<u8*>(instance->m_Sites + instance->m_SiteCount) - reinterpret_cast<u8*>(instance);
+			m_InstanceMemorySize -= instanceSize;
+			m_MemoryInUse -= instanceSize;
+			m_ModuleHeap->Free(instance);
+		}
+
+		void ModuleManager::GetModuleMemoryStats(rpm::Module* module, ModuleMemoryStats* stats) {
+			RPM_ASSERT(module);
+			RPM_ASSERT(stats);
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			memset(stats, 0, sizeof(ModuleMemoryStats));
+			stats->Total = GetModuleFootprint(module);
+			stats->Code = module->GetCodeSize();
+			stats->BSS = module->m_Exec->BSSSize;
+
+			rpm::Module::ControlSectionRef refs[RPM_MAX_CONTROL_SECTIONS];
+			u32 count = module->CollectControlSections(refs, module->CalcStringsEnd(refs));
+			for (u32 i = 0; i < count; i++) {
+				bool shared = false;
+				for (u32 j = 0; j < i; j++) {
+					shared |= refs[j].Start == refs[i].Start && refs[j].Size; //an empty section may start where another one does
+				}
+				if (shared) {
+					continue;
+				}
+				switch (refs[i].Kind) {
+					case rpm::Module::CTRLSECT_SYMBOLS:
+						stats->Symbols += refs[i].Size;
+						break;
+					case rpm::Module::CTRLSECT_EXPORT_HASHES:
+						stats->ExportHashTable += refs[i].Size;
+						break;
+					case rpm::Module::CTRLSECT_RELOCATIONS:
+						stats->Relocations += refs[i].Size;
+						break;
+					case rpm::Module::CTRLSECT_STRINGS:
+						stats->Strings += refs[i].Size;
 						break;
+					case rpm::Module::CTRLSECT_METADATA:
+						stats->MetaData += refs[i].Size;
+						break;
+					default:
+						break; //counted as headers
 				}
+			}
+			stats->Headers = stats->Total - stats->Code - stats->BSS - stats->Symbols - stats->ExportHashTable - stats->Relocations - stats->Strings - stats->MetaData;
 
-				module->UpdateModuleSizeAfterFixing(fixedSize);
-				CallModuleListeners(module, FIXED);
+			for (u32 i = 0; i < m_WorkMemoryCount; i++) {
+				if (m_WorkMemoryBlocks[i].Owner == module) {
+					stats->WorkMemory += m_WorkMemoryBlocks[i].Size;
+				}
+			}
+			WorkArenaHeader* arena = FindWorkArena(module);
+			if (arena) {
+				stats->WorkArena = arena->Size;
+				stats->WorkArenaUsed = arena->Used;
+			}
+			stats->Total += stats->WorkMemory + stats->WorkArena;
+		}
+
+		void ModuleManager::GetMemoryStats(ManagerMemoryStats* stats) {
+			RPM_ASSERT(stats);
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			memset(stats, 0, sizeof(ManagerMemoryStats));
+			for (rpm::Module* module = m_LastModule; module; module = module->GetPrevModule()) {
+				ModuleMemoryStats moduleStats;
+				GetModuleMemoryStats(module, &moduleStats);
+				ModuleMemoryStats* sum = &stats->Modules;
+				sum->Code += moduleStats.Code;
+				sum->BSS += moduleStats.BSS;
+				sum->Symbols += moduleStats.Symbols;
+				sum->ExportHashTable += moduleStats.ExportHashTable;
+				sum->Relocations += moduleStats.Relocations;
+				sum->Strings += moduleStats.Strings;
+				sum->MetaData += moduleStats.MetaData;
+				sum->Headers += moduleStats.Headers;
+				sum->WorkMemory += moduleStats.WorkMemory;
+				sum->WorkArena += moduleStats.WorkArena;
+				sum->WorkArenaUsed += moduleStats.WorkArenaUsed;
+				sum->Total += moduleStats.Total;
+				stats->ModuleCount++;
+			}
+			stats->UnownedWorkMemory = m_WorkMemorySize - stats->Modules.WorkMemory;
+			stats->InstanceMemory = m_InstanceMemorySize;
+			stats->InUse = m_MemoryInUse;
+			stats->PeakInUse = m_PeakMemorySize;
+		}
+
+		void ModuleManager::ResetMemoryPeak() {
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			m_PeakMemorySize = m_MemoryInUse;
+		}
+
+		size_t ModuleManager::GetModuleFootprint(rpm::Module* module) {
+			return module->GetModuleSize() + module->GetControlBlockSize();
+		}
+
+		void ModuleManager::UpdateMemoryPeak() {
+			if (m_MemoryInUse > m_PeakMemorySize) {
+				m_PeakMemorySize = m_MemoryInUse;
 			}
 		}
 
 		rpm::DllMainReturnCode ModuleManager::ControlModule(rpm::Module* module, rpm::DllMainReason reason) {
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			RPM_TRACE_SCOPE(m_Trace, TRACE_DLLMAIN, module, nullptr, reason);
 			RPM_DEBUG_PRINTF("ControlModule begin\n");
 			Symbol* sym = module->FindExportSymbol(RPM_DLLAPI_DLLMAIN_NAME);
 			if (sym) {
@@ -190,20 +1096,358 @@ namespace rpm {
 		}
 
 		void ModuleManager::LinkModule(rpm::Module* module) {
-			module->AllowLinking();
-			rpm::Module* other = m_LastModule;
-			while (other) {
-				if (other != module) {
-					if (module->LinkWithModule(other)) {
-						CallModuleListeners(other, EXEC_UPDATED);
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			LinkModuleAll(module);
+			CallModuleListeners(module, EXEC_UPDATED);
+		}
+
+		bool ModuleManager::LinkModuleAll(rpm::Module* module) {
+			LinkCursor cursor;
+			bool usedByStarted = false;
+			BeginLinkModule(module, &cursor);
+			while (LinkModuleStep(module, &cursor, &usedByStarted)) {
+			}
+			return usedByStarted;
+		}
+
+		bool ModuleManager::LinkModuleStep(rpm::Module* module, LinkCursor* cursor, bool* usedByStarted) {
+			u16 externCount = module->GetSymExternModuleCount();
+			if (cursor->NameIndex < externCount) {
+				if (m_NameCount) {
+					ModuleNameEntry* entry = FindNameEntry(Util::HashName(module->GetSymExternModuleName(cursor->NameIndex)));
+					if (entry->Module) {
+						*usedByStarted |= LinkModulePair(module, entry->Module);
+						cursor->LinkedByName = true;
 					}
 				}
-				other = other->GetPrevModule();
+				if (++cursor->NameIndex == externCount) {
+					cursor->LinkedByName = cursor->LinkedByName && module->GetReserveFlag(rpm::Module::ReserveFlag::RPM_RSVFLAG_ALL_IMPORTED);
+				}
+				return true;
+			}
+			rpm::Module* other = cursor->Other;
+			if (!other) {
+				EndLinkModule(cursor);
+				return false;
+			}
+			cursor->Other = other->GetPrevModule();
+			//Modules with all imports resolved can neither import from the module nor export anything it still needs
+			if (!cursor->LinkedByName || !other->GetReserveFlag(rpm::Module::ReserveFlag::RPM_RSVFLAG_ALL_IMPORTED)) {
+				*usedByStarted |= LinkModulePair(module, other);
+			}
+			return true;
+		}
+
+		bool ModuleManager::SetModuleName(rpm::Module* module, const char* name) {
+			RPM_ASSERT(module);
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			if (name) {
+				ModuleNameEntry* entry = m_NameTable ? FindNameEntry(Util::HashName(name)) : nullptr;
+				if (entry && entry->Module) {
+					return entry->Module == module;
+				}
+			}
+			RemoveModuleName(module);
+			return !name || InsertModuleName(Util::HashName(name), module);
+		}
+
+		rpm::Module* ModuleManager::FindModule(const char* name) {
+			RPM_SYNC_READ_SCOPE(m_ReadDomain);
+			if (!name || !m_NameCount) {
+				return nullptr;
+			}
+			return FindNameEntry(Util::HashName(name))->Module;
+		}
+
+		ModuleManager::ModuleNameEntry* ModuleManager::FindNameEntry(RPM_NAMEHASH hash) {
+			u32 mask = m_NameTableCapacity - 1;
+			u32 index = hash & mask;
+			while (m_NameTable[index].Module && m_NameTable[index].Hash != hash) {
+				index = (index + 1) & mask;
+			}
+			return &m_NameTable[index];
+		}
+
+		bool ModuleManager::InsertModuleName(RPM_NAMEHASH hash, rpm::Module* module) {
+			if (m_NameTable && FindNameEntry(hash)->Module) {
+				return false;
+			}
+			//The table is modified in place, FindModule reads it from a read scope
+			RPM_SYNC_EXCLUSIVE_SCOPE(m_ReadDomain);
+			//Keep the load factor at or below 3/4 so that probe sequences stay short
+			if ((m_NameCount + 1) * 4 > m_NameTableCapacity * 3) {
+				u32 newCapacity = m_NameTableCapacity ? m_NameTableCapacity * 2 : 16;
+				ModuleNameEntry* newTable = static_cast<ModuleNameEntry*>(AllocHeap(newCapacity * sizeof(ModuleNameEntry)));
+				if (!newTable) {
+					return false;
+				}
+				memset(newTable, 0, newCapacity * sizeof(ModuleNameEntry));
+				ModuleNameEntry* oldTable = m_NameTable;
+				u32 oldCapacity = m_NameTableCapacity;
+				m_NameTable = newTable;
+				m_NameTableCapacity = newCapacity;
+				for (u32 i = 0; i < oldCapacity; i++) {
+					if (oldTable[i].Module) {
+						*FindNameEntry(oldTable[i].Hash) = oldTable[i];
+					}
+				}
+				if (oldTable) {
+					m_ModuleHeap->Free(oldTable);
+				}
+				m_MemoryInUse += (newCapacity - oldCapacity) * sizeof(ModuleNameEntry);
+			}
+			ModuleNameEntry* entry = FindNameEntry(hash);
+			entry->Hash = hash;
+			entry->Module = module;
+			m_NameCount++;
+			UpdateMemoryPeak();
+			return true;
+		}
+
+		void ModuleManager::RemoveModuleName(rpm::Module* module) {
+			if (!m_NameCount) {
+				return;
+			}
+			ModuleNameEntry* entry = FindModuleNameEntry(module);
+			if (!entry) {
+				return;
+			}
+			RPM_SYNC_EXCLUSIVE_SCOPE(m_ReadDomain);
+			u32 mask = m_NameTableCapacity - 1;
+			u32 index = entry - m_NameTable;
+			//Shift back the following entries of the probe sequence so that lookups do not stop at the hole
+			u32 hole = index;
+			u32 next = (hole + 1) & mask;
+			while (m_NameTable[next].Module) {
+				u32 home = m_NameTable[next].Hash & mask;
+				if (((next - home) & mask) >= ((next - hole) & mask)) {
+					m_NameTable[hole] = m_NameTable[next];
+					hole = next;
+				}
+				next = (next + 1) & mask;
+			}
+			m_NameTable[hole].Module = nullptr;
+			m_NameCount--;
+			if (!m_NameCount) {
+				m_ModuleHeap->Free(m_NameTable);
+				m_MemoryInUse -= m_NameTableCapacity * sizeof(ModuleNameEntry);
+				m_NameTable = nullptr;
+				m_NameTableCapacity = 0;
+			}
+		}
+
+		ModuleManager::ModuleNameEntry* ModuleManager::FindModuleNameEntry(rpm::Module* module) {
+			for (u32 i = 0; i < m_NameTableCapacity; i++) {
+				if (m_NameTable[i].Module == module) {
+					return &m_NameTable[i];
+				}
+			}
+			return nullptr;
+		}
+
+		void ModuleManager::CreateWorkArena(rpm::Module* module) {
+			rpm::MetaData* meta = module->GetMetaData();
+			int size = meta ? meta->GetInt(module, RPM_METAVALUE_WORK_ARENA_SIZE, 0) : 0;
+			if (size <= 0) {
+				return;
+			}
+			//Allocated right after the module, so that it usually ends up next to the image instead of scattered small blocks
+			size_t allocSize = sizeof(WorkArenaHeader) + size;
+			WorkArenaHeader* arena = static_cast<WorkArenaHeader*>(AllocHeap(allocSize));
+			if (!arena) {
+				RPM_DEBUG_PRINTF("Could not allocate a work arena of %d bytes.\n", size);
+				return;
+			}
+			arena->Next = m_WorkArenaHead;
+			arena->Owner = module;
+			arena->Size = size;
+			arena->Used = 0;
+			arena->LiveCount = 0;
+			m_WorkArenaHead = arena;
+			m_MemoryInUse += allocSize;
+		}
+
+		ModuleManager::WorkArenaHeader* ModuleManager::FindWorkArena(rpm::Module* owner) {
+			for (WorkArenaHeader* arena = m_WorkArenaHead; arena; arena = arena->Next) {
+				if (arena->Owner == owner) {
+					return arena;
+				}
+			}
+			return nullptr;
+		}
+
+		ModuleManager::WorkArenaHeader* ModuleManager::FindWorkArenaOf(void* mem) {
+			u8* block = static_cast<u8*>(mem);
+			for (WorkArenaHeader* arena = m_WorkArenaHead; arena; arena = arena->Next) {
+				if (block >= arena->GetMemory() && block < arena->GetMemory() + arena->Size) {
+					return arena;
+				}
+			}
+			return nullptr;
+		}
+
+		void ModuleManager::ReleaseWorkArena(rpm::Module* module) {
+			for (WorkArenaHeader** link = &m_WorkArenaHead; *link; link = &(*link)->Next) {
+				WorkArenaHeader* arena = *link;
+				if (arena->Owner == module) {
+					*link = arena->Next;
+					m_MemoryInUse -= sizeof(WorkArenaHeader) + arena->Size;
+					m_ModuleHeap->Free(arena);
+					return;
+				}
+			}
+		}
+
+		void ModuleManager::ReleaseWorkMemory(rpm::Module* module) {
+			u32 i = 0;
+			while (i < m_WorkMemoryCount) {
+				WorkMemoryBlock* block = &m_WorkMemoryBlocks[i];
+				if (block->Owner == module) {
+					m_ModuleHeap->Free(block->Memory);
+					m_WorkMemorySize -= block->Size;
+					m_MemoryInUse -= block->Size;
+					RemoveWorkMemoryBlock(i);
+				}
+				else {
+					i++;
+				}
+			}
+		}
+
+		void ModuleManager::BeginLinkModule(rpm::Module* module, LinkCursor* cursor) {
+			cursor->NameIndex = 0;
+			cursor->LinkedByName = false;
+			cursor->Other = m_LastModule;
+			cursor->Next = m_LinkCursorHead;
+			m_LinkCursorHead = cursor;
+			module->AllowLinking();
+			if (m_ImportCache) {
+				m_ImportCache->BindCachedImports(this, module);
+			}
+		}
+
+		void ModuleManager::EndLinkModule(LinkCursor* cursor) {
+			for (LinkCursor** link = &m_LinkCursorHead; *link; link = &(*link)->Next) {
+				if (*link == cursor) {
+					*link = cursor->Next;
+					return;
+				}
+			}
+		}
+
+		bool ModuleManager::LinkModulePair(rpm::Module* module, rpm::Module* other) {
+			if (other != module) {
+				RPM_TRACE_SCOPE(m_Trace, TRACE_LINK, module, other, 0);
+				if (ImportFromModule(module, other) && other->IsStartDeferred() && !module->IsStartDeferred()) {
+					ActivateModule(other);
+				}
+				if (ImportFromModule(other, module)) {
+					CallModuleListeners(other, EXEC_UPDATED);
+					return other->GetReserveFlag(rpm::Module::ReserveFlag::RPM_RSVFLAG_MODULE_STARTED);
+				}
+			}
+			return false;
+		}
+
+		bool ModuleManager::ImportFromModule(rpm::Module* module, rpm::Module* other) {
+			if (!module->ImportModule(other, m_ImportCache)) {
+				return false;
+			}
+			AddModuleDependency(other, module);
+			return true;
+		}
+
+		void ModuleManager::LinkModuleImports(rpm::Module* module, rpm::Module* skip) {
+			module->AllowLinking();
+			if (m_ImportCache) {
+				m_ImportCache->BindCachedImports(this, module);
+			}
+			//The named extern modules usually resolve everything, so that the chain is not walked at all
+			u16 externCount = m_NameCount ? module->GetSymExternModuleCount() : 0;
+			for (u16 i = 0; i < externCount && !module->IsFullyImported(); i++) {
+				rpm::Module* other = FindNameEntry(Util::HashName(module->GetSymExternModuleName(i)))->Module;
+				if (other && other != module && other != skip && ImportFromModule(module, other) && other->IsStartDeferred() && !module->IsStartDeferred()) {
+					ActivateModule(other);
+				}
+			}
+			for (rpm::Module* other = m_LastModule; other && !module->IsFullyImported(); other = other->GetPrevModule()) {
+				if (other != module && other != skip && ImportFromModule(module, other) && other->IsStartDeferred() && !module->IsStartDeferred()) {
+					ActivateModule(other);
+				}
 			}
 			CallModuleListeners(module, EXEC_UPDATED);
 		}
 
+		u32 ModuleManager::FindModuleDependency(rpm::Module* exporter, rpm::Module* importer) {
+			u32 start = 0;
+			u32 end = m_DependencyCount;
+			while (start < end) {
+				u32 mid = start + ((end - start) >> 1);
+				ModuleDependency* dep = &m_Dependencies[mid];
+				if (dep->Exporter < exporter || (dep->Exporter == exporter && dep->Importer < importer)) {
+					start = mid + 1;
+				}
+				else {
+					end = mid;
+				}
+			}
+			return start;
+		}
+
+		void ModuleManager::AddModuleDependency(rpm::Module* exporter, rpm::Module* importer) {
+			u32 index = FindModuleDependency(exporter, importer);
+			if (index < m_DependencyCount && m_Dependencies[index].Exporter == exporter && m_Dependencies[index].Importer == importer) {
+				return;
+			}
+			if (m_DependencyCount == m_DependencyCapacity) {
+				u32 newCapacity = m_DependencyCapacity ? m_DependencyCapacity * 2 : 16;
+				ModuleDependency* newTable = static_cast<ModuleDependency*>(AllocHeap(newCapacity * sizeof(ModuleDependency)));
+				if (!newTable) {
+					RPM_DEBUG_PRINTF("Could not record the dependency of %p on %p.\n", importer, exporter);
+					m_DependencyOverflow = true;
+					return;
+				}
+				if (m_Dependencies) {
+					memcpy(newTable, m_Dependencies, m_DependencyCount * sizeof(ModuleDependency));
+					m_ModuleHeap->Free(m_Dependencies);
+				}
+				m_Dependencies = newTable;
+				m_MemoryInUse += (newCapacity - m_DependencyCapacity) * sizeof(ModuleDependency);
+				m_DependencyCapacity = newCapacity;
+				UpdateMemoryPeak();
+			}
+			memmove(&m_Dependencies[index + 1], &m_Dependencies[index], (m_DependencyCount - index) * sizeof(ModuleDependency));
+			m_Dependencies[index].Exporter = exporter;
+			m_Dependencies[index].Importer = importer;
+			m_DependencyCount++;
+		}
+
+		void ModuleManager::AddBoundDependencies(rpm::Module* module) {
+			for (rpm::Module* other = m_LastModule; other; other = other->GetPrevModule()) {
+				if (other != module && module->ImportsFrom(other)) {
+					AddModuleDependency(other, module);
+				}
+			}
+		}
+
+		void ModuleManager::RemoveModuleDependencies(rpm::Module* module) {
+			u32 count = 0;
+			for (u32 i = 0; i < m_DependencyCount; i++) {
+				if (m_Dependencies[i].Exporter != module && m_Dependencies[i].Importer != module) {
+					m_Dependencies[count++] = m_Dependencies[i];
+				}
+			}
+			m_DependencyCount = count;
+			if (!count && m_Dependencies) {
+				m_ModuleHeap->Free(m_Dependencies);
+				m_MemoryInUse -= m_DependencyCapacity * sizeof(ModuleDependency);
+				m_Dependencies = nullptr;
+				m_DependencyCapacity = 0;
+			}
+		}
+
 		void ModuleManager::UnlinkModule(rpm::Module* module) {
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
 			rpm::Module* other = m_LastModule;
 			while (other) {
 				if (other != module) {
@@ -216,50 +1460,110 @@ namespace rpm {
 		}
 
 		void ModuleManager::LinkModuleExtern(rpm::Module* module, const char* externModule) {
-			if (m_ExternRelocator) {
-				rpm::Module::RelocationSection* rel = module->GetRelocations();
-				if (rel) {
-					rpm::RelocationList* externals = rel->ExternalRelocations;
-					
-					if (externals) {
-						if (externModule) {
-							if (rel->ExternModules) {
-								u32 extModIndex = -1;
-
-								{
-									rpm::ModuleNameList* list = rel->ExternModules;
-									u32 extModCount = list->Count;
-									for (u32 i = 0; i < extModCount; i++) {
-										RPM_NAMEOFS nameofs = list->Entries[i];
-										if (strequal(externModule, module->GetString(nameofs))) {
-											extModIndex = i;
-											break;
-										}
-									}
-								}
-
-								if (extModIndex != -1) {
-									for (int i = 0; i < externals->Count; i++) {
-										Relocation* r = &externals->Relocations[i];
-
-										if (r->Target.ExternModuleIndex == extModIndex) {
-											m_ExternRelocator->ProcessRelocation(module, r);
-										}
-									}
-								}
-							}
-						}
-						else {
-							for (int i = 0; i < externals->Count; i++) {
-								Relocation* r = &externals->Relocations[i];
-
-								m_ExternRelocator->ProcessRelocation(module, r);
-							}
-						}
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			if (!externModule) {
+				ApplyExternRelocations(module, RPM_EXTERN_MODULE_ALL);
+				return;
+			}
+			rpm::Module::RelocationSection* rel = module->GetRelocations();
+			if (rel && rel->ExternModules) {
+				rpm::ModuleNameList* list = rel->ExternModules;
+				u32 extModCount = list->Count;
+				for (u32 i = 0; i < extModCount; i++) {
+					RPM_NAMEOFS nameofs = list->Entries[i];
+					if (strequal(externModule, module->GetString(nameofs))) {
+						ApplyExternRelocations(module, i);
+						break;
 					}
 				}
 			}
 		}
+
+		bool ModuleManager::ApplyExternRelocations(rpm::Module* module, u32 extModIndex) {
+			if (!m_ExternRelocator) {
+				return false;
+			}
+			rpm::Module::RelocationSection* rel = module->GetRelocations();
+			rpm::RelocationList* externals = rel ? rel->ExternalRelocations.Get() : nullptr;
+			if (!externals) {
+				return false;
+			}
+			bool applied = false;
+			for (int i = 0; i < externals->Count; i++) {
+				Relocation* r = &externals->Relocations[i];
+
+				if (extModIndex == RPM_EXTERN_MODULE_ALL || r->Target.ExternModuleIndex == extModIndex) {
+					m_ExternRelocator->ProcessRelocation(module, r);
+					applied = true;
+				}
+			}
+			//Recorded so that a restored snapshot performs them again on the image copy
+			SnapshotCapture* capture = applied && m_SnapshotCaptureHead ? FindSnapshotCapture(module) : nullptr;
+			if (capture) {
+				if (extModIndex == RPM_EXTERN_MODULE_ALL) {
+					capture->ExternAll = true;
+				}
+				else if ((extModIndex >> 5) < capture->ExternWordCount) {
+					capture->GetExternMask()[extModIndex >> 5] |= 1u << (extModIndex & 31);
+				}
+			}
+			return applied;
+		}
+
+		void ModuleManager::BindSnapshotHeap(exl::heap::Allocator* heap) {
+			RPM_SYNC_WRITE_SCOPE(m_WriteLock);
+			while (m_SnapshotCaptureHead) {
+				ReleaseSnapshotCapture(m_SnapshotCaptureHead->Module);
+			}
+			m_SnapshotHeap = heap;
+		}
+
+		void ModuleManager::CaptureModule(rpm::Module* module, rpm::FixLevel fixLevel) {
+			if (!m_SnapshotHeap) {
+				return;
+			}
+			if (module->GetControlBlockSize() || module->IsExternalImage() || !module->IsImageComplete()) {
+				RPM_DEBUG_PRINTF("Module %p can not be snapshotted.\n", module);
+				return;
+			}
+			rpm::Module::RelocationSection* rel = module->GetRelocations();
+			u32 externWordCount = rel && rel->ExternModules ? (rel->ExternModules->Count + 31) >> 5 : 0;
+			u32 size = module->GetModuleSize();
+			SnapshotCapture* capture = static_cast<SnapshotCapture*>(m_SnapshotHeap->Alloc(sizeof(SnapshotCapture) + externWordCount * sizeof(u32) + size));
+			if (!capture) {
+				RPM_DEBUG_PRINTF("Could not allocate a snapshot image of %d bytes.\n", size);
+				return;
+			}
+			capture->Module = module;
+			capture->Size = size;
+			capture->FixLevel = fixLevel;
+			capture->ExternAll = false;
+			capture->ExternWordCount = externWordCount;
+			memset(capture->GetExternMask(), 0, externWordCount * sizeof(u32));
+			memcpy(capture->GetImage(), module, size);
+			capture->Next = m_SnapshotCaptureHead;
+			m_SnapshotCaptureHead = capture;
+		}
+
+		ModuleManager::SnapshotCapture* ModuleManager::FindSnapshotCapture(rpm::Module* module) {
+			for (SnapshotCapture* capture = m_SnapshotCaptureHead; capture; capture = capture->Next) {
+				if (capture->Module == module) {
+					return capture;
+				}
+			}
+			return nullptr;
+		}
+
+		void ModuleManager::ReleaseSnapshotCapture(rpm::Module* module) {
+			for (SnapshotCapture** link = &m_SnapshotCaptureHead; *link; link = &(*link)->Next) {
+				SnapshotCapture* capture = *link;
+				if (capture->Module == module) {
+					*link = capture->Next;
+					m_SnapshotHeap->Free(capture);
+					return;
+				}
+			}
+		}
 	}
 }
 
@@ -0,0 +1,127 @@
+#ifndef __RPM_MODULESOURCE_CPP
+#define __RPM_MODULESOURCE_CPP
+
+#include "RPM_Types.h"
+#include "RPM_ModuleSource.h"
+
+#ifdef __linux__
+
+#include "RPM_Util.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace rpm {
+	namespace mgr {
+		FileReadSource::FileReadSource(size_t maxRead) {
+			RPM_ASSERT(maxRead);
+			m_Fd = -1;
+			m_Size = 0;
+			m_MaxRead = maxRead;
+		}
+
+		FileReadSource::~FileReadSource() {
+			Close();
+		}
+
+		bool FileReadSource::Open(const char* path) {
+			Close();
+			m_Fd = open(path, O_RDONLY | O_CLOEXEC);
+			if (m_Fd < 0) {
+				RPM_DEBUG_PRINTF("Could not open %s.\n", path);
+				return false;
+			}
+			struct stat st;
+			if (fstat(m_Fd, &st) != 0) {
+				Close();
+				return false;
+			}
+			m_Size = st.st_size;
+			return true;
+		}
+
+		void FileReadSource::Close() {
+			if (m_Fd >= 0) {
+				close(m_Fd);
+				m_Fd = -1;
+			}
+			m_Size = 0;
+		}
+
+		size_t FileReadSource::GetSize() {
+			return m_Size;
+		}
+
+		bool FileReadSource::Read(void* buffer, size_t offset, size_t size) {
+			if (m_Fd < 0 || offset + size > m_Size) {
+				return false;
+			}
+			u8* dest = static_cast<u8*>(buffer);
+			while (size) {
+				ssize_t count = pread(m_Fd, dest, size < m_MaxRead ? size : m_MaxRead, offset);
+				if (count <= 0) {
+					return false;
+				}
+				dest += count;
+				offset += count;
+				size -= count;
+			}
+			return true;
+		}
+
+		FileMapSource::FileMapSource() : FileReadSource(RPM_FILE_SOURCE_MAX_READ) {
+			m_Image = nullptr;
+			m_ImageSize = 0;
+		}
+
+		FileMapSource::~FileMapSource() {
+			UnmapImage();
+		}
+
+		rpm::init::ModuleAllocation FileMapSource::MapImage(const rpm::init::ModuleLayout* layout) {
+			RPM_ASSERT(!m_Image);
+			if (m_Fd < 0) {
+				return nullptr;
+			}
+			size_t pageSize = sysconf(_SC_PAGESIZE);
+			size_t imageSize = (layout->AllocSize + pageSize - 1) & ~(pageSize - 1);
+			int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+			#ifdef __x86_64__
+			flags |= MAP_32BIT; //module symbols hold 32-bit addresses
+			#endif
+			u8* image = static_cast<u8*>(mmap(nullptr, imageSize, PROT_READ | PROT_WRITE, flags, -1, 0));
+			if (image == MAP_FAILED) {
+				return nullptr;
+			}
+			//Only whole pages before the BSS can be backed by the file, the rest is read to the zero-filled reservation
+			size_t mappedSize = layout->BSSOffset & ~(pageSize - 1);
+			bool result = true;
+			if (mappedSize) {
+				result = mmap(image, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, m_Fd, 0) != MAP_FAILED;
+			}
+			result = result
+				&& Read(image + mappedSize, mappedSize, layout->BSSOffset - mappedSize)
+				&& Read(image + layout->HeaderOffset, layout->BSSOffset, layout->FileSize - layout->BSSOffset);
+			if (!result) {
+				munmap(image, imageSize);
+				return nullptr;
+			}
+			m_Image = image;
+			m_ImageSize = imageSize;
+			return image;
+		}
+
+		void FileMapSource::UnmapImage() {
+			if (m_Image) {
+				munmap(m_Image, m_ImageSize);
+				m_Image = nullptr;
+				m_ImageSize = 0;
+			}
+		}
+	}
+}
+
+#endif
+
+#endif
@@ -0,0 +1,237 @@
+#ifndef __RPM_OVERLAY_CPP
+#define __RPM_OVERLAY_CPP
+
+#include "RPM_Types.h"
+#include "RPM_Module.h"
+#include "RPM_Overlay.h"
+#include "RPM_ModuleManager.h"
+#include "RPM_Util.h"
+#include <cstring>
+
+namespace rpm {
+	namespace mgr {
+		OverlayManager::OverlayManager(ModuleManager* mgr, OverlayReader reader, size_t cacheBudget) {
+			RPM_ASSERT(mgr);
+			RPM_ASSERT(reader);
+			m_Manager = mgr;
+			m_Reader = reader;
+			memset(m_Slots, 0, sizeof(m_Slots));
+			m_SlotCount = 0;
+			m_CapturingSlot = 0xFFFFFFFF;
+			m_CacheHead = nullptr;
+			m_CacheTail = nullptr;
+			m_CacheSize = 0;
+			m_CacheBudget = cacheBudget;
+			mgr->BindModuleListener(this);
+			mgr->BindMemoryPressureHandler(this);
+		}
+
+		u32 OverlayManager::AddSlot(void* memory, size_t size) {
+			RPM_ASSERT(memory);
+			RPM_ASSERT(!(reinterpret_cast<size_t>(memory) & (RPM_MODULE_ALIGNMENT - 1)));
+			RPM_SYNC_WRITE_SCOPE(m_Manager->m_WriteLock);
+			if (m_SlotCount == RPM_OVERLAY_MAX_SLOTS) {
+				return -1;
+			}
+			Slot* slot = &m_Slots[m_SlotCount];
+			slot->Memory = memory;
+			slot->Size = size;
+			slot->Module = nullptr;
+			slot->Id = 0;
+			return m_SlotCount++;
+		}
+
+		rpm::Module* OverlayManager::LoadOverlay(u32 slot, u32 id, rpm::FixLevel fixLevel) {
+			RPM_ASSERT(slot < m_SlotCount);
+			RPM_SYNC_WRITE_SCOPE(m_Manager->m_WriteLock);
+			UnloadOverlay(slot);
+			m_Slots[slot].Id = id;
+			rpm::Module* module = nullptr;
+			CacheEntry* entry = FindCacheEntry(slot, id);
+			if (entry) {
+				module = RestoreOverlay(slot, entry);
+			}
+			if (!module) {
+				module = ReadOverlay(slot, id, fixLevel);
+			}
+			m_Slots[slot].Module = module;
+			return module;
+		}
+
+		rpm::Module* OverlayManager::RestoreOverlay(u32 slot, CacheEntry* entry) {
+			RPM_DEBUG_PRINTF("Restoring overlay %x from cache.\n", entry->Id);
+			memcpy(m_Slots[slot].Memory, entry->GetImage(), entry->ImageSize);
+			rpm::Module* module = m_Manager->RegisterDeferredImage(static_cast<rpm::Module*>(m_Slots[slot].Memory), entry->CacheId);
+			if (!module) {
+				DropCacheEntry(entry);
+				return nullptr;
+			}
+			UnlinkCacheEntry(entry);
+			LinkCacheEntry(entry);
+			m_Manager->ActivateModule(module);
+			return module;
+		}
+
+		rpm::Module* OverlayManager::ReadOverlay(u32 slot, u32 id, rpm::FixLevel fixLevel) {
+			Slot* s = &m_Slots[slot];
+			size_t fileSize = m_Reader(id, s->Memory, s->Size);
+			rpm::init::ModuleLayout layout;
+			if (!fileSize || !rpm::Module::QueryModuleLayout(s->Memory, fileSize, fileSize, &layout) || layout.AllocSize > s->Size) {
+				RPM_DEBUG_PRINTF("Overlay %x does not fit slot %d.\n", id, slot);
+				return nullptr;
+			}
+			rpm::Module* module = m_Manager->LoadModule(s->Memory, rpm::init::RPM_LOADFLAG_EXTERNAL_IMAGE);
+			if (!module) {
+				return nullptr;
+			}
+			//The image is cached from the READY event, after relocation and before the initializers
+			m_CapturingSlot = slot;
+			m_Manager->StartModuleDeferred(module, fixLevel);
+			m_CapturingSlot = 0xFFFFFFFF;
+			m_Manager->ActivateModule(module);
+			return module;
+		}
+
+		void OverlayManager::UnloadOverlay(u32 slot) {
+			RPM_ASSERT(slot < m_SlotCount);
+			RPM_SYNC_WRITE_SCOPE(m_Manager->m_WriteLock);
+			if (m_Slots[slot].Module) {
+				m_Manager->UnloadModule(m_Slots[slot].Module); //the slot is cleared by the UNLOADED event
+			}
+		}
+
+		void OverlayManager::SetCacheBudget(size_t budget) {
+			RPM_SYNC_WRITE_SCOPE(m_Manager->m_WriteLock);
+			m_CacheBudget = budget;
+			TrimCache(budget);
+		}
+
+		size_t OverlayManager::ReleaseCache(size_t size) {
+			RPM_SYNC_WRITE_SCOPE(m_Manager->m_WriteLock);
+			size_t oldSize = m_CacheSize;
+			TrimCache(size < m_CacheSize ? m_CacheSize - size : 0);
+			return oldSize - m_CacheSize;
+		}
+
+		size_t OverlayManager::OnMemoryPressure(rpm::mgr::ModuleManager*, size_t size) {
+			size_t released = ReleaseCache(size);
+			RPM_DEBUG_PRINTF("Released %zu bytes of cached overlays.\n", released);
+			return released;
+		}
+
+		void OverlayManager::OnEvent(rpm::mgr::ModuleManager*, rpm::Module* module, ModuleEvent event) {
+			switch (event) {
+				case READY:
+					if (m_CapturingSlot != 0xFFFFFFFF && m_Slots[m_CapturingSlot].Memory == module && module->IsStartDeferred()) {
+						CacheOverlay(m_CapturingSlot, module);
+					}
+					break;
+				case UNLOADED:
+					for (u32 i = 0; i < m_SlotCount; i++) {
+						if (m_Slots[i].Module == module) {
+							//Null unless the module is being replaced by ReloadModule
+							m_Slots[i].Module = m_Manager->m_Replacement;
+						}
+					}
+					//Images bound to the module's exports can not be restored anymore
+					for (CacheEntry* entry = m_CacheHead; entry;) {
+						CacheEntry* next = entry->Next;
+						for (u32 i = 0; i < entry->DependencyCount; i++) {
+							if (entry->Dependencies[i] == module) {
+								DropCacheEntry(entry);
+								break;
+							}
+						}
+						entry = next;
+					}
+					break;
+				default:
+					break;
+			}
+		}
+
+		OverlayManager::CacheEntry* OverlayManager::FindCacheEntry(u32 slot, u32 id) {
+			for (CacheEntry* entry = m_CacheHead; entry; entry = entry->Next) {
+				if (entry->SlotIdx == slot && entry->Id == id) {
+					return entry;
+				}
+			}
+			return nullptr;
+		}
+
+		void OverlayManager::CacheOverlay(u32 slot, rpm::Module* module) {
+			size_t imageSize = module->GetModuleSize();
+			size_t entrySize = CacheEntry::GetHeaderSize() + imageSize;
+			if (entrySize > m_CacheBudget) {
+				return;
+			}
+			rpm::Module* deps[RPM_OVERLAY_MAX_DEPENDENCIES];
+			u32 depCount = 0;
+			for (rpm::Module* other = m_Manager->m_LastModule; other; other = other->GetPrevModule()) {
+				if (other != module && module->ImportsFrom(other)) {
+					if (depCount == RPM_OVERLAY_MAX_DEPENDENCIES) {
+						RPM_DEBUG_PRINTF("Overlay %x has too many dependencies to be cached.\n", m_Slots[slot].Id);
+						return;
+					}
+					deps[depCount++] = other;
+				}
+			}
+			TrimCache(m_CacheBudget - entrySize);
+			//Not allocated through the manager, so that caching never evicts other images under memory pressure
+			CacheEntry* entry = static_cast<CacheEntry*>(m_Manager->m_ModuleHeap->Alloc(entrySize));
+			if (!entry) {
+				return;
+			}
+			entry->Id = m_Slots[slot].Id;
+			entry->SlotIdx = slot;
+			entry->CacheId = m_Manager->m_ImportCache ? m_Manager->m_ImportCache->GetModuleId(module) : 0;
+			entry->ImageSize = imageSize;
+			entry->DependencyCount = depCount;
+			memcpy(entry->Dependencies, deps, depCount * sizeof(rpm::Module*));
+			memcpy(entry->GetImage(), module, imageSize);
+			m_CacheSize += entrySize;
+			LinkCacheEntry(entry);
+		}
+
+		void OverlayManager::LinkCacheEntry(CacheEntry* entry) {
+			entry->Prev = nullptr;
+			entry->Next = m_CacheHead;
+			if (m_CacheHead) {
+				m_CacheHead->Prev = entry;
+			}
+			else {
+				m_CacheTail = entry;
+			}
+			m_CacheHead = entry;
+		}
+
+		void OverlayManager::UnlinkCacheEntry(CacheEntry* entry) {
+			if (entry->Prev) {
+				entry->Prev->Next = entry->Next;
+			}
+			else {
+				m_CacheHead = entry->Next;
+			}
+			if (entry->Next) {
+				entry->Next->Prev = entry->Prev;
+			}
+			else {
+				m_CacheTail = entry->Prev;
+			}
+		}
+
+		void OverlayManager::DropCacheEntry(CacheEntry* entry) {
+			UnlinkCacheEntry(entry);
+			m_CacheSize -= CacheEntry::GetHeaderSize() + entry->ImageSize;
+			m_Manager->m_ModuleHeap->Free(entry);
+		}
+
+		void OverlayManager::TrimCache(size_t maxSize) {
+			while (m_CacheSize > maxSize && m_CacheTail) {
+				DropCacheEntry(m_CacheTail);
+			}
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,222 @@
+#ifndef __RPM_PIPELINELOADER_CPP
+#define __RPM_PIPELINELOADER_CPP
+
+#include "RPM_Types.h"
+#include "RPM_PipelineLoader.h"
+
+#ifdef RPM_PIPELINE
+
+#include "RPM_Module.h"
+#include "RPM_ModuleManager.h"
+#include "RPM_ModuleSource.h"
+#include "RPM_ImportCache.h"
+#include "RPM_Util.h"
+#include <unistd.h>
+
+namespace rpm {
+	namespace mgr {
+		PipelineLoader::PipelineLoader(ModuleManager* mgr, u32 workerCount, u32 depth) {
+			RPM_ASSERT(mgr);
+			RPM_ASSERT(depth && depth <= RPM_PIPELINE_MAX_DEPTH);
+			if (!workerCount) {
+				long cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+				workerCount = cpuCount > 0 ? cpuCount : 1;
+			}
+			m_Manager = mgr;
+			m_WorkerCount = workerCount < RPM_PIPELINE_MAX_WORKERS ? workerCount : RPM_PIPELINE_MAX_WORKERS;
+			m_Depth = depth;
+			pthread_mutex_init(&m_Mutex, nullptr);
+			pthread_cond_init(&m_Cond, nullptr);
+			m_Paths = nullptr;
+			m_Count = 0;
+			m_WorkIndex = 0;
+		}
+
+		PipelineLoader::~PipelineLoader() {
+			pthread_cond_destroy(&m_Cond);
+			pthread_mutex_destroy(&m_Mutex);
+		}
+
+		u32 PipelineLoader::LoadModules(const char* const* paths, u32 count, rpm::FixLevel fixLevel, rpm::Module** modules) {
+			RPM_ASSERT(paths || !count);
+			m_Paths = paths;
+			m_Count = count;
+			m_WorkIndex = 0;
+			for (u32 i = 0; i < m_Depth; i++) {
+				m_Jobs[i].State = JOB_FREE;
+			}
+
+			//Fewer workers than requested only slow the pipeline down, but it can not run without any or without the I/O thread
+			pthread_t workers[RPM_PIPELINE_MAX_WORKERS];
+			u32 workerCount = 0;
+			while (workerCount < m_WorkerCount && pthread_create(&workers[workerCount], nullptr, WorkerThreadMain, this) == 0) {
+				workerCount++;
+			}
+			pthread_t ioThread;
+			if (!workerCount || pthread_create(&ioThread, nullptr, IOThreadMain, this) != 0) {
+				RPM_DEBUG_PRINTF("Could not start the pipeline threads, loading sequentially.\n");
+				//The workers that did start find no files left and exit
+				pthread_mutex_lock(&m_Mutex);
+				m_Count = 0;
+				pthread_cond_broadcast(&m_Cond);
+				pthread_mutex_unlock(&m_Mutex);
+				for (u32 i = 0; i < workerCount; i++) {
+					pthread_join(workers[i], nullptr);
+				}
+				return LoadModulesSequential(count, fixLevel, modules);
+			}
+
+			//The calling thread is the linker stage, which consumes the modules in list order
+			u32 loaded = 0;
+			for (u32 i = 0; i < count; i++) {
+				Job* job = GetJob(i);
+				pthread_mutex_lock(&m_Mutex);
+				//The workers have to be past the job before its slot can be reused
+				while (job->Index != i || i >= m_WorkIndex || (job->State != JOB_EXPANDED && job->State != JOB_FAILED)) {
+					pthread_cond_wait(&m_Cond, &m_Mutex);
+				}
+				JobState state = job->State;
+				pthread_mutex_unlock(&m_Mutex);
+
+				//The slot is only refilled once it is freed below, so the job can be read without the lock
+				rpm::Module* module = StartJob(job, state, fixLevel);
+				if (module) {
+					loaded++;
+				}
+				if (modules) {
+					modules[i] = module;
+				}
+
+				pthread_mutex_lock(&m_Mutex);
+				job->State = JOB_FREE;
+				pthread_cond_broadcast(&m_Cond);
+				pthread_mutex_unlock(&m_Mutex);
+			}
+
+			pthread_join(ioThread, nullptr);
+			for (u32 i = 0; i < workerCount; i++) {
+				pthread_join(workers[i], nullptr);
+			}
+			return loaded;
+		}
+
+		u32 PipelineLoader::LoadModulesSequential(u32 count, rpm::FixLevel fixLevel, rpm::Module** modules) {
+			Job* job = &m_Jobs[0];
+			u32 loaded = 0;
+			for (u32 i = 0; i < count; i++) {
+				JobState state = ReadModule(m_Paths[i], job) && ExpandModule(job) ? JOB_EXPANDED : JOB_FAILED;
+				rpm::Module* module = StartJob(job, state, fixLevel);
+				if (module) {
+					loaded++;
+				}
+				if (modules) {
+					modules[i] = module;
+				}
+			}
+			return loaded;
+		}
+
+		rpm::Module* PipelineLoader::StartJob(Job* job, JobState state, rpm::FixLevel fixLevel) {
+			rpm::init::ModuleAllocation data = job->Data;
+			rpm::Module* module = nullptr;
+			if (state == JOB_EXPANDED) {
+				RPM_SYNC_WRITE_SCOPE(m_Manager->m_WriteLock);
+				RPM_TRACE_EVENT(m_Manager->m_Trace, TRACE_LOAD, TRACE_BEGIN, nullptr, data, job->Flags);
+				module = m_Manager->RegisterModule(static_cast<rpm::Module*>(data));
+				RPM_TRACE_EVENT(m_Manager->m_Trace, TRACE_LOAD, TRACE_END, module, data, job->Flags);
+				if (module) {
+					if (m_Manager->m_ImportCache && job->CacheId) {
+						m_Manager->m_ImportCache->SetModuleId(module, job->CacheId);
+					}
+					m_Manager->StartModule(module, fixLevel);
+				}
+			}
+			else if (data) {
+				FreeModuleData(data);
+			}
+			return module;
+		}
+
+		void* PipelineLoader::IOThreadMain(void* param) {
+			PipelineLoader* self = static_cast<PipelineLoader*>(param);
+			for (u32 i = 0; i < self->m_Count; i++) {
+				Job* job = self->GetJob(i);
+				pthread_mutex_lock(&self->m_Mutex);
+				while (job->State != JOB_FREE) {
+					pthread_cond_wait(&self->m_Cond, &self->m_Mutex);
+				}
+				pthread_mutex_unlock(&self->m_Mutex);
+
+				//Free slots are not touched by the other stages
+				bool read = self->ReadModule(self->m_Paths[i], job);
+
+				pthread_mutex_lock(&self->m_Mutex);
+				job->Index = i;
+				job->State = read ? JOB_READ : JOB_FAILED;
+				pthread_cond_broadcast(&self->m_Cond);
+				pthread_mutex_unlock(&self->m_Mutex);
+			}
+			return nullptr;
+		}
+
+		void* PipelineLoader::WorkerThreadMain(void* param) {
+			PipelineLoader* self = static_cast<PipelineLoader*>(param);
+			while (true) {
+				Job* job = nullptr;
+				pthread_mutex_lock(&self->m_Mutex);
+				while (self->m_WorkIndex < self->m_Count) {
+					Job* next = self->GetJob(self->m_WorkIndex);
+					if (next->Index == self->m_WorkIndex && (next->State == JOB_READ || next->State == JOB_FAILED)) {
+						self->m_WorkIndex++;
+						pthread_cond_broadcast(&self->m_Cond);
+						if (next->State == JOB_READ) {
+							job = next;
+							job->State = JOB_EXPANDING;
+							break;
+						}
+						continue; //failed to read, left to the linker stage
+					}
+					pthread_cond_wait(&self->m_Cond, &self->m_Mutex);
+				}
+				pthread_mutex_unlock(&self->m_Mutex);
+				if (!job) {
+					return nullptr;
+				}
+
+				bool expanded = self->ExpandModule(job);
+
+				pthread_mutex_lock(&self->m_Mutex);
+				job->State = expanded ? JOB_EXPANDED : JOB_FAILED;
+				pthread_cond_broadcast(&self->m_Cond);
+				pthread_mutex_unlock(&self->m_Mutex);
+			}
+		}
+
+		bool PipelineLoader::ReadModule(const char* path, Job* job) {
+			FileReadSource source;
+			job->Flags = rpm::init::RPM_LOADFLAG_NONE;
+			job->Data = source.Open(path) ? m_Manager->ReadModuleImage(&source, &job->Layout, &job->Flags) : nullptr;
+			return job->Data != nullptr;
+		}
+
+		bool PipelineLoader::ExpandModule(Job* job) {
+			rpm::Module* module = rpm::Module::InitModule(job->Data, &job->Layout, job->Flags);
+			if (!module->Verify()) {
+				return false;
+			}
+			job->CacheId = m_Manager->m_ImportCache ? ImportCache::CalcModuleId(module) : 0;
+			//Internal relocations only depend on the module itself, unlike imports which are bound by the linker stage
+			module->RelocateInternal();
+			return true;
+		}
+
+		void PipelineLoader::FreeModuleData(rpm::init::ModuleAllocation data) {
+			RPM_SYNC_WRITE_SCOPE(m_Manager->m_WriteLock);
+			m_Manager->m_ModuleHeap->Free(data);
+		}
+	}
+}
+
+#endif
+
+#endif
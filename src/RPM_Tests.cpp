@@ -1,14 +1,72 @@
 #include <stdio.h>
 #include <cstdlib>
+#include <cstring>
+#include <chrono>
 
 #include "RPM_Types.h"
 #include "RPM_Module.h"
+#include "RPM_ModuleLoader.h"
+#include "RPM_Overlay.h"
+#include "RPM_AddressIndex.h"
+#include "RPM_PipelineLoader.h"
+#include "RPM_ModuleSource.h"
+#include "RPM_Util.h"
+#include "RPM_Version.h"
 #include "Heap/exl_HeapArea.h"
 
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(RPM_CONCURRENT) && defined(__linux__)
+#include <pthread.h>
+#define TEST_CONCURRENT
+#endif
+
 //#define TEST_DUMP_SYMBOLS
 
 #define MEMORY_MGR_HEAPSIZE 100000 //100kb heap
 
+#define TEST_MODULE_PATH "D:/_REWorkspace/CTRMapProjects/PMC/vfs/data/lib/ExtLib.Media.Cinepak.dll"
+#define TEST_DEPENDENCY_PATH "D:/_REWorkspace/CTRMapProjects/PMC/vfs/data/patches/NitroKernel.dll"
+
+#define TEST_INCREMENTAL_BUDGET 16
+
+#define TEST_STRESS_READERS 4
+#define TEST_STRESS_ITERATIONS 2000
+
+#define TEST_BENCH_HEAPSIZE 0x100000 //1MB heap
+#define TEST_BENCH_ROUNDS 16
+
+#define TEST_IMPORTCACHE_EXPORTERS 4
+#define TEST_IMPORTCACHE_EXPORTS 128
+#define TEST_IMPORTCACHE_SIZE 0x2000
+
+#define TEST_VTABLE_ENTRIES 8192
+#define TEST_VTABLE_FUNCTIONS 256
+
+#define TEST_RELOAD_EXPORTS 128
+#define TEST_RELOAD_KEPT_EXPORTS 96
+#define TEST_RELOAD_DEPENDENTS 16
+#define TEST_RELOAD_UNRELATED 64
+
+#define TEST_ARENA_SIZE 0x4000
+#define TEST_ARENA_BLOCKS 512
+#define TEST_ARENA_BLOCKSIZE 24
+
+#define TEST_ADDRINDEX_MODULES 128
+#define TEST_ADDRINDEX_FUNCTIONS 64
+#define TEST_ADDRINDEX_LOOKUPS 4096
+
+#define TEST_SOURCE_CODESIZE 0x100000 //1MB of code
+#define TEST_SOURCE_HEAPSIZE 0x300000 //3MB heap
+
+#define TEST_PIPELINE_MODULES 32
+#define TEST_PIPELINE_EXPORTS 4
+#define TEST_PIPELINE_ENTRIES 4096
+#define TEST_PIPELINE_HEAPSIZE 0x200000 //2MB heap
+
 void Dump(void* fileBuf, rpm::Module* mod) {
 	#ifdef TEST_DUMP_SYMBOLS
 
@@ -48,6 +106,10 @@ void DumpMem(exl::heap::HeapArea* mgr, const char* path) {
 void* ReadFile(const char* path, exl::heap::HeapArea* memMgr) {
 	FILE* file = fopen(path, "rb");
 
+	if (!file) {
+		return nullptr;
+	}
+
 	fseek(file, 0, SEEK_END);
 	long len = ftell(file);
 
@@ -65,13 +127,2184 @@ void* ReadFile(const char* path, exl::heap::HeapArea* memMgr) {
 	return fileBuf;
 }
 
-int main(void) {
+/**
+ * Allocates memory for a test heap. Module symbols hold 32-bit addresses, so on 64-bit hosts the memory is mapped into the low 4GB.
+ */
+void* AllocTestHeapMemory(size_t size) {
+	#if defined(__linux__) && defined(__x86_64__)
+	void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+	return mem == MAP_FAILED ? nullptr : mem;
+	#else
+	return malloc(size);
+	#endif
+}
+
+void FreeTestHeapMemory(void* mem, size_t size) {
+	#if defined(__linux__) && defined(__x86_64__)
+	munmap(mem, size);
+	#else
+	free(mem);
+	#endif
+}
+
+/**
+ * In-memory layout of the rpm::Module file header.
+ */
+struct TestModuleHeader {
+	u32		Magic;
+	u32		Size;
+	void*	Exec;
+	u32		ReserveFlags;
+	void*	PrevModule;
+	void*	NextModule;
+};
+
+/**
+ * Metadata value of a synthetic module. The value is a STRING if StringValue is set, otherwise an INT.
+ */
+struct TestMetaValue {
+	const char*	Name;
+	const char*	StringValue;
+	int			IntValue;
+};
+
+/**
+ * Description of a synthetic module for host tests that do not depend on linker output.
+ */
+struct TestModuleDesc {
+	/**
+	 * Size of the code segment. Must hold PointerTableSize + ImportCount words.
+	 */
+	u32				CodeSize = 0;
+	u32				BSSSize = 0;
+	const char**	Exports = nullptr;
+	u32				ExportCount = 0;
+	/**
+	 * Each import gets one ABS32 relocation after the pointer table.
+	 */
+	const char**	Imports = nullptr;
+	u32				ImportCount = 0;
+	/**
+	 * Number of consecutive ABS32 internal relocations at the start of the code, pointing at the exports in turn.
+	 */
+	u32				PointerTableSize = 0;
+	const TestMetaValue*	MetaValues = nullptr;
+	u32						MetaValueCount = 0;
+	/**
+	 * Names of the modules that the imports come from, listed in the symbol section.
+	 */
+	const char**			ExternModules = nullptr;
+	u32						ExternModuleCount = 0;
+};
+
+static size_t TestAlign(size_t value) {
+	return (value + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+}
+
+static void TestSortSymbolsByHash(rpm::Symbol* symbols, u32 count) {
+	for (u32 i = 1; i < count; i++) {
+		rpm::Symbol sym = symbols[i];
+		u32 j = i;
+		while (j > 0 && symbols[j - 1].Addr.ImportHash > sym.Addr.ImportHash) {
+			symbols[j] = symbols[j - 1];
+			j--;
+		}
+		symbols[j] = sym;
+	}
+}
+
+/**
+ * Builds a module file image with the native structure layout of the host.
+ * Exports are ARM functions spaced 4 bytes apart from the end of the relocated words.
+ */
+void* BuildTestModule(exl::heap::Allocator* heap, const TestModuleDesc* desc, size_t* pFileSize) {
+	u32 symbolCount = desc->ExportCount + desc->ImportCount;
+	size_t stringsSize = 0;
+	for (u32 i = 0; i < desc->ExportCount; i++) {
+		stringsSize += strlen(desc->Exports[i]) + 1;
+	}
+	for (u32 i = 0; i < desc->ImportCount; i++) {
+		stringsSize += strlen(desc->Imports[i]) + 1;
+	}
+	for (u32 i = 0; i < desc->MetaValueCount; i++) {
+		stringsSize += strlen(desc->MetaValues[i].Name) + 1;
+		if (desc->MetaValues[i].StringValue) {
+			stringsSize += strlen(desc->MetaValues[i].StringValue) + 1;
+		}
+	}
+	for (u32 i = 0; i < desc->ExternModuleCount; i++) {
+		stringsSize += strlen(desc->ExternModules[i]) + 1;
+	}
+
+	size_t codeOffset = TestAlign(sizeof(TestModuleHeader));
+	size_t execOffset = TestAlign(codeOffset + desc->CodeSize);
+	size_t infoOffset = TestAlign(sizeof(rpm::Module::DllExec));
+	size_t symOffset = infoOffset + TestAlign(sizeof(rpm::Module::InfoSection));
+	size_t hashOffset = symOffset + TestAlign(sizeof(rpm::Module::SymbolSection) + symbolCount * sizeof(rpm::Symbol));
+	size_t importHashOffset = hashOffset + TestAlign(desc->ExportCount * sizeof(rpm::RPM_NAMEHASH));
+	size_t importAddrOffset = importHashOffset + TestAlign(desc->ImportCount * sizeof(rpm::RPM_NAMEHASH));
+	size_t importModuleOffset = importAddrOffset + TestAlign(desc->ImportCount * sizeof(u32));
+	size_t relOffset = importModuleOffset + TestAlign(desc->ImportCount * sizeof(u32));
+	size_t internalOffset = relOffset + TestAlign(sizeof(rpm::Module::RelocationSection));
+	size_t importRelOffset = internalOffset + TestAlign(sizeof(rpm::RelocationList) + desc->PointerTableSize * sizeof(rpm::Relocation));
+	size_t externOffset = importRelOffset + TestAlign(sizeof(rpm::RelocationList) + desc->ImportCount * sizeof(rpm::Relocation));
+	size_t strOffset = externOffset;
+	if (desc->ExternModuleCount) {
+		strOffset += TestAlign(sizeof(rpm::ModuleNameList) + desc->ExternModuleCount * sizeof(rpm::RPM_NAMEOFS));
+	}
+	size_t metaOffset = TestAlign(strOffset + sizeof(rpm::Module::StringSection) + stringsSize);
+	size_t headerSectionSize = metaOffset;
+	if (desc->MetaValueCount) {
+		headerSectionSize += TestAlign(sizeof(rpm::Module::MetaDataSection) + desc->MetaValueCount * sizeof(rpm::MetaValue));
+	}
+	size_t fileSize = execOffset + headerSectionSize;
+
+	u8* file = static_cast<u8*>(heap->Alloc(fileSize));
+	memset(file, 0, fileSize);
+	u8* dlxh = file + execOffset;
+
+	TestModuleHeader* header = reinterpret_cast<TestModuleHeader*>(file);
+	header->Magic = RPM_MAGIC;
+	header->Size = fileSize + desc->BSSSize;
+	header->Exec = reinterpret_cast<void*>(execOffset);
+
+	u8* code = file + codeOffset;
+	for (u32 i = 0; i < desc->CodeSize; i++) {
+		code[i] = i;
+	}
+
+	rpm::Module::DllExec* exec = reinterpret_cast<rpm::Module::DllExec*>(dlxh);
+	exec->Magic = DLLEXEC_MAGIC;
+	exec->Version = LIBRPM_VERSION;
+	exec->Info = reinterpret_cast<rpm::Module::InfoSection*>(dlxh + infoOffset);
+	exec->BSSSize = desc->BSSSize;
+	exec->HeaderSectionSize = headerSectionSize;
+
+	rpm::Module::InfoSection* info = reinterpret_cast<rpm::Module::InfoSection*>(dlxh + infoOffset);
+	info->Magic = INFO_MAGIC;
+	info->Symbols = reinterpret_cast<rpm::Module::SymbolSection*>(dlxh + symOffset);
+	info->Relocations = reinterpret_cast<rpm::Module::RelocationSection*>(dlxh + relOffset);
+	info->Strings = reinterpret_cast<rpm::Module::StringSection*>(dlxh + strOffset);
+	info->CodeOffset = codeOffset;
+	info->CodeSize = desc->CodeSize;
+
+	rpm::Module::StringSection* strings = reinterpret_cast<rpm::Module::StringSection*>(dlxh + strOffset);
+	strings->Magic = STR0_MAGIC;
+	rpm::RPM_NAMEOFS nameOffset = 0;
+
+	rpm::Module::SymbolSection* symbols = reinterpret_cast<rpm::Module::SymbolSection*>(dlxh + symOffset);
+	symbols->Magic = SYM0_MAGIC;
+	symbols->FirstExportSymbolIdx = desc->ExportCount ? 0 : 0xFFFF;
+	symbols->ExportSymbolCount = desc->ExportCount;
+	symbols->FirstImportSymbolIdx = desc->ImportCount ? desc->ExportCount : 0xFFFF;
+	symbols->ImportSymbolCount = desc->ImportCount;
+	symbols->ExportSymbolHashTable = reinterpret_cast<rpm::RPM_NAMEHASH*>(dlxh + hashOffset);
+	symbols->SymbolCount = symbolCount;
+
+	u32 firstExportAddr = (desc->PointerTableSize + desc->ImportCount) * sizeof(u32);
+	for (u32 i = 0; i < desc->ExportCount; i++) {
+		rpm::Symbol* sym = &symbols->Symbols[i];
+		strcpy(&strings->Strings[nameOffset], desc->Exports[i]);
+		sym->Name = nameOffset;
+		sym->Size = sizeof(u32);
+		sym->Addr.ImportHash = rpm::Util::HashName(desc->Exports[i]); //Sort key, replaced below
+		sym->Type = rpm::RPM_SYMTYPE_FUNCTION_ARM;
+		sym->Attr = rpm::RPM_SYMATTR_EXPORT;
+		nameOffset += strlen(desc->Exports[i]) + 1;
+	}
+	TestSortSymbolsByHash(symbols->Symbols, desc->ExportCount);
+	rpm::RPM_NAMEHASH* hashTable = reinterpret_cast<rpm::RPM_NAMEHASH*>(dlxh + hashOffset);
+	for (u32 i = 0; i < desc->ExportCount; i++) {
+		hashTable[i] = symbols->Symbols[i].Addr.ImportHash;
+		symbols->Symbols[i].Addr.RawAddress = firstExportAddr + i * sizeof(u32);
+	}
+
+	rpm::Symbol* importSymbols = &symbols->Symbols[desc->ExportCount];
+	for (u32 i = 0; i < desc->ImportCount; i++) {
+		rpm::Symbol* sym = &importSymbols[i];
+		strcpy(&strings->Strings[nameOffset], desc->Imports[i]);
+		sym->Name = nameOffset;
+		sym->Addr.ImportHash = rpm::Util::HashName(desc->Imports[i]);
+		sym->Attr = rpm::RPM_SYMATTR_IMPORT;
+		nameOffset += strlen(desc->Imports[i]) + 1;
+	}
+	TestSortSymbolsByHash(importSymbols, desc->ImportCount);
+	if (desc->ImportCount) {
+		rpm::RPM_NAMEHASH* importHashTable = reinterpret_cast<rpm::RPM_NAMEHASH*>(dlxh + importHashOffset);
+		symbols->ImportSymbolHashTable = importHashTable;
+		symbols->ImportAddressTable = reinterpret_cast<u32*>(dlxh + importAddrOffset);
+		symbols->ImportModuleTable = reinterpret_cast<u32*>(dlxh + importModuleOffset);
+		for (u32 i = 0; i < desc->ImportCount; i++) {
+			importHashTable[i] = importSymbols[i].Addr.ImportHash;
+		}
+	}
+
+	if (desc->ExternModuleCount) {
+		rpm::ModuleNameList* externs = reinterpret_cast<rpm::ModuleNameList*>(dlxh + externOffset);
+		symbols->ExternModules = reinterpret_cast<rpm::ModuleNameList*>(dlxh + externOffset);
+		externs->Count = desc->ExternModuleCount;
+		for (u32 i = 0; i < desc->ExternModuleCount; i++) {
+			strcpy(&strings->Strings[nameOffset], desc->ExternModules[i]);
+			externs->Entries[i] = nameOffset;
+			nameOffset += strlen(desc->ExternModules[i]) + 1;
+		}
+	}
+
+	if (desc->MetaValueCount) {
+		rpm::Module::MetaDataSection* meta = reinterpret_cast<rpm::Module::MetaDataSection*>(dlxh + metaOffset);
+		info->MetaValueSection = reinterpret_cast<rpm::Module::MetaDataSection*>(dlxh + metaOffset);
+		meta->Magic = META_MAGIC;
+		meta->MetaValues.ValueCount = desc->MetaValueCount;
+		for (u32 i = 0; i < desc->MetaValueCount; i++) {
+			const TestMetaValue* src = &desc->MetaValues[i];
+			rpm::MetaValue* value = &meta->MetaValues.Values[i];
+			strcpy(&strings->Strings[nameOffset], src->Name);
+			value->Name = nameOffset;
+			nameOffset += strlen(src->Name) + 1;
+			if (src->StringValue) {
+				strcpy(&strings->Strings[nameOffset], src->StringValue);
+				value->Type = rpm::MetaValueType::STRING;
+				value->StringValue = nameOffset;
+				nameOffset += strlen(src->StringValue) + 1;
+			}
+			else {
+				value->Type = rpm::MetaValueType::INT;
+				value->IntValue = src->IntValue;
+			}
+		}
+	}
+
+	rpm::Module::RelocationSection* rels = reinterpret_cast<rpm::Module::RelocationSection*>(dlxh + relOffset);
+	rels->Magic = REL0_MAGIC;
+	if (desc->PointerTableSize && desc->ExportCount) {
+		rpm::RelocationList* internals = reinterpret_cast<rpm::RelocationList*>(dlxh + internalOffset);
+		rels->InternalRelocations = reinterpret_cast<rpm::RelocationList*>(dlxh + internalOffset);
+		internals->Count = desc->PointerTableSize;
+		for (u32 i = 0; i < desc->PointerTableSize; i++) {
+			rpm::Relocation* r = &internals->Relocations[i];
+			r->Target.Offset = i * sizeof(u32);
+			r->Target.ExternModuleIndex = 0xFF;
+			r->Target.RelProcType = rpm::RPM_REL_TGTTYPE_OFFSET;
+			r->Source.SymbNo = i % desc->ExportCount;
+		}
+	}
+	if (desc->ImportCount) {
+		rpm::RelocationList* importRels = reinterpret_cast<rpm::RelocationList*>(dlxh + importRelOffset);
+		rels->InternalImportRelocations = reinterpret_cast<rpm::RelocationList*>(dlxh + importRelOffset);
+		importRels->Count = desc->ImportCount;
+		for (u32 i = 0; i < desc->ImportCount; i++) {
+			rpm::Relocation* r = &importRels->Relocations[i];
+			r->Target.Offset = (desc->PointerTableSize + i) * sizeof(u32);
+			r->Target.ExternModuleIndex = 0xFF;
+			r->Target.RelProcType = rpm::RPM_REL_TGTTYPE_OFFSET;
+			r->Source.SymbNo = desc->ExportCount + i;
+		}
+	}
+
+	if (pFileSize) {
+		*pFileSize = fileSize;
+	}
+	return file;
+}
+
+/**
+ * Heap memory of a test, freed when it goes out of scope.
+ */
+struct TestHeapMemory {
+	void*	Memory;
+	size_t	Size;
+
+	TestHeapMemory(size_t size) {
+		Memory = AllocTestHeapMemory(size);
+		Size = size;
+	}
+
+	~TestHeapMemory() {
+		FreeTestHeapMemory(Memory, Size);
+	}
+};
+
+/**
+ * A module manager on a test heap of its own, the common setup of the synthetic tests.
+ * Members are destroyed in reverse order, so the memory outlives the heap and the manager.
+ */
+struct TestEnvironment {
+	TestHeapMemory			Memory;
+	exl::heap::HeapArea		Heap;
+	rpm::mgr::ModuleManager	Mgr;
+
+	TestEnvironment(const char* name, size_t size = MEMORY_MGR_HEAPSIZE) : Memory(size), Heap(name, Memory.Memory, size), Mgr(&Heap) {
+	}
+
+	/**
+	 * Builds a module file on the test heap.
+	 */
+	void* Build(const TestModuleDesc* desc) {
+		return BuildTestModule(&Heap, desc, nullptr);
+	}
+
+	/**
+	 * Builds a module file on the test heap and loads it in place.
+	 */
+	rpm::Module* Load(const TestModuleDesc* desc) {
+		return Mgr.LoadModule(Build(desc));
+	}
+};
+
+/**
+ * Prints the verdict of a test. Benchmarks print their timings on a line of their own, since they do not decide it.
+ */
+void TestReport(const char* name, bool result) {
+	printf("%s: %s.\n", name, result ? "OK" : "FAILED");
+}
+
+typedef void* (*TestModuleFactory)(exl::heap::HeapArea* heap, const void* param);
+
+void* ReadTestModuleFile(exl::heap::HeapArea* heap, const void* param) {
+	return ReadFile(static_cast<const char*>(param), heap);
+}
+
+void* BuildTestModuleFromDesc(exl::heap::HeapArea* heap, const void* param) {
+	return BuildTestModule(heap, static_cast<const TestModuleDesc*>(param), nullptr);
+}
+
+/**
+ * Loads a module synchronously and incrementally into identically laid out heaps and compares the results byte for byte.
+ */
+bool TestIncrementalLoad(TestModuleFactory factory, const void* param) {
+	void* heapMem = AllocTestHeapMemory(MEMORY_MGR_HEAPSIZE);
+	void* syncImage = malloc(MEMORY_MGR_HEAPSIZE);
+	rpm::Module* syncModule;
+	size_t syncSize;
+
+	memset(heapMem, 0, MEMORY_MGR_HEAPSIZE);
+	{
+		exl::heap::HeapArea heap("RPMTestsSync", heapMem, MEMORY_MGR_HEAPSIZE);
+		rpm::mgr::ModuleManager mgr(&heap);
+
+		syncModule = mgr.LoadModule(factory(&heap, param));
+		mgr.StartModule(syncModule, rpm::FixLevel::NONE);
+		syncSize = syncModule->GetModuleSize();
+		memcpy(syncImage, syncModule, syncSize);
+	}
+
+	memset(heapMem, 0, MEMORY_MGR_HEAPSIZE);
+	bool result;
+	{
+		exl::heap::HeapArea heap("RPMTestsIncremental", heapMem, MEMORY_MGR_HEAPSIZE);
+		rpm::mgr::ModuleManager mgr(&heap);
+
+		rpm::mgr::ModuleLoader loader(&mgr, factory(&heap, param), rpm::FixLevel::NONE);
+		u32 stepCount = 1;
+		while (!loader.Step(TEST_INCREMENTAL_BUDGET)) {
+			stepCount++;
+		}
+		rpm::Module* incModule = loader.GetModule();
+
+		result = incModule == syncModule && incModule->GetModuleSize() == syncSize && memcmp(incModule, syncImage, syncSize) == 0;
+		printf("Incremental load finished in %d steps of %d units, %s.\n", stepCount, TEST_INCREMENTAL_BUDGET, result ? "identical to synchronous load" : "MISMATCH with synchronous load");
+	}
+
+	free(syncImage);
+	FreeTestHeapMemory(heapMem, MEMORY_MGR_HEAPSIZE);
+	return result;
+}
+
+#ifdef TEST_CONCURRENT
+
+struct StressTestState {
+	rpm::mgr::ModuleManager*	Manager;
+	u32							Stop;
+	u32							Lookups;
+};
+
+void* StressTestReader(void* param) {
+	StressTestState* state = static_cast<StressTestState*>(param);
+	u32 lookups = 0;
+	while (!__atomic_load_n(&state->Stop, __ATOMIC_ACQUIRE)) {
+		if (state->Manager->FindProcAddress("StressExport1", nullptr)) {
+			lookups++;
+		}
+		rpm::mgr::ModuleReadScope scope(state->Manager);
+		for (rpm::Module* mod = state->Manager->GetLastModule(); mod; mod = mod->GetPrevModule()) {
+			if (mod->GetProcAddress("StressExport0")) {
+				lookups++;
+			}
+		}
+	}
+	__atomic_fetch_add(&state->Lookups, lookups, __ATOMIC_RELAXED);
+	return nullptr;
+}
+
+/**
+ * Loads, fixes and unloads modules on one thread while others look up symbols and walk the module chain.
+ * Meant to be run in a ThreadSanitizer build (RPM_SANITIZE_THREAD).
+ */
+bool TestConcurrentStress() {
+	TestEnvironment env("RPMTestsStress");
+	rpm::mgr::ModuleManager& mgr = env.Mgr;
+
+	const char* exports[] = { "StressExport0", "StressExport1", "StressExport2" };
+	const char* imports[] = { "StressExport2" };
+	TestModuleDesc desc = { 0x40, 0x20, exports, NELEMS(exports), nullptr, 0, 4 };
+	TestModuleDesc importerDesc = { 0x40, 0x20, exports, NELEMS(exports), imports, NELEMS(imports), 4 };
+
+	StressTestState state;
+	state.Manager = &mgr;
+	state.Stop = 0;
+	state.Lookups = 0;
+
+	rpm::Module* persistent = env.Load(&desc);
+	mgr.StartModule(persistent, rpm::FixLevel::NONE);
+
+	pthread_t readers[TEST_STRESS_READERS];
+	for (u32 i = 0; i < TEST_STRESS_READERS; i++) {
+		pthread_create(&readers[i], nullptr, StressTestReader, &state);
+	}
+
+	bool result = true;
+	for (u32 i = 0; i < TEST_STRESS_ITERATIONS; i++) {
+		rpm::Module* mod = env.Load(&importerDesc);
+		if (!mod) {
+			result = false;
+			break;
+		}
+		mgr.StartModule(mod, (i & 1) ? rpm::FixLevel::ALL_NONCODE : rpm::FixLevel::INTERNAL_RELOCATIONS);
+		mgr.UnloadModule(mod);
+	}
+
+	__atomic_store_n(&state.Stop, 1, __ATOMIC_RELEASE);
+	for (u32 i = 0; i < TEST_STRESS_READERS; i++) {
+		pthread_join(readers[i], nullptr);
+	}
+	mgr.UnloadModule(persistent);
+
+	printf("Concurrent stress test: %d load cycles, %d lookups.\n", TEST_STRESS_ITERATIONS, state.Lookups);
+	TestReport("Concurrent stress test", result);
+	return result;
+}
+
+static char g_PipelineNames[TEST_PIPELINE_MODULES][TEST_PIPELINE_EXPORTS][24];
+static const char* g_PipelineNamePtrs[TEST_PIPELINE_MODULES][TEST_PIPELINE_EXPORTS];
+
+/**
+ * Checks that a module of the pipeline test chain has its pointer table and imports bound to the right exports.
+ */
+static bool TestCheckPipelineModule(rpm::Module* module, rpm::Module* prev) {
+	if (!module) {
+		return false;
+	}
+	u32* code = reinterpret_cast<u32*>(module->GetCode());
+	rpm::Module::SymbolSection* symbols = module->GetSymbols();
+	for (u32 i = 0; i < TEST_PIPELINE_ENTRIES; i++) {
+		const char* name = module->GetString(symbols->Symbols[i % TEST_PIPELINE_EXPORTS].Name);
+		if (code[i] != static_cast<u32>(reinterpret_cast<size_t>(module->GetProcAddress(name)))) {
+			return false;
+		}
+	}
+	if (prev) {
+		for (u32 i = 0; i < TEST_PIPELINE_EXPORTS; i++) {
+			const char* name = module->GetString(symbols->Symbols[symbols->FirstImportSymbolIdx + i].Name);
+			if (code[TEST_PIPELINE_ENTRIES + i] != static_cast<u32>(reinterpret_cast<size_t>(prev->GetProcAddress(name)))) {
+				return false;
+			}
+		}
+		return module->ImportsFrom(prev);
+	}
+	return true;
+}
+
+/**
+ * Loads a chain of module files, each importing from the previous one, first one by one and then through a PipelineLoader.
+ */
+bool TestPipelineLoad() {
+	char paths[TEST_PIPELINE_MODULES][32];
+	const char* pathPtrs[TEST_PIPELINE_MODULES];
+	void* scratchMem = AllocTestHeapMemory(TEST_PIPELINE_HEAPSIZE);
+	exl::heap::HeapArea scratch("RPMTestsPipelineFiles", scratchMem, TEST_PIPELINE_HEAPSIZE);
+	bool result = true;
+
+	for (u32 k = 0; k < TEST_PIPELINE_MODULES; k++) {
+		for (u32 i = 0; i < TEST_PIPELINE_EXPORTS; i++) {
+			snprintf(g_PipelineNames[k][i], sizeof(g_PipelineNames[k][i]), "PipeExport%d_%d", k, i);
+			g_PipelineNamePtrs[k][i] = g_PipelineNames[k][i];
+		}
+		TestModuleDesc desc = { (TEST_PIPELINE_ENTRIES + 2 * TEST_PIPELINE_EXPORTS) * sizeof(u32), 0x100, g_PipelineNamePtrs[k], TEST_PIPELINE_EXPORTS,
+			k ? g_PipelineNamePtrs[k - 1] : nullptr, k ? TEST_PIPELINE_EXPORTS : 0u, TEST_PIPELINE_ENTRIES };
+		size_t fileSize;
+		void* file = BuildTestModule(&scratch, &desc, &fileSize);
+
+		strcpy(paths[k], "/tmp/rpmpipeXXXXXX");
+		int fd = mkstemp(paths[k]);
+		pathPtrs[k] = paths[k];
+		result &= fd >= 0 && write(fd, file, fileSize) == (ssize_t)fileSize;
+		if (fd >= 0) {
+			close(fd);
+		}
+		scratch.Free(file);
+	}
+	FreeTestHeapMemory(scratchMem, TEST_PIPELINE_HEAPSIZE);
+
+	rpm::Module* modules[TEST_PIPELINE_MODULES];
+	long long sequentialTime = 0;
+	long long pipelineTime = 0;
+	if (result) {
+		TestEnvironment env("RPMTestsPipelineSeq", TEST_PIPELINE_HEAPSIZE);
+		rpm::mgr::ModuleManager& mgr = env.Mgr;
+		auto start = std::chrono::steady_clock::now();
+		for (u32 k = 0; k < TEST_PIPELINE_MODULES; k++) {
+			modules[k] = mgr.LoadModule(ReadFile(pathPtrs[k], &env.Heap));
+			if (modules[k]) {
+				mgr.StartModule(modules[k], rpm::FixLevel::NONE);
+			}
+		}
+		auto end = std::chrono::steady_clock::now();
+		sequentialTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+		for (u32 k = 0; k < TEST_PIPELINE_MODULES; k++) {
+			result &= TestCheckPipelineModule(modules[k], k ? modules[k - 1] : nullptr);
+		}
+		for (u32 k = TEST_PIPELINE_MODULES; k > 0; k--) {
+			mgr.UnloadModule(modules[k - 1]);
+		}
+	}
+	if (result) {
+		TestEnvironment env("RPMTestsPipeline", TEST_PIPELINE_HEAPSIZE);
+		rpm::mgr::ModuleManager& mgr = env.Mgr;
+		rpm::mgr::PipelineLoader loader(&mgr, 0, 8);
+		auto start = std::chrono::steady_clock::now();
+		u32 loaded = loader.LoadModules(pathPtrs, TEST_PIPELINE_MODULES, rpm::FixLevel::NONE, modules);
+		auto end = std::chrono::steady_clock::now();
+		pipelineTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+		result &= loaded == TEST_PIPELINE_MODULES;
+		rpm::Module* chain = mgr.GetLastModule();
+		for (u32 k = TEST_PIPELINE_MODULES; k > 0; k--) {
+			//Linked in list order, like the sequential load
+			result &= chain == modules[k - 1];
+			chain = chain ? chain->GetPrevModule() : nullptr;
+			result &= TestCheckPipelineModule(modules[k - 1], k > 1 ? modules[k - 2] : nullptr);
+		}
+		//A missing file does not stall the modules behind it
+		const char* gapPaths[] = { pathPtrs[0], "/tmp/rpmpipe-missing", pathPtrs[1] };
+		rpm::Module* gapModules[NELEMS(gapPaths)];
+		result &= loader.LoadModules(gapPaths, NELEMS(gapPaths), rpm::FixLevel::NONE, gapModules) == 2 && !gapModules[1];
+		mgr.UnloadModule(gapModules[2]);
+		mgr.UnloadModule(gapModules[0]);
+		for (u32 k = TEST_PIPELINE_MODULES; k > 0; k--) {
+			mgr.UnloadModule(modules[k - 1]);
+		}
+		rpm::mgr::ManagerMemoryStats stats;
+		mgr.GetMemoryStats(&stats);
+		result &= stats.InUse == 0;
+	}
+	for (u32 k = 0; k < TEST_PIPELINE_MODULES; k++) {
+		unlink(paths[k]);
+	}
+
+	//The timings are informational only, the pipeline can be slower than sequential loading with a single CPU or under a sanitizer
+	printf("Pipelined loading: sequential %lld us, pipelined %lld us (%d modules, %ld CPUs).\n",
+		sequentialTime, pipelineTime, TEST_PIPELINE_MODULES, sysconf(_SC_NPROCESSORS_ONLN));
+	TestReport("Pipelined loading", result);
+	return result;
+}
+
+#endif
+
+/**
+ * Starts modules in deferred mode and checks that only the ones that are used get activated.
+ */
+bool TestDeferredStart() {
+	TestEnvironment env("RPMTestsDeferred");
+	rpm::mgr::ModuleManager& mgr = env.Mgr;
+
+	const char* exportsA[] = { "DeferredA" };
+	const char* exportsB[] = { "DeferredB" };
+	const char* exportsC[] = { "DeferredC" };
+	TestModuleDesc descA = { 0x20, 0, exportsA, NELEMS(exportsA), nullptr, 0, 1 };
+	TestModuleDesc descB = { 0x20, 0, exportsB, NELEMS(exportsB), nullptr, 0, 1 };
+	TestModuleDesc descC = { 0x20, 0, exportsC, NELEMS(exportsC), nullptr, 0, 1 };
+	TestModuleDesc descUser = { 0x20, 0, nullptr, 0, exportsC, NELEMS(exportsC), 0 };
+
+	rpm::Module* modA = env.Load(&descA);
+	rpm::Module* modB = env.Load(&descB);
+	rpm::Module* modC = env.Load(&descC);
+	mgr.StartModuleDeferred(modA, rpm::FixLevel::ALL_NONCODE);
+	mgr.StartModuleDeferred(modB, rpm::FixLevel::ALL_NONCODE);
+	mgr.StartModuleDeferred(modC, rpm::FixLevel::ALL_NONCODE);
+
+	bool result = modA->IsStartDeferred() && modB->IsStartDeferred() && modC->IsStartDeferred();
+
+	//Lookup activates A only
+	result &= mgr.FindProcAddress("DeferredA", nullptr) != nullptr;
+	result &= !modA->IsStartDeferred() && modB->IsStartDeferred();
+
+	//A started importer activates C
+	rpm::Module* user = env.Load(&descUser);
+	mgr.StartModule(user, rpm::FixLevel::NONE);
+	result &= !modC->IsStartDeferred() && modB->IsStartDeferred();
+
+	mgr.UnloadModule(user);
+	mgr.UnloadModule(modC);
+	mgr.UnloadModule(modB);
+	mgr.UnloadModule(modA);
+
+	TestReport("Deferred start", result);
+	return result;
+}
+
+/**
+ * Saves a snapshot of linked modules and restores it into a fresh manager on the same heap memory.
+ */
+bool TestSnapshotRestore() {
+	void* heapMem = AllocTestHeapMemory(MEMORY_MGR_HEAPSIZE);
+	void* snapshot = malloc(MEMORY_MGR_HEAPSIZE);
+	void* captureMem = malloc(MEMORY_MGR_HEAPSIZE);
+	size_t snapshotSize;
+	const char* exports[] = { "SnapshotExport" };
+	TestModuleDesc exporterDesc = { 0x20, 0x10, exports, NELEMS(exports), nullptr, 0, 1 };
+	TestModuleDesc importerDesc = { 0x20, 0x10, nullptr, 0, exports, NELEMS(exports), 0 };
+	u32 stamps[] = { 0x1234, 0x5678 };
+	u32 badStamps[] = { 0x1234, 0x5679 };
+	void* importSlot;
+	u32* exporterCode;
+	u32 pristineWord;
+
+	{
+		exl::heap::HeapArea heap("RPMTestsSnapshot", heapMem, MEMORY_MGR_HEAPSIZE);
+		exl::heap::HeapArea captureHeap("RPMTestsSnapshotImages", captureMem, MEMORY_MGR_HEAPSIZE);
+		rpm::mgr::ModuleManager mgr(&heap);
+		mgr.BindSnapshotHeap(&captureHeap);
+		rpm::Module* exporter = mgr.LoadModule(BuildTestModule(&heap, &exporterDesc, nullptr));
+		mgr.StartModule(exporter, rpm::FixLevel::NONE);
+		rpm::Module* importer = mgr.LoadModule(BuildTestModule(&heap, &importerDesc, nullptr));
+		mgr.StartModule(importer, rpm::FixLevel::ALL_NONCODE);
+		importSlot = importer->GetCode();
+		//Stands in for state written by the module after it was started, which the snapshot must not contain
+		exporterCode = reinterpret_cast<u32*>(exporter->GetCode());
+		pristineWord = exporterCode[1];
+		exporterCode[1] = ~pristineWord;
+		snapshotSize = mgr.SaveSnapshot(snapshot, MEMORY_MGR_HEAPSIZE, stamps);
+		mgr.BindSnapshotHeap(nullptr);
+	}
+
+	bool result = snapshotSize != 0;
+	{
+		exl::heap::HeapArea heap("RPMTestsSnapshot", heapMem, MEMORY_MGR_HEAPSIZE);
+		exl::heap::HeapArea captureHeap("RPMTestsSnapshotImages", captureMem, MEMORY_MGR_HEAPSIZE);
+		rpm::mgr::ModuleManager mgr(&heap);
+		mgr.BindSnapshotHeap(&captureHeap);
+		result &= !mgr.RestoreSnapshot(snapshot, snapshotSize, badStamps, NELEMS(badStamps));
+		result &= mgr.RestoreSnapshot(snapshot, snapshotSize, stamps, NELEMS(stamps));
+		void* exportAddr = mgr.FindProcAddress("SnapshotExport", nullptr);
+		result &= exportAddr && *static_cast<u32*>(importSlot) == static_cast<u32>(reinterpret_cast<size_t>(exportAddr));
+		result &= exporterCode[0] == static_cast<u32>(reinterpret_cast<size_t>(exportAddr)) && exporterCode[1] == pristineWord;
+		//The restored modules can be snapshotted again
+		result &= mgr.CalcSnapshotSize() == snapshotSize;
+		while (mgr.GetLastModule()) {
+			mgr.UnloadModule(mgr.GetLastModule());
+		}
+		mgr.BindSnapshotHeap(nullptr);
+	}
+	{
+		//Different heap layout
+		exl::heap::HeapArea heap("RPMTestsSnapshot", heapMem, MEMORY_MGR_HEAPSIZE);
+		rpm::mgr::ModuleManager mgr(&heap);
+		heap.Alloc(0x40);
+		result &= !mgr.RestoreSnapshot(snapshot, snapshotSize, stamps, NELEMS(stamps)) && !mgr.GetLastModule();
+	}
+
+	printf("Snapshot restore: %zu bytes.\n", snapshotSize);
+	TestReport("Snapshot restore", result);
+	free(captureMem);
+	free(snapshot);
+	FreeTestHeapMemory(heapMem, MEMORY_MGR_HEAPSIZE);
+	return result;
+}
+
+/**
+ * Strips control sections from the middle of a module, with and without split control, and checks that the rest stays usable.
+ */
+bool TestFixMask() {
+	TestEnvironment env("RPMTestsFixMask");
+	rpm::mgr::ModuleManager& mgr = env.Mgr;
+
+	const char* exports[] = { "FixMaskExportA", "FixMaskExportB" };
+	const char* imports[] = { "FixMaskImport" };
+	TestMetaValue meta[] = { { "FixMaskValue", nullptr, 42 } };
+	TestModuleDesc exporterDesc = { 0x20, 0, imports, NELEMS(imports), nullptr, 0, 0 };
+	TestModuleDesc desc = { 0x40, 0x10, exports, NELEMS(exports), imports, NELEMS(imports), 4, meta, NELEMS(meta) };
+	TestModuleDesc userDesc = { 0x20, 0, nullptr, 0, exports, NELEMS(exports), 0 };
+
+	rpm::Module* exporter = env.Load(&exporterDesc);
+	mgr.StartModule(exporter, rpm::FixLevel::NONE);
+
+	bool result = true;
+	for (u32 split = 0; split < 2; split++) {
+		rpm::Module* module = mgr.LoadModule(env.Build(&desc), split ? rpm::init::RPM_LOADFLAG_SPLIT_CONTROL : rpm::init::RPM_LOADFLAG_NONE);
+		mgr.StartModule(module, rpm::FixLevel::NONE);
+		void* procA = mgr.GetProcAddress(module, exports[0]);
+		void* procB = mgr.GetProcAddress(module, exports[1]);
+		size_t fullSize = split ? module->GetControlBlockSize() : module->GetModuleSize();
+
+		//The internal relocations and metadata are followed by the import relocations and strings
+		mgr.FixModuleSections(module, rpm::RPM_FIXMASK_INTERNAL_RELOCATIONS | rpm::RPM_FIXMASK_METADATA);
+		size_t relocatedSize = split ? module->GetControlBlockSize() : module->GetModuleSize();
+		result &= relocatedSize < fullSize && !module->GetMetaData() && module->FindSymbol(imports[0]);
+		result &= module->GetRelocations() && !module->GetRelocations()->InternalRelocations && module->GetRelocations()->InternalImportRelocations;
+
+		mgr.FixModuleSections(module, rpm::RPM_FIXMASK_STRINGS | rpm::RPM_FIXMASK_LOCAL_SYMBOLS);
+		size_t exportsOnlySize = split ? module->GetControlBlockSize() : module->GetModuleSize();
+		result &= exportsOnlySize < relocatedSize && !module->GetRelocations() && module->GetSymbols()->SymbolCount == NELEMS(exports);
+		result &= mgr.GetProcAddress(module, exports[0]) == procA && mgr.GetProcAddress(module, exports[1]) == procB;
+
+		//Other modules can still import from the stripped module
+		rpm::Module* user = env.Load(&userDesc);
+		mgr.StartModule(user, rpm::FixLevel::NONE);
+		u32* slots = reinterpret_cast<u32*>(user->GetCode());
+		u32 addrA = static_cast<u32>(reinterpret_cast<size_t>(procA));
+		u32 addrB = static_cast<u32>(reinterpret_cast<size_t>(procB));
+		result &= (slots[0] == addrA && slots[1] == addrB) || (slots[0] == addrB && slots[1] == addrA);
+
+		printf("Fix mask (%s): %zu -> %zu -> %zu bytes.\n", split ? "split" : "single", fullSize, relocatedSize, exportsOnlySize);
+		mgr.UnloadModule(user);
+		mgr.UnloadModule(module);
+	}
+
+	TestReport("Fix mask", result);
+	mgr.UnloadModule(exporter);
+	return result;
+}
+
+/**
+ * Starts a library with FixLevel::EXPORTS_ONLY and checks that it can still be looked up and imported from.
+ */
+bool TestExportsOnlyFix() {
+	TestEnvironment env("RPMTestsExportsOnly");
+	rpm::mgr::ModuleManager& mgr = env.Mgr;
+
+	const char* exports[] = { "ExportsOnlyA", "ExportsOnlyB", "ExportsOnlyC" };
+	TestMetaValue meta[] = { { "ExportsOnlyValue", "Stripped", 0 } };
+	TestModuleDesc libDesc = { 0x40, 0x10, exports, NELEMS(exports), nullptr, 0, 8, meta, NELEMS(meta) };
+	TestModuleDesc userDesc = { 0x20, 0, nullptr, 0, exports, NELEMS(exports), 0 };
+
+	rpm::Module* lib = env.Load(&libDesc);
+	size_t fullSize = lib->GetModuleSize();
+	mgr.StartModule(lib, rpm::FixLevel::EXPORTS_ONLY);
+
+	bool result = lib->GetModuleSize() < fullSize && !lib->GetRelocations() && !lib->GetMetaData() && !lib->GetString(0);
+	rpm::Module* user = env.Load(&userDesc);
+	mgr.StartModule(user, rpm::FixLevel::EXPORTS_ONLY);
+	u32* slots = reinterpret_cast<u32*>(user->GetCode());
+	for (u32 i = 0; i < NELEMS(exports); i++) {
+		//Imports are sorted by hash, so check that every slot holds one of the exports
+		void* addr = mgr.GetProcAddress(lib, exports[i]);
+		bool found = false;
+		for (u32 j = 0; j < NELEMS(exports); j++) {
+			found |= slots[j] == static_cast<u32>(reinterpret_cast<size_t>(addr));
+		}
+		result &= addr && found;
+	}
+
+	printf("Exports-only fix: %zu -> %zu bytes.\n", fullSize, lib->GetModuleSize());
+	TestReport("Exports-only fix", result);
+	mgr.UnloadModule(user);
+	mgr.UnloadModule(lib);
+	return result;
+}
+
+/**
+ * Links imports carrying correct, stale and out-of-range export ordinals and checks that all of them bind to the right export.
+ */
+bool TestOrdinalImports() {
+	TestEnvironment env("RPMTestsOrdinals");
+	rpm::mgr::ModuleManager& mgr = env.Mgr;
+
+	const char* exports[] = { "OrdinalA", "OrdinalB", "OrdinalC", "OrdinalD" };
+	TestModuleDesc libDesc = { 0x20, 0, exports, NELEMS(exports), nullptr, 0, 0 };
+	TestModuleDesc userDesc = { 0x20, 0, nullptr, 0, exports, NELEMS(exports), 0 };
+
+	rpm::Module* lib = env.Load(&libDesc);
+	mgr.StartModule(lib, rpm::FixLevel::NONE);
+	rpm::Module* user = env.Load(&userDesc);
+
+	rpm::Module::SymbolSection* libSymbols = lib->GetSymbols();
+	rpm::Module::SymbolSection* userSymbols = user->GetSymbols();
+	rpm::Symbol* imports = &userSymbols->Symbols[userSymbols->FirstImportSymbolIdx];
+	u16 expected[NELEMS(exports)];
+	for (u32 i = 0; i < NELEMS(exports); i++) {
+		expected[i] = lib->FindExportSymbolIdx(user->GetString(imports[i].Name)) - libSymbols->FirstExportSymbolIdx;
+		imports[i].Attr |= rpm::RPM_SYMATTR_ORDINAL;
+		imports[i].ExportOrdinal = expected[i];
+	}
+	imports[0].ExportOrdinal = expected[1]; //stale
+	imports[1].ExportOrdinal = 0xFFFF; //out of range
+
+	mgr.StartModule(user, rpm::FixLevel::NONE);
+
+	bool result = true;
+	u32* slots = reinterpret_cast<u32*>(user->GetCode());
+	for (u32 i = 0; i < NELEMS(exports); i++) {
+		//Import slot i is relocated by import symbol i, see BuildTestModule
+		result &= slots[i] == static_cast<u32>(reinterpret_cast<size_t>(lib->GetProcAddress(user->GetString(imports[i].Name))));
+		result &= imports[i].ExportOrdinal == expected[i];
+	}
+
+	TestReport("Ordinal imports", result);
+	mgr.UnloadModule(user);
+	mgr.UnloadModule(lib);
+	return result;
+}
+
+/**
+ * Resolves imports from two exporters loaded one after the other, then unloads and reloads one of them and checks that the imports are rebound.
+ */
+bool TestRelinking() {
+	TestEnvironment env("RPMTestsRelink");
+	rpm::mgr::ModuleManager& mgr = env.Mgr;
+
+	const char* exportsA[] = { "RelinkA0", "RelinkA1", "RelinkA2" };
+	const char* exportsB[] = { "RelinkB0", "RelinkB1" };
+	const char* imports[] = { "RelinkA0", "RelinkA1", "RelinkA2", "RelinkB0", "RelinkB1" };
+	TestModuleDesc libADesc = { 0x20, 0, exportsA, NELEMS(exportsA), nullptr, 0, 0 };
+	TestModuleDesc libBDesc = { 0x20, 0, exportsB, NELEMS(exportsB), nullptr, 0, 0 };
+	TestModuleDesc userDesc = { 0x20, 0, nullptr, 0, imports, NELEMS(imports), 0 };
+
+	rpm::Module* user = env.Load(&userDesc);
+	mgr.StartModuleDeferred(user, rpm::FixLevel::NONE);
+	rpm::Module* libA = env.Load(&libADesc);
+	mgr.StartModule(libA, rpm::FixLevel::NONE);
+	bool result = user->ImportsFrom(libA) && !user->IsFullyImported();
+	rpm::Module* libB = env.Load(&libBDesc);
+	mgr.StartModule(libB, rpm::FixLevel::NONE);
+	result &= user->ImportsFrom(libB) && user->IsFullyImported();
+
+	mgr.UnloadModule(libA);
+	result &= !user->IsFullyImported() && user->ImportsFrom(libB);
+	libA = env.Load(&libADesc);
+	mgr.StartModule(libA, rpm::FixLevel::NONE);
+	result &= user->IsFullyImported();
+
+	rpm::Symbol* importSymbols = &user->GetSymbols()->Symbols[user->GetSymbols()->FirstImportSymbolIdx];
+	u32* slots = reinterpret_cast<u32*>(user->GetCode());
+	for (u32 i = 0; i < NELEMS(imports); i++) {
+		//Import slot i is relocated by import symbol i, see BuildTestModule
+		const char* name = user->GetString(importSymbols[i].Name);
+		result &= slots[i] == static_cast<u32>(reinterpret_cast<size_t>(mgr.FindProcAddress(name, nullptr)));
+	}
+
+	TestReport("Relinking", result);
+	mgr.UnloadModule(user);
+	mgr.UnloadModule(libB);
+	mgr.UnloadModule(libA);
+	return result;
+}
+
+/**
+ * Registers modules by metadata and by SetModuleName, and checks that imports are linked from the modules named in the importer's extern module list.
+ */
+bool TestModuleNames() {
+	TestEnvironment env("RPMTestsNames");
+	rpm::mgr::ModuleManager& mgr = env.Mgr;
+
+	const char* libExports[] = { "NamedExportA", "NamedExportB" };
+	const char* externs[] = { "NamedLib" };
+	TestMetaValue libMeta[] = { { RPM_METAVALUE_MODULE_NAME, "NamedLib", 0 } };
+	TestModuleDesc libDesc = { 0x20, 0, libExports, NELEMS(libExports), nullptr, 0, 0, libMeta, NELEMS(libMeta) };
+	TestModuleDesc decoyDesc = { 0x20, 0, libExports, NELEMS(libExports), nullptr, 0, 0 };
+	TestModuleDesc userDesc = { 0x20, 0, nullptr, 0, libExports, NELEMS(libExports), 0, nullptr, 0, externs, NELEMS(externs) };
+
+	rpm::Module* lib = env.Load(&libDesc);
+	mgr.StartModule(lib, rpm::FixLevel::NONE);
+	//Loaded last, so a scan of the module chain would link the user with it
+	rpm::Module* decoy = env.Load(&decoyDesc);
+	mgr.StartModule(decoy, rpm::FixLevel::NONE);
+	rpm::Module* user = env.Load(&userDesc);
+	mgr.StartModule(user, rpm::FixLevel::NONE);
+
+	bool result = mgr.FindModule("NamedLib") == lib && !mgr.FindModule("NamedDecoy");
+	result &= user->ImportsFrom(lib) && !user->ImportsFrom(decoy);
+
+	//Incremental and deferred starts link in the same order
+	rpm::mgr::ModuleLoader loader(&mgr, env.Build(&userDesc), rpm::FixLevel::NONE);
+	while (!loader.Step(TEST_INCREMENTAL_BUDGET)) {
+	}
+	rpm::Module* incUser = loader.GetModule();
+	rpm::Module* deferredUser = env.Load(&userDesc);
+	mgr.StartModuleDeferred(deferredUser, rpm::FixLevel::NONE);
+	result &= incUser && incUser->ImportsFrom(lib) && !incUser->ImportsFrom(decoy);
+	result &= deferredUser->ImportsFrom(lib) && !deferredUser->ImportsFrom(decoy);
+	mgr.UnloadModule(deferredUser);
+	mgr.UnloadModule(incUser);
+
+	//A module unloaded while an incremental load walks the module chain is skipped
+	rpm::Module* victim = env.Load(&decoyDesc);
+	mgr.StartModule(victim, rpm::FixLevel::NONE);
+	rpm::mgr::ModuleLoader skipLoader(&mgr, env.Build(&userDesc), rpm::FixLevel::NONE);
+	while (skipLoader.GetStage() != rpm::mgr::ModuleLoader::LINK) {
+		skipLoader.Step(1);
+	}
+	skipLoader.Step(2); //the named module, then the loading module itself
+	mgr.UnloadModule(victim);
+	while (!skipLoader.Step(TEST_INCREMENTAL_BUDGET)) {
+	}
+	result &= skipLoader.GetModule() && skipLoader.GetModule()->ImportsFrom(lib);
+	mgr.UnloadModule(skipLoader.GetModule());
+	result &= mgr.SetModuleName(decoy, "NamedDecoy") && !mgr.SetModuleName(decoy, "NamedLib") && mgr.FindModule("NamedDecoy") == decoy;
+	result &= mgr.SetModuleName(decoy, "NamedDecoy2") && !mgr.FindModule("NamedDecoy") && mgr.FindModule("NamedDecoy2") == decoy;
+
+	//Enough names to grow the registry, half of them removed again
+	const u32 extraCount = 24;
+	TestModuleDesc extraDesc = { 0x10, 0, nullptr, 0, nullptr, 0, 0 };
+	rpm::Module* extras[extraCount];
+	char name[32];
+	for (u32 i = 0; i < extraCount; i++) {
+		extras[i] = env.Load(&extraDesc);
+		snprintf(name, sizeof(name), "NamedExtra%d", i);
+		result &= mgr.SetModuleName(extras[i], name);
+	}
+	for (u32 i = 0; i < extraCount; i += 2) {
+		mgr.UnloadModule(extras[i]);
+	}
+	for (u32 i = 0; i < extraCount; i++) {
+		snprintf(name, sizeof(name), "NamedExtra%d", i);
+		result &= mgr.FindModule(name) == (i & 1 ? extras[i] : nullptr);
+	}
+	for (u32 i = 1; i < extraCount; i += 2) {
+		mgr.UnloadModule(extras[i]);
+	}
+	result &= mgr.FindModule("NamedLib") == lib && mgr.FindModule("NamedDecoy2") == decoy;
+
+	mgr.UnloadModule(user);
+	mgr.UnloadModule(decoy);
+	mgr.UnloadModule(lib);
+	result &= !mgr.FindModule("NamedLib");
+	rpm::mgr::ManagerMemoryStats stats;
+	mgr.GetMemoryStats(&stats);
+	result &= stats.InUse == 0;
+
+	TestReport("Module names", result);
+	return result;
+}
+
+/**
+ * Reads the control sections of a module file in place, then loads a copy of the file and checks that the section links were used as-is.
+ */
+bool TestRelativeControl() {
+	TestEnvironment env("RPMTestsRelCtrl");
+	rpm::mgr::ModuleManager& mgr = env.Mgr;
+
+	const char* exports[] = { "RelCtrlA", "RelCtrlB" };
+	const char* externs[] = { "RelCtrlDep" };
+	TestMetaValue meta[] = { { RPM_METAVALUE_MODULE_NAME, "RelCtrl", 0 } };
+	TestModuleDesc desc = { 0x20, 0, exports, NELEMS(exports), nullptr, 0, 2, meta, NELEMS(meta), externs, NELEMS(externs) };
+
+	size_t fileSize;
+	u8* file = static_cast<u8*>(BuildTestModule(&env.Heap, &desc, &fileSize));
+	TestModuleHeader* header = reinterpret_cast<TestModuleHeader*>(file);
+	rpm::Module::DllExec* fileExec = reinterpret_cast<rpm::Module::DllExec*>(file + reinterpret_cast<size_t>(header->Exec));
+	rpm::Module::InfoSection* fileInfo = fileExec->Info;
+	rpm::Module::SymbolSection* fileSymbols = fileInfo->Symbols;
+	rpm::Module::RelocationSection* fileRels = fileInfo->Relocations;
+	bool result = fileSymbols && fileSymbols->Magic == SYM0_MAGIC && fileRels && fileRels->InternalRelocations->Count == 2;
+	result &= strcmp(&fileInfo->Strings->Strings[fileSymbols->ExternModules->Entries[0]], externs[0]) == 0;
+
+	u8* data = static_cast<u8*>(env.Heap.Alloc(fileSize));
+	memcpy(data, file, fileSize);
+	rpm::Module* module = mgr.LoadModule(data);
+	rpm::Module::SymbolSection* symbols = module->GetSymbols();
+	rpm::Module::RelocationSection* rels = module->GetRelocations();
+	result &= symbols->ExternModules.Offset == fileSymbols->ExternModules.Offset;
+	result &= symbols->ExportSymbolHashTable.Offset == fileSymbols->ExportSymbolHashTable.Offset;
+	result &= rels->InternalRelocations.Offset == fileRels->InternalRelocations.Offset;
+	result &= module->GetCode() == data + fileInfo->CodeOffset;
+	result &= mgr.FindModule(meta[0].StringValue) == module;
+
+	mgr.StartModule(module, rpm::FixLevel::NONE);
+	u32* slots = reinterpret_cast<u32*>(module->GetCode());
+	for (u32 i = 0; i < 2; i++) {
+		result &= slots[i] == static_cast<u32>(reinterpret_cast<size_t>(module->GetProcAddress(module->GetString(symbols->Symbols[i].Name))));
+	}
+
+	TestReport("Relative control sections", result);
+	mgr.UnloadModule(module);
+	env.Heap.Free(file);
+	return result;
+}
+
+#define TEST_OVERLAY_COUNT 3
+#define TEST_OVERLAY_SLOT_SIZE 0x400
+
+static void* g_OverlayFiles[TEST_OVERLAY_COUNT];
+static size_t g_OverlayFileSizes[TEST_OVERLAY_COUNT];
+static u32 g_OverlayReads;
+
+static size_t TestReadOverlay(u32 id, void* buffer, size_t bufferSize) {
+	if (id >= TEST_OVERLAY_COUNT || g_OverlayFileSizes[id] > bufferSize) {
+		return 0;
+	}
+	g_OverlayReads++;
+	memcpy(buffer, g_OverlayFiles[id], g_OverlayFileSizes[id]);
+	return g_OverlayFileSizes[id];
+}
+
+/**
+ * Checks that every pointer table and import slot of a test module points to the right symbol.
+ */
+static bool TestCheckOverlaySlots(rpm::Module* module, rpm::Module* lib, const TestModuleDesc* desc) {
+	if (!module) {
+		return false;
+	}
+	bool result = true;
+	u32* slots = reinterpret_cast<u32*>(module->GetCode());
+	rpm::Module::SymbolSection* symbols = module->GetSymbols();
+	for (u32 i = 0; i < desc->PointerTableSize; i++) {
+		result &= slots[i] == static_cast<u32>(reinterpret_cast<size_t>(module->GetProcAddress(module->GetString(symbols->Symbols[i % desc->ExportCount].Name))));
+	}
+	for (u32 i = 0; i < desc->ImportCount; i++) {
+		const char* name = module->GetString(symbols->Symbols[symbols->FirstImportSymbolIdx + i].Name);
+		result &= slots[desc->PointerTableSize + i] == static_cast<u32>(reinterpret_cast<size_t>(lib->GetProcAddress(name)));
+	}
+	return result;
+}
+
+/**
+ * Swaps overlays between two slots and checks that reloads into the same slot are served from the cache,
+ * that the cache stays within its budget, that a hot reloaded overlay stays in its slot, and that the cache is released under memory pressure
+ * and when a dependency is unloaded.
+ */
+bool TestOverlays() {
+	TestEnvironment env("RPMTestsOverlay");
+	rpm::mgr::ModuleManager& mgr = env.Mgr;
+
+	const char* libExports[] = { "OverlayLibA", "OverlayLibB" };
+	const char* exports[TEST_OVERLAY_COUNT][2] = { { "SceneA0", "SceneA1" }, { "SceneB0", "SceneB1" }, { "SceneC0", "SceneC1" } };
+	TestModuleDesc libDesc = { 0x20, 0, libExports, NELEMS(libExports), nullptr, 0, 0 };
+	TestModuleDesc descs[TEST_OVERLAY_COUNT];
+	for (u32 i = 0; i < TEST_OVERLAY_COUNT; i++) {
+		descs[i] = { 0x40, 0x10, exports[i], 2, libExports, NELEMS(libExports), 4 };
+		g_OverlayFiles[i] = BuildTestModule(&env.Heap, &descs[i], &g_OverlayFileSizes[i]);
+	}
+	g_OverlayReads = 0;
+
+	rpm::Module* lib = env.Load(&libDesc);
+	mgr.StartModule(lib, rpm::FixLevel::NONE);
+
+	void* slotMem[2] = { env.Heap.Alloc(TEST_OVERLAY_SLOT_SIZE), env.Heap.Alloc(TEST_OVERLAY_SLOT_SIZE) };
+	rpm::mgr::OverlayManager overlays(&mgr, TestReadOverlay, 0x10000);
+	u32 slot0 = overlays.AddSlot(slotMem[0], TEST_OVERLAY_SLOT_SIZE);
+	u32 slot1 = overlays.AddSlot(slotMem[1], TEST_OVERLAY_SLOT_SIZE);
+
+	bool result = true;
+	rpm::Module* overlay = overlays.LoadOverlay(slot0, 0, rpm::FixLevel::NONE);
+	result &= overlay == slotMem[0] && TestCheckOverlaySlots(overlay, lib, &descs[0]) && overlays.GetCacheSize() > 0;
+	size_t imageSize = overlays.GetCacheSize();
+	//Scribble over the running overlay's data to make sure that the cached image is taken before it runs
+	reinterpret_cast<u32*>(overlay->GetCode())[descs[0].PointerTableSize + descs[0].ImportCount] = 0xDEADBEEF;
+
+	overlay = overlays.LoadOverlay(slot0, 1, rpm::FixLevel::NONE);
+	result &= TestCheckOverlaySlots(overlay, lib, &descs[1]) && overlays.GetCacheSize() == imageSize * 2;
+	overlay = overlays.LoadOverlay(slot0, 0, rpm::FixLevel::NONE);
+	result &= TestCheckOverlaySlots(overlay, lib, &descs[0]) && g_OverlayReads == 2;
+	result &= reinterpret_cast<u32*>(overlay->GetCode())[descs[0].PointerTableSize + descs[0].ImportCount] != 0xDEADBEEF;
+	result &= mgr.FindProcAddress("SceneA1", nullptr) == overlay->GetProcAddress("SceneA1");
+
+	//Images are bound to their slot's address
+	overlay = overlays.LoadOverlay(slot1, 0, rpm::FixLevel::NONE);
+	result &= overlay == slotMem[1] && TestCheckOverlaySlots(overlay, lib, &descs[0]) && g_OverlayReads == 3;
+
+	//Only two images fit, so overlay 1 in slot 0 is evicted as the least recently used one
+	overlays.SetCacheBudget(imageSize * 2);
+	result &= overlays.GetCacheSize() == imageSize * 2;
+	overlays.LoadOverlay(slot0, 1, rpm::FixLevel::NONE);
+	result &= g_OverlayReads == 4;
+	overlays.LoadOverlay(slot1, 2, rpm::FixLevel::NONE);
+	result &= g_OverlayReads == 5 && overlays.GetCacheSize() == imageSize * 2;
+
+	//A hot reloaded overlay stays owned by its slot
+	rpm::Module* replacement = mgr.ReloadModule(overlays.GetOverlay(slot1), env.Build(&descs[2]), rpm::FixLevel::NONE);
+	result &= replacement != nullptr && overlays.GetOverlay(slot1) == replacement && TestCheckOverlaySlots(replacement, lib, &descs[2]);
+
+	result &= overlays.OnMemoryPressure(&mgr, 1) == imageSize && overlays.GetCacheSize() == imageSize;
+	overlays.UnloadOverlay(slot0);
+	overlays.UnloadOverlay(slot1);
+	result &= overlays.GetOverlay(slot0) == nullptr && overlays.GetOverlay(slot1) == nullptr && overlays.GetCacheSize() == imageSize;
+	mgr.UnloadModule(lib);
+	result &= overlays.GetCacheSize() == 0;
+
+	TestReport("Overlays", result);
+	return result;
+}
+
+/**
+ * Checks that the memory statistics of a module add up to its allocation size across fixing and unloading.
+ */
+bool TestMemoryStats() {
+	TestEnvironment env("RPMTestsMemoryStats");
+	rpm::mgr::ModuleManager& mgr = env.Mgr;
+
+	const char* exports[] = { "MemoryStatsA", "MemoryStatsB" };
+	TestMetaValue meta[] = { { "MemoryStatsValue", nullptr, 1 } };
+	TestModuleDesc desc = { 0x40, 0x30, exports, NELEMS(exports), nullptr, 0, 4, meta, NELEMS(meta) };
+
+	rpm::Module* module = env.Load(&desc);
+	void* work = mgr.AllocModuleWorkMemory(0x100, module);
+	void* unowned = mgr.AllocModuleWorkMemory(0x20);
+
+	rpm::mgr::ModuleMemoryStats stats;
+	mgr.GetModuleMemoryStats(module, &stats);
+	size_t sections = stats.Code + stats.BSS + stats.Symbols + stats.ExportHashTable + stats.Relocations + stats.Strings + stats.MetaData + stats.Headers;
+	bool result = work && stats.Code == desc.CodeSize && stats.BSS == desc.BSSSize && stats.WorkMemory == 0x100;
+	result &= sections == module->GetModuleSize() && stats.Total == sections + stats.WorkMemory;
+	result &= stats.Symbols == sizeof(rpm::Module::SymbolSection) + NELEMS(exports) * sizeof(rpm::Symbol) && stats.ExportHashTable == NELEMS(exports) * sizeof(rpm::RPM_NAMEHASH);
+	result &= stats.Relocations && stats.Strings && stats.MetaData;
+	printf("Module memory: code %zu, BSS %zu, symbols %zu, hashes %zu, relocations %zu, strings %zu, metadata %zu, headers %zu, work %zu, total %zu.\n",
+		stats.Code, stats.BSS, stats.Symbols, stats.ExportHashTable, stats.Relocations, stats.Strings, stats.MetaData, stats.Headers, stats.WorkMemory, stats.Total);
+
+	mgr.StartModule(module, rpm::FixLevel::EXPORTS_ONLY);
+	rpm::mgr::ModuleMemoryStats fixedStats;
+	mgr.GetModuleMemoryStats(module, &fixedStats);
+	result &= !fixedStats.Relocations && !fixedStats.Strings && !fixedStats.MetaData && fixedStats.Symbols == stats.Symbols && fixedStats.Total < stats.Total;
+
+	rpm::mgr::ManagerMemoryStats mgrStats;
+	mgr.GetMemoryStats(&mgrStats);
+	result &= mgrStats.ModuleCount == 1 && mgrStats.Modules.Total == fixedStats.Total && mgrStats.UnownedWorkMemory == 0x20;
+	result &= mgrStats.PeakInUse > mgrStats.InUse && mgrStats.PeakInUse - mgrStats.InUse == stats.Total - fixedStats.Total;
+
+	mgr.UnloadModule(module);
+	mgr.GetMemoryStats(&mgrStats);
+	//The module's work memory is freed along with it
+	result &= mgrStats.ModuleCount == 0 && mgrStats.UnownedWorkMemory == 0x20;
+	mgr.FreeModuleWorkMemory(unowned);
+	mgr.ResetMemoryPeak();
+	mgr.GetMemoryStats(&mgrStats);
+	result &= mgrStats.InUse == 0 && mgrStats.PeakInUse == 0;
+
+	TestReport("Memory stats", result);
+	return result;
+}
+
+/**
+ * Allocates small work memory blocks from a module arena and from the heap, and checks that the arena is reported and released on unload.
+ */
+bool TestWorkArena() {
+	TestEnvironment env("RPMTestsArena", TEST_BENCH_HEAPSIZE);
+	rpm::mgr::ModuleManager& mgr = env.Mgr;
+
+	TestMetaValue meta[] = { { RPM_METAVALUE_WORK_ARENA_SIZE, nullptr, TEST_ARENA_SIZE } };
+	TestModuleDesc desc = { 0x40, 0, nullptr, 0, nullptr, 0, 0, meta, NELEMS(meta) };
+	TestModuleDesc plainDesc = { 0x40, 0, nullptr, 0, nullptr, 0, 0 };
+	rpm::Module* module = env.Load(&desc);
+	rpm::Module* plain = env.Load(&plainDesc);
+	mgr.StartModule(module, rpm::FixLevel::NONE);
+	mgr.StartModule(plain, rpm::FixLevel::NONE);
+
+	static void* blocks[TEST_ARENA_BLOCKS];
+	bool result = true;
+	long long arenaTime = 0;
+	long long heapTime = 0;
+	for (u32 round = 0; round < TEST_BENCH_ROUNDS; round++) {
+		auto start = std::chrono::steady_clock::now();
+		for (u32 i = 0; i < TEST_ARENA_BLOCKS; i++) {
+			blocks[i] = mgr.AllocModuleWorkMemory(TEST_ARENA_BLOCKSIZE, module);
+		}
+		for (u32 i = 0; i < TEST_ARENA_BLOCKS; i++) {
+			mgr.FreeModuleWorkMemory(blocks[i]);
+		}
+		auto mid = std::chrono::steady_clock::now();
+		for (u32 i = 0; i < TEST_ARENA_BLOCKS; i++) {
+			blocks[i] = mgr.AllocModuleWorkMemory(TEST_ARENA_BLOCKSIZE, plain);
+		}
+		for (u32 i = 0; i < TEST_ARENA_BLOCKS; i++) {
+			mgr.FreeModuleWorkMemory(blocks[i]);
+		}
+		auto end = std::chrono::steady_clock::now();
+		arenaTime += std::chrono::duration_cast<std::chrono::nanoseconds>(mid - start).count();
+		heapTime += std::chrono::duration_cast<std::chrono::nanoseconds>(end - mid).count();
+	}
+
+	//Consecutive blocks are packed, and the arena is rewound once all of them have been freed
+	u8* first = static_cast<u8*>(mgr.AllocModuleWorkMemory(TEST_ARENA_BLOCKSIZE, module));
+	u8* second = static_cast<u8*>(mgr.AllocModuleWorkMemory(1, module));
+	u8* third = static_cast<u8*>(mgr.AllocModuleWorkMemory(TEST_ARENA_BLOCKSIZE, module));
+	result &= second == first + TEST_ARENA_BLOCKSIZE && third == second + RPM_WORK_ARENA_ALIGNMENT;
+	result &= !(reinterpret_cast<size_t>(third) & (RPM_WORK_ARENA_ALIGNMENT - 1));
+	//Too large for what is left of the arena
+	void* overflow = mgr.AllocModuleWorkMemory(TEST_ARENA_SIZE, module);
+	result &= overflow && (static_cast<u8*>(overflow) < first || static_cast<u8*>(overflow) >= first + TEST_ARENA_SIZE);
+
+	rpm::mgr::ModuleMemoryStats stats;
+	mgr.GetModuleMemoryStats(module, &stats);
+	size_t used = third + TEST_ARENA_BLOCKSIZE - first;
+	result &= stats.WorkArena == TEST_ARENA_SIZE && stats.WorkArenaUsed == used && stats.WorkMemory == TEST_ARENA_SIZE;
+	result &= stats.Total == module->GetModuleSize() + TEST_ARENA_SIZE + TEST_ARENA_SIZE;
+	mgr.GetModuleMemoryStats(plain, &stats);
+	result &= stats.WorkArena == 0 && stats.WorkArenaUsed == 0;
+	mgr.FreeModuleWorkMemory(second);
+	mgr.GetModuleMemoryStats(module, &stats);
+	result &= stats.WorkArenaUsed == used;
+
+	//The arena blocks and the block that went to the heap are all released with the module
+	mgr.UnloadModule(module);
+	rpm::mgr::ManagerMemoryStats mgrStats;
+	mgr.GetMemoryStats(&mgrStats);
+	result &= mgrStats.Modules.WorkArena == 0 && mgrStats.UnownedWorkMemory == 0;
+	mgr.UnloadModule(plain);
+	mgr.GetMemoryStats(&mgrStats);
+	result &= mgrStats.InUse == 0;
+
+	printf("Work arenas: arena %lld ns, heap %lld ns (average of %d rounds, %d blocks of %d bytes).\n",
+		arenaTime / TEST_BENCH_ROUNDS, heapTime / TEST_BENCH_ROUNDS, TEST_BENCH_ROUNDS, TEST_ARENA_BLOCKS, TEST_ARENA_BLOCKSIZE);
+	TestReport("Work arenas", result);
+	return result;
+}
+
+#ifdef RPM_TRACE
+static u64 TestTraceClock() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Records the events of loading two linked modules, then converts a full and a wrapped-around buffer to Chrome trace JSON.
+ */
+bool TestTrace() {
+	TestEnvironment env("RPMTestsTrace");
+	rpm::mgr::ModuleManager& mgr = env.Mgr;
+
+	const char* exports[] = { "TraceExport" };
+	TestModuleDesc exporterDesc = { 0x20, 0, exports, NELEMS(exports), nullptr, 0, 1 };
+	TestModuleDesc importerDesc = { 0x20, 0, nullptr, 0, exports, NELEMS(exports), 0 };
+
+	static u64 storage[0x400];
+	static u64 smallStorage[(sizeof(rpm::mgr::TraceBuffer::Header) + 8 * sizeof(rpm::mgr::TraceEvent)) / sizeof(u64)];
+	rpm::mgr::TraceBuffer trace(storage, sizeof(storage), TestTraceClock, 1000000000);
+	rpm::mgr::TraceBuffer smallTrace(smallStorage, sizeof(smallStorage), TestTraceClock, 1000000000);
+
+	mgr.BindTraceBuffer(&trace);
+	rpm::Module* exporter = env.Load(&exporterDesc);
+	mgr.StartModule(exporter, rpm::FixLevel::INTERNAL_RELOCATIONS);
+	rpm::Module* importer = env.Load(&importerDesc);
+	mgr.StartModule(importer, rpm::FixLevel::NONE);
+
+	//A second importer's full lifecycle overflows the small buffer
+	mgr.BindTraceBuffer(&smallTrace);
+	rpm::Module* importer2 = env.Load(&importerDesc);
+	mgr.StartModule(importer2, rpm::FixLevel::NONE);
+	mgr.UnloadModule(importer2);
+	mgr.BindTraceBuffer(nullptr);
+
+	const rpm::mgr::TraceBuffer::Header* header = static_cast<const rpm::mgr::TraceBuffer::Header*>(trace.GetData());
+	const rpm::mgr::TraceEvent* events = reinterpret_cast<const rpm::mgr::TraceEvent*>(header + 1);
+	bool result = header->Count > 0 && events[0].Type == rpm::mgr::TRACE_LOAD && events[0].Phase == rpm::mgr::TRACE_BEGIN;
+	bool linked = false;
+	u32 depth = 0;
+	for (u32 i = 0; i < header->Count; i++) {
+		const rpm::mgr::TraceEvent* e = &events[i];
+		linked |= e->Type == rpm::mgr::TRACE_LINK && e->Module == reinterpret_cast<size_t>(importer) && e->Other == reinterpret_cast<size_t>(exporter);
+		depth += e->Phase == rpm::mgr::TRACE_BEGIN ? 1 : -1;
+		result &= e->Timestamp >= events[0].Timestamp;
+	}
+	result &= linked && depth == 0;
+
+	const rpm::mgr::TraceBuffer::Header* smallHeader = static_cast<const rpm::mgr::TraceBuffer::Header*>(smallTrace.GetData());
+	result &= smallHeader->Count > smallHeader->Capacity;
+
+	FILE* out = tmpfile();
+	result &= rpm::mgr::TraceBuffer::WriteChromeTrace(trace.GetData(), trace.GetDataSize(), out);
+	result &= rpm::mgr::TraceBuffer::WriteChromeTrace(smallTrace.GetData(), smallTrace.GetDataSize(), out);
+	result &= !rpm::mgr::TraceBuffer::WriteChromeTrace(smallTrace.GetData(), sizeof(rpm::mgr::TraceBuffer::Header), out);
+	long jsonSize = ftell(out);
+	fclose(out);
+
+	printf("Trace: %d events, %d in wrapped buffer, %ld bytes of JSON.\n", (u32)header->Count, (u32)smallHeader->Count, jsonSize);
+	TestReport("Trace", result);
+	mgr.UnloadModule(importer);
+	mgr.UnloadModule(exporter);
+	return result;
+}
+#endif
+
+/**
+ * Checks that the pointer table of a module points at the exports of an instance, in either order.
+ */
+static bool TestCheckInstanceTable(const u32* table, rpm::mgr::ModuleInstance* instance, const char** exports) {
+	//Exports are sorted by hash, so the table may list them in either order
+	u32 varA = static_cast<u32>(reinterpret_cast<size_t>(instance->GetProcAddress(exports[0])));
+	u32 varB = static_cast<u32>(reinterpret_cast<size_t>(instance->GetProcAddress(exports[1])));
+	return (table[0] == varA && table[1] == varB) || (table[0] == varB && table[1] == varA);
+}
+
+/**
+ * Creates instances of a module and checks that each gets its own rebased data,
+ * and that the shared code of a module is pointed at the data of the active instance.
+ */
+bool TestModuleInstances() {
+	TestEnvironment env("RPMTestsInstances");
+	rpm::mgr::ModuleManager& mgr = env.Mgr;
+
+	//The pointer table at the start of the code points at the exports after it
+	const char* exports[] = { "InstanceVarA", "InstanceVarB" };
+	TestMetaValue allData[] = { { RPM_METAVALUE_INSTANCE_DATA_OFFSET, nullptr, 0 } };
+	TestMetaValue sharedTable[] = { { RPM_METAVALUE_INSTANCE_DATA_OFFSET, nullptr, 0x10 } };
+	TestMetaValue outOfRange[] = { { RPM_METAVALUE_INSTANCE_DATA_OFFSET, nullptr, 0x1000 } };
+	TestModuleDesc desc = { 0x40, 0x20, exports, NELEMS(exports), nullptr, 0, 4, allData, NELEMS(allData) };
+	TestModuleDesc sharedDesc = { 0x40, 0x20, exports, NELEMS(exports), nullptr, 0, 4, sharedTable, NELEMS(sharedTable) };
+	TestModuleDesc badDesc = { 0x40, 0x20, exports, NELEMS(exports), nullptr, 0, 4, outOfRange, NELEMS(outOfRange) };
+
+	rpm::Module* templ = env.Load(&desc);
+	mgr.StartModuleDeferred(templ, rpm::FixLevel::NONE);
+	rpm::Module* shared = env.Load(&sharedDesc);
+	mgr.StartModuleDeferred(shared, rpm::FixLevel::NONE);
+	rpm::Module* bad = env.Load(&badDesc);
+	mgr.StartModuleDeferred(bad, rpm::FixLevel::NONE);
+
+	rpm::mgr::ModuleInstance* inst1 = mgr.CreateModuleInstance(templ);
+	rpm::mgr::ModuleInstance* inst2 = mgr.CreateModuleInstance(templ);
+	bool result = inst1 && inst2 && !mgr.CreateModuleInstance(bad);
+	u32 instanceSize = inst1 ? inst1->GetDataSize() : 0;
+	if (result) {
+		result &= inst1->GetDataSize() < templ->GetModuleSize();
+		rpm::mgr::ModuleInstance* instances[] = { inst1, inst2 };
+		for (u32 i = 0; i < NELEMS(instances); i++) {
+			result &= TestCheckInstanceTable(static_cast<u32*>(instances[i]->GetData()), instances[i], exports);
+		}
+		result &= inst1->GetProcAddress(exports[0]) != inst2->GetProcAddress(exports[0]);
+		mgr.DestroyModuleInstance(inst2);
+		mgr.DestroyModuleInstance(inst1);
+	}
+
+	//The shared table is patched to the active instance and left alone by creating others
+	const u32* sharedTableWords = reinterpret_cast<const u32*>(shared->GetCode());
+	u32 pristine[4];
+	memcpy(pristine, sharedTableWords, sizeof(pristine));
+	rpm::mgr::ModuleInstance* instA = mgr.CreateModuleInstance(shared);
+	rpm::mgr::ModuleInstance* instB = mgr.CreateModuleInstance(shared);
+	result &= instA && instB;
+	if (instA && instB) {
+		result &= memcmp(pristine, sharedTableWords, sizeof(pristine)) == 0 && !instA->IsActive() && !instB->IsActive();
+		mgr.ActivateModuleInstance(instA);
+		result &= instA->IsActive() && !instB->IsActive() && TestCheckInstanceTable(sharedTableWords, instA, exports);
+		mgr.ActivateModuleInstance(instB);
+		result &= instB->IsActive() && !instA->IsActive() && TestCheckInstanceTable(sharedTableWords, instB, exports);
+		//Destroying an inactive instance keeps the active one
+		mgr.DestroyModuleInstance(instA);
+		result &= instB->IsActive() && TestCheckInstanceTable(sharedTableWords, instB, exports);
+		mgr.DestroyModuleInstance(instB);
+		result &= memcmp(pristine, sharedTableWords, sizeof(pristine)) == 0;
+	}
+	else {
+		rpm::mgr::ModuleInstance* created[] = { instA, instB };
+		for (u32 i = 0; i < NELEMS(created); i++) {
+			if (created[i]) {
+				mgr.DestroyModuleInstance(created[i]);
+			}
+		}
+	}
+
+	rpm::mgr::ManagerMemoryStats stats;
+	mgr.GetMemoryStats(&stats);
+	result &= stats.InstanceMemory == 0;
+
+	printf("Module instances: %u bytes per instance for a %zu byte module.\n", instanceSize, templ->GetModuleSize());
+	TestReport("Module instances", result);
+	mgr.UnloadModule(bad);
+	mgr.UnloadModule(shared);
+	mgr.UnloadModule(templ);
+	return result;
+}
+
+static char g_BenchNames[TEST_IMPORTCACHE_EXPORTERS * TEST_IMPORTCACHE_EXPORTS][16];
+static const char* g_BenchNamePtrs[TEST_IMPORTCACHE_EXPORTERS * TEST_IMPORTCACHE_EXPORTS];
+
+/**
+ * Boots a fresh module manager with several exporters and one module importing from all of them.
+ * 
+ * @param cacheStorage Import cache storage to use, or null to link without a cache.
+ * @param pLinked Output for whether every import points at its export.
+ * @param pCacheDirty Output for whether any import had to be searched and was added to the cache.
+ * @return Time taken to link and start the importer, in microseconds.
+ */
+long long BenchImportCacheBoot(void* cacheStorage, bool* pLinked, bool* pCacheDirty) {
+	TestEnvironment env("RPMTestsBench", TEST_BENCH_HEAPSIZE);
+	rpm::mgr::ModuleManager& mgr = env.Mgr;
+	rpm::mgr::ImportCache* cache = nullptr;
+	if (cacheStorage) {
+		cache = new(&env.Heap) rpm::mgr::ImportCache(cacheStorage, TEST_IMPORTCACHE_SIZE);
+		mgr.BindImportCache(cache);
+	}
+
+	rpm::Module* exporters[TEST_IMPORTCACHE_EXPORTERS];
+	for (u32 i = 0; i < TEST_IMPORTCACHE_EXPORTERS; i++) {
+		TestModuleDesc desc = { TEST_IMPORTCACHE_EXPORTS * sizeof(u32), 0, &g_BenchNamePtrs[i * TEST_IMPORTCACHE_EXPORTS], TEST_IMPORTCACHE_EXPORTS, nullptr, 0, 0 };
+		exporters[i] = env.Load(&desc);
+		mgr.StartModule(exporters[i], rpm::FixLevel::NONE);
+	}
+
+	u32 importCount = NELEMS(g_BenchNamePtrs);
+	TestModuleDesc importerDesc = { static_cast<u32>(importCount * sizeof(u32)), 0, nullptr, 0, g_BenchNamePtrs, importCount, 0 };
+	rpm::Module* importer = env.Load(&importerDesc);
+
+	auto start = std::chrono::steady_clock::now();
+	mgr.StartModule(importer, rpm::FixLevel::NONE);
+	auto end = std::chrono::steady_clock::now();
+
+	//Import slot i is relocated by import symbol i, see BuildTestModule
+	u32* importSlots = reinterpret_cast<u32*>(importer->GetCode());
+	rpm::Symbol* importSymbols = &importer->GetSymbols()->Symbols[importer->GetSymbols()->FirstImportSymbolIdx];
+	*pLinked = true;
+	for (u32 i = 0; i < importCount; i++) {
+		const char* name = importer->GetString(importSymbols[i].Name);
+		if (importSlots[i] != static_cast<u32>(reinterpret_cast<size_t>(mgr.FindProcAddress(name, nullptr)))) {
+			*pLinked = false;
+		}
+	}
+	*pCacheDirty = cache && cache->IsDirty();
+
+	mgr.UnloadModule(importer);
+	for (u32 i = 0; i < TEST_IMPORTCACHE_EXPORTERS; i++) {
+		mgr.UnloadModule(exporters[i]);
+	}
+	return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+/**
+ * Compares linking with an empty import cache against linking with a cache saved by a previous boot.
+ */
+bool TestImportCacheBenchmark() {
+	for (u32 i = 0; i < NELEMS(g_BenchNamePtrs); i++) {
+		snprintf(g_BenchNames[i], sizeof(g_BenchNames[i]), "BenchSym%d", i);
+		g_BenchNamePtrs[i] = g_BenchNames[i];
+	}
+
+	void* storage = malloc(TEST_IMPORTCACHE_SIZE);
+	void* savedCache = malloc(TEST_IMPORTCACHE_SIZE);
+	long long coldTime = 0;
+	long long warmTime = 0;
+	bool linked;
+	bool dirty;
+	bool result = true;
+
+	for (u32 round = 0; round < TEST_BENCH_ROUNDS; round++) {
+		memset(storage, 0, TEST_IMPORTCACHE_SIZE);
+		coldTime += BenchImportCacheBoot(storage, &linked, &dirty);
+		result &= linked;
+	}
+	memcpy(savedCache, storage, TEST_IMPORTCACHE_SIZE);
+
+	for (u32 round = 0; round < TEST_BENCH_ROUNDS; round++) {
+		memcpy(storage, savedCache, TEST_IMPORTCACHE_SIZE);
+		warmTime += BenchImportCacheBoot(storage, &linked, &dirty);
+		result &= linked && !dirty;
+	}
+
+	printf("Import cache: cold link %lld us, warm link %lld us (average of %d boots, %zu imports).\n",
+		coldTime / TEST_BENCH_ROUNDS, warmTime / TEST_BENCH_ROUNDS, TEST_BENCH_ROUNDS, NELEMS(g_BenchNamePtrs));
+	TestReport("Import cache", result);
+
+	free(savedCache);
+	free(storage);
+	return result;
+}
+
+/**
+ * Reference for TestImportColumnBenchmark: ImportsFrom reading the bound addresses from the symbol records.
+ */
+static bool TestImportsFromRecords(rpm::Module* module, rpm::Module* other) {
+	rpm::Module::SymbolSection* symSect = module->GetSymbols();
+	size_t otherStart = reinterpret_cast<size_t>(other);
+	size_t otherEnd = otherStart + other->GetModuleSize();
+	rpm::Symbol* sym = &symSect->Symbols[symSect->FirstImportSymbolIdx];
+	for (u32 i = 0; i < symSect->ImportSymbolCount; i++, sym++) {
+		if (!(sym->Attr & rpm::RPM_SYMATTR_IMPORT) && sym->Addr.RawAddress >= otherStart && sym->Addr.RawAddress < otherEnd) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Compares scanning the import address column with scanning the symbol records from a cold cache, then unloads and reloads an exporter.
+ */
+bool TestImportColumnBenchmark() {
+	for (u32 i = 0; i < NELEMS(g_BenchNamePtrs); i++) {
+		snprintf(g_BenchNames[i], sizeof(g_BenchNames[i]), "BenchSym%d", i);
+		g_BenchNamePtrs[i] = g_BenchNames[i];
+	}
+	TestEnvironment env("RPMTestsColumns", TEST_BENCH_HEAPSIZE);
+	rpm::mgr::ModuleManager& mgr = env.Mgr;
+
+	rpm::Module* exporters[TEST_IMPORTCACHE_EXPORTERS + 1];
+	TestModuleDesc descs[TEST_IMPORTCACHE_EXPORTERS];
+	for (u32 i = 0; i < TEST_IMPORTCACHE_EXPORTERS; i++) {
+		descs[i] = { TEST_IMPORTCACHE_EXPORTS * sizeof(u32), 0, &g_BenchNamePtrs[i * TEST_IMPORTCACHE_EXPORTS], TEST_IMPORTCACHE_EXPORTS, nullptr, 0, 0 };
+		exporters[i] = env.Load(&descs[i]);
+		mgr.StartModule(exporters[i], rpm::FixLevel::NONE);
+	}
+	//Exports nothing that the importer uses, so both scans have to go through every import
+	TestModuleDesc otherDesc = { 0x10, 0, nullptr, 0, nullptr, 0, 0 };
+	exporters[TEST_IMPORTCACHE_EXPORTERS] = env.Load(&otherDesc);
+	mgr.StartModule(exporters[TEST_IMPORTCACHE_EXPORTERS], rpm::FixLevel::NONE);
+
+	u32 importCount = NELEMS(g_BenchNamePtrs);
+	TestModuleDesc importerDesc = { static_cast<u32>(importCount * sizeof(u32)), 0, nullptr, 0, g_BenchNamePtrs, importCount, 0 };
+	rpm::Module* importer = env.Load(&importerDesc);
+	mgr.StartModule(importer, rpm::FixLevel::NONE);
+
+	//The caches are flushed before every scan, since the layouts only differ in how many lines they pull in
+	const u32 scans = 64;
+	const size_t flushSize = 0x800000;
+	u8* flush = static_cast<u8*>(malloc(flushSize));
+	long long recordTime = 0;
+	long long columnTime = 0;
+	bool result = true;
+	rpm::Module* other = exporters[TEST_IMPORTCACHE_EXPORTERS];
+	for (u32 i = 0; i < scans; i++) {
+		memset(flush, i, flushSize);
+		auto start = std::chrono::steady_clock::now();
+		result &= !TestImportsFromRecords(importer, other);
+		auto end = std::chrono::steady_clock::now();
+		recordTime += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+		memset(flush, i, flushSize);
+		start = std::chrono::steady_clock::now();
+		result &= !importer->ImportsFrom(other);
+		end = std::chrono::steady_clock::now();
+		columnTime += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+	}
+	free(flush);
+
+	//Unloading an exporter restores the import hashes from the column, reloading it binds them again
+	mgr.UnloadModule(exporters[1]);
+	rpm::Module::SymbolSection* symSect = importer->GetSymbols();
+	u32 pending = 0;
+	for (u32 i = 0; i < symSect->ImportSymbolCount; i++) {
+		rpm::Symbol* sym = &symSect->Symbols[symSect->FirstImportSymbolIdx + i];
+		if (sym->Attr & rpm::RPM_SYMATTR_IMPORT) {
+			pending++;
+			result &= sym->Addr.ImportHash == symSect->ImportSymbolHashTable[i] && symSect->ImportAddressTable[i] == 0;
+		}
+		else {
+			result &= sym->Addr.RawAddress == symSect->ImportAddressTable[i];
+		}
+	}
+	result &= pending == TEST_IMPORTCACHE_EXPORTS && !importer->ImportsFrom(exporters[1]);
+	exporters[1] = env.Load(&descs[1]);
+	mgr.StartModule(exporters[1], rpm::FixLevel::NONE);
+	result &= importer->ImportsFrom(exporters[1]);
+	u32* importSlots = reinterpret_cast<u32*>(importer->GetCode());
+	for (u32 i = 0; i < importCount; i++) {
+		result &= importSlots[i] == symSect->ImportAddressTable[i];
+	}
+
+	mgr.UnloadModule(importer);
+	for (u32 i = 0; i < NELEMS(exporters); i++) {
+		mgr.UnloadModule(exporters[i]);
+	}
+
+	//Imports of absolute exports do not point into their exporter, but are still unbound along with it
+	const char* absExports[] = { "AbsoluteExport" };
+	TestModuleDesc absExporterDesc = { 0x10, 0, absExports, NELEMS(absExports), nullptr, 0, 0 };
+	TestModuleDesc absImporterDesc = { 0x10, 0, nullptr, 0, absExports, NELEMS(absExports), 0 };
+	rpm::Module* absExporter = env.Load(&absExporterDesc);
+	rpm::Module::SymbolSection* absSymSect = absExporter->GetSymbols();
+	rpm::Symbol* absSym = &absSymSect->Symbols[absSymSect->FirstExportSymbolIdx];
+	absSym->Attr |= rpm::RPM_SYMATTR_GLOBAL;
+	absSym->Addr.RawAddress = 0x1234;
+	mgr.StartModule(absExporter, rpm::FixLevel::NONE);
+	rpm::Module* absImporter = env.Load(&absImporterDesc);
+	mgr.StartModule(absImporter, rpm::FixLevel::NONE);
+	rpm::Module::SymbolSection* absImportSect = absImporter->GetSymbols();
+	result &= absImporter->ImportsFrom(absExporter) && *reinterpret_cast<u32*>(absImporter->GetCode()) == 0x1234;
+	mgr.UnloadModule(absExporter);
+	result &= !absImporter->ImportsFrom(absExporter) && (absImportSect->Symbols[absImportSect->FirstImportSymbolIdx].Attr & rpm::RPM_SYMATTR_IMPORT);
+	mgr.UnloadModule(absImporter);
+
+	printf("Import columns: cold record scan %lld ns, cold column scan %lld ns (average of %d scans, %d imports, %d vs %d bytes per import).\n",
+		recordTime / scans, columnTime / scans, scans, importCount,
+		(int)sizeof(rpm::Symbol), (int)sizeof(u32));
+	TestReport("Import columns", result);
+	return result;
+}
+
+/**
+ * Relocates a vtable-heavy module one relocation at a time and through the relocation engine, which applies runs of word relocations in one loop.
+ */
+bool TestRelocationBenchmark() {
+	for (u32 i = 0; i < TEST_VTABLE_FUNCTIONS; i++) {
+		snprintf(g_BenchNames[i], sizeof(g_BenchNames[i]), "VFunc%d", i);
+		g_BenchNamePtrs[i] = g_BenchNames[i];
+	}
+
+	size_t codeSize = (TEST_VTABLE_ENTRIES + TEST_VTABLE_FUNCTIONS) * sizeof(u32);
+	TestModuleDesc desc = { static_cast<u32>(codeSize), 0, g_BenchNamePtrs, TEST_VTABLE_FUNCTIONS, nullptr, 0, TEST_VTABLE_ENTRIES };
+	void* reference = malloc(codeSize);
+	long long perRelocTime = 0;
+	long long runTime = 0;
+	bool result = true;
+
+	for (u32 round = 0; round < TEST_BENCH_ROUNDS; round++) {
+		TestEnvironment env("RPMTestsRelocBench", TEST_BENCH_HEAPSIZE);
+		rpm::mgr::ModuleManager& mgr = env.Mgr;
+		rpm::Module* module = env.Load(&desc);
+
+		rpm::RelocationList* internals = module->GetRelocations()->InternalRelocations;
+		auto start = std::chrono::steady_clock::now();
+		for (u32 i = 0; i < internals->Count; i++) {
+			rpm::Relocation* r = &internals->Relocations[i];
+			rpm::Util::DoRelocation(module->GetCode() + r->Target.Offset, module, r);
+		}
+		auto mid = std::chrono::steady_clock::now();
+		memcpy(reference, module->GetCode(), codeSize);
+		memset(module->GetCode(), 0, TEST_VTABLE_ENTRIES * sizeof(u32));
+
+		mgr.StartModule(module, rpm::FixLevel::NONE);
+		auto end = std::chrono::steady_clock::now();
+
+		result &= memcmp(reference, module->GetCode(), codeSize) == 0;
+		perRelocTime += std::chrono::duration_cast<std::chrono::microseconds>(mid - start).count();
+		runTime += std::chrono::duration_cast<std::chrono::microseconds>(end - mid).count();
+
+		mgr.UnloadModule(module);
+	}
+
+	printf("Vtable relocation: per-relocation %lld us, run-length %lld us (average of %d loads, %d entries).\n",
+		perRelocTime / TEST_BENCH_ROUNDS, runTime / TEST_BENCH_ROUNDS, TEST_BENCH_ROUNDS, TEST_VTABLE_ENTRIES);
+	TestReport("Vtable relocation", result);
+
+	free(reference);
+	return result;
+}
+
+typedef void (*TestProcVoid)(void);
+typedef int (*TestProcInt)(int);
+
+/**
+ * Binds a table of typed function pointers, rebinds it to a second copy of the module and compares bulk binding with GetProcAddress.
+ */
+bool TestProcBinding() {
+	TestEnvironment env("RPMTestsProcs", TEST_BENCH_HEAPSIZE);
+	rpm::mgr::ModuleManager& mgr = env.Mgr;
+
+	const char* exports[] = { "ProcBindA", "ProcBindB", "ProcBindC" };
+	TestModuleDesc desc = { 0x40, 0, exports, NELEMS(exports), nullptr, 0, 0 };
+	rpm::Module* module = env.Load(&desc);
+	mgr.StartModule(module, rpm::FixLevel::NONE);
+
+	TestProcVoid procA = nullptr;
+	TestProcInt procB = nullptr;
+	TestProcVoid procC = nullptr;
+	TestProcVoid procMissing = reinterpret_cast<TestProcVoid>(1);
+	rpm::ProcBinding bindings[] = {
+		RPM_PROC_BINDING("ProcBindB", procB),
+		RPM_PROC_BINDING("ProcBindMissing", procMissing),
+		RPM_PROC_BINDING("ProcBindA", procA),
+		RPM_PROC_BINDING("ProcBindC", procC)
+	};
+	rpm::ProcTable table = RPM_PROC_TABLE(bindings);
+
+	bool result = rpm::Util::HashNameConst("ProcBindA") == rpm::Util::HashName("ProcBindA");
+	result &= module->BindProcTable(&table) == 1 && table.Sorted;
+	result &= reinterpret_cast<void*>(procA) == module->GetProcAddress("ProcBindA") && reinterpret_cast<void*>(procB) == module->GetProcAddress("ProcBindB");
+	result &= reinterpret_cast<void*>(procC) == module->GetProcAddress("ProcBindC") && !procMissing && procA;
+
+	//A second copy lives at another address, so every slot has to change
+	rpm::Module* copy = env.Load(&desc);
+	mgr.StartModule(copy, rpm::FixLevel::NONE);
+	TestProcVoid oldA = procA;
+	result &= copy->BindProcTable(&table) == 1;
+	result &= reinterpret_cast<void*>(procA) == copy->GetProcAddress("ProcBindA") && procA != oldA;
+	result &= reinterpret_cast<void*>(procB) == copy->GetProcAddress("ProcBindB") && reinterpret_cast<void*>(procC) == copy->GetProcAddress("ProcBindC");
+	mgr.UnloadModule(copy);
+	mgr.UnloadModule(module);
+
+	for (u32 i = 0; i < TEST_VTABLE_FUNCTIONS; i++) {
+		snprintf(g_BenchNames[i], sizeof(g_BenchNames[i]), "VFunc%d", i);
+		g_BenchNamePtrs[i] = g_BenchNames[i];
+	}
+	TestModuleDesc benchDesc = { TEST_VTABLE_FUNCTIONS * sizeof(u32), 0, g_BenchNamePtrs, TEST_VTABLE_FUNCTIONS, nullptr, 0, 0 };
+	module = env.Load(&benchDesc);
+	mgr.StartModule(module, rpm::FixLevel::NONE);
+
+	void* slots[TEST_VTABLE_FUNCTIONS];
+	void* reference[TEST_VTABLE_FUNCTIONS];
+	rpm::ProcBinding benchBindings[TEST_VTABLE_FUNCTIONS];
+	for (u32 i = 0; i < TEST_VTABLE_FUNCTIONS; i++) {
+		benchBindings[i].Hash = rpm::Util::HashName(g_BenchNamePtrs[i]);
+		benchBindings[i].Slot = &slots[i];
+	}
+	rpm::ProcTable benchTable = RPM_PROC_TABLE(benchBindings);
+	long long lookupTime = 0;
+	long long bindTime = 0;
+	for (u32 round = 0; round < TEST_BENCH_ROUNDS; round++) {
+		auto start = std::chrono::steady_clock::now();
+		for (u32 i = 0; i < TEST_VTABLE_FUNCTIONS; i++) {
+			reference[i] = module->GetProcAddress(g_BenchNamePtrs[i]);
+		}
+		auto mid = std::chrono::steady_clock::now();
+		result &= module->BindProcTable(&benchTable) == 0;
+		auto end = std::chrono::steady_clock::now();
+		lookupTime += std::chrono::duration_cast<std::chrono::nanoseconds>(mid - start).count();
+		bindTime += std::chrono::duration_cast<std::chrono::nanoseconds>(end - mid).count();
+	}
+	result &= memcmp(slots, reference, sizeof(slots)) == 0;
+	mgr.UnloadModule(module);
+
+	printf("Proc binding: GetProcAddress %lld ns, bound table %lld ns (average of %d rounds, %d procs).\n",
+		lookupTime / TEST_BENCH_ROUNDS, bindTime / TEST_BENCH_ROUNDS, TEST_BENCH_ROUNDS, TEST_VTABLE_FUNCTIONS);
+	TestReport("Proc binding", result);
+	return result;
+}
+
+/**
+ * Checks that the imports of a dependent are either bound to the library through their slots or pending, and returns the number of pending imports.
+ */
+static u32 TestCheckReloadDependent(rpm::Module* dependent, rpm::Module* lib, bool* result) {
+	rpm::Module::SymbolSection* symSect = dependent->GetSymbols();
+	u32* importSlots = reinterpret_cast<u32*>(dependent->GetCode());
+	size_t libStart = reinterpret_cast<size_t>(lib);
+	size_t libEnd = libStart + lib->GetModuleSize();
+	u32 pending = 0;
+	for (u32 i = 0; i < symSect->ImportSymbolCount; i++) {
+		rpm::Symbol* sym = &symSect->Symbols[symSect->FirstImportSymbolIdx + i];
+		if (sym->Attr & rpm::RPM_SYMATTR_IMPORT) {
+			pending++;
+			*result &= symSect->ImportAddressTable[i] == 0 && sym->Addr.ImportHash == symSect->ImportSymbolHashTable[i];
+		}
+		else {
+			u32 addr = symSect->ImportAddressTable[i];
+			*result &= addr >= libStart && addr < libEnd && importSlots[i] == addr && sym->Addr.RawAddress == addr;
+			*result &= lib->FindExportSymbol(dependent->GetString(sym->Name)) != nullptr;
+		}
+	}
+	return pending;
+}
+
+/**
+ * Hot-reloads a library with dependents, first to an image with fewer exports and back, then compares the reload with unloading and loading again.
+ */
+bool TestHotReload() {
+	for (u32 i = 0; i < NELEMS(g_BenchNamePtrs); i++) {
+		snprintf(g_BenchNames[i], sizeof(g_BenchNames[i]), i < TEST_RELOAD_EXPORTS ? "HotSym%d" : "ColdSym%d", i);
+		g_BenchNamePtrs[i] = g_BenchNames[i];
+	}
+	TestEnvironment env("RPMTestsReload", TEST_BENCH_HEAPSIZE);
+	rpm::mgr::ModuleManager& mgr = env.Mgr;
+
+	//Modules that neither import from nor export to the library, which a full unload and load still has to link with
+	rpm::Module* unrelated[TEST_RELOAD_UNRELATED];
+	for (u32 i = 0; i < TEST_RELOAD_UNRELATED; i++) {
+		TestModuleDesc desc = { 4 * sizeof(u32), 0, &g_BenchNamePtrs[TEST_RELOAD_EXPORTS + i * 4], 4, nullptr, 0, 0 };
+		unrelated[i] = env.Load(&desc);
+		mgr.StartModule(unrelated[i], rpm::FixLevel::NONE);
+	}
+	TestModuleDesc fullDesc = { TEST_RELOAD_EXPORTS * sizeof(u32), 0, g_BenchNamePtrs, TEST_RELOAD_EXPORTS, nullptr, 0, 0 };
+	//A larger image with only part of the exports
+	TestModuleDesc keptDesc = { 2 * TEST_RELOAD_EXPORTS * sizeof(u32), 0x40, g_BenchNamePtrs, TEST_RELOAD_KEPT_EXPORTS, nullptr, 0, 0 };
+	rpm::Module* lib = env.Load(&fullDesc);
+	mgr.StartModule(lib, rpm::FixLevel::NONE);
+	mgr.SetModuleName(lib, "HotLib");
+
+	TestModuleDesc dependentDesc = { TEST_RELOAD_EXPORTS * sizeof(u32), 0, nullptr, 0, g_BenchNamePtrs, TEST_RELOAD_EXPORTS, 0 };
+	rpm::Module* dependents[TEST_RELOAD_DEPENDENTS];
+	for (u32 i = 0; i < TEST_RELOAD_DEPENDENTS; i++) {
+		dependents[i] = env.Load(&dependentDesc);
+		mgr.StartModule(dependents[i], rpm::FixLevel::INTERNAL_RELOCATIONS);
+	}
+
+	bool result = true;
+	rpm::Module* old = lib;
+	lib = mgr.ReloadModule(old, env.Build(&keptDesc), rpm::FixLevel::NONE);
+	result &= lib && lib != old && mgr.FindModule("HotLib") == lib;
+	for (u32 i = 0; i < TEST_RELOAD_DEPENDENTS && lib; i++) {
+		result &= TestCheckReloadDependent(dependents[i], lib, &result) == TEST_RELOAD_EXPORTS - TEST_RELOAD_KEPT_EXPORTS;
+	}
+	//The pending imports are bound again by the full image
+	lib = mgr.ReloadModule(lib, env.Build(&fullDesc), rpm::FixLevel::NONE);
+	result &= lib && mgr.FindModule("HotLib") == lib;
+	for (u32 i = 0; i < TEST_RELOAD_DEPENDENTS && lib; i++) {
+		result &= TestCheckReloadDependent(dependents[i], lib, &result) == 0;
+	}
+
+	long long reloadTime = 0;
+	long long unloadLoadTime = 0;
+	for (u32 round = 0; round < TEST_BENCH_ROUNDS && lib; round++) {
+		void* data = env.Build(&fullDesc);
+		auto start = std::chrono::steady_clock::now();
+		lib = mgr.ReloadModule(lib, data, rpm::FixLevel::NONE);
+		auto end = std::chrono::steady_clock::now();
+		reloadTime += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+		data = env.Build(&fullDesc);
+		start = std::chrono::steady_clock::now();
+		mgr.UnloadModule(lib);
+		lib = mgr.LoadModule(data);
+		mgr.StartModule(lib, rpm::FixLevel::NONE);
+		end = std::chrono::steady_clock::now();
+		unloadLoadTime += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+	}
+	for (u32 i = 0; i < TEST_RELOAD_DEPENDENTS && lib; i++) {
+		result &= TestCheckReloadDependent(dependents[i], lib, &result) == 0;
+	}
+
+	//A dependent without import relocations keeps the library from being reloaded
+	TestModuleDesc fixedDesc = { 4 * sizeof(u32), 0, nullptr, 0, g_BenchNamePtrs, 4, 0 };
+	rpm::Module* fixed = env.Load(&fixedDesc);
+	mgr.StartModule(fixed, rpm::FixLevel::NONE);
+	mgr.FixModuleSections(fixed, rpm::RPM_FIXMASK_IMPORT_RELOCATIONS);
+	result &= mgr.ReloadModule(lib, env.Build(&fullDesc), rpm::FixLevel::NONE) == nullptr;
+	result &= fixed->ImportsFrom(lib);
+	mgr.UnloadModule(fixed);
+
+	for (u32 i = 0; i < TEST_RELOAD_DEPENDENTS; i++) {
+		mgr.UnloadModule(dependents[i]);
+	}
+	if (lib) {
+		mgr.UnloadModule(lib);
+	}
+	for (u32 i = 0; i < TEST_RELOAD_UNRELATED; i++) {
+		mgr.UnloadModule(unrelated[i]);
+	}
+	rpm::mgr::ManagerMemoryStats mgrStats;
+	mgr.GetMemoryStats(&mgrStats);
+	result &= mgrStats.ModuleCount == 0 && mgrStats.InUse == 0;
+
+	printf("Hot reload: reload %lld ns, unload and load %lld ns (average of %d rounds, %d dependents importing %d symbols, %d other modules).\n",
+		reloadTime / TEST_BENCH_ROUNDS, unloadLoadTime / TEST_BENCH_ROUNDS, TEST_BENCH_ROUNDS, TEST_RELOAD_DEPENDENTS, TEST_RELOAD_EXPORTS,
+		TEST_RELOAD_UNRELATED);
+	TestReport("Hot reload", result);
+	return result;
+}
+
+/**
+ * Resolves an address by walking the modules and their symbol tables, as done without an AddressIndex.
+ */
+static rpm::Symbol* TestLinearAddressLookup(rpm::Module** modules, u32 moduleCount, const u8* address, rpm::Module** pModule) {
+	for (u32 m = 0; m < moduleCount; m++) {
+		rpm::Module* module = modules[m];
+		u8* code = module->GetCode();
+		if (address < code || address >= code + module->GetCodeSize()) {
+			continue;
+		}
+		*pModule = module;
+		rpm::Module::SymbolSection* symSect = module->GetSymbols();
+		for (u32 i = 0; symSect && i < symSect->SymbolCount; i++) {
+			rpm::Symbol* sym = &symSect->Symbols[i];
+			if (!(sym->Attr & rpm::RPM_SYMATTR_IMPORT) && address >= code + sym->Addr.RawAddress && address < code + sym->Addr.RawAddress + sym->Size) {
+				return sym;
+			}
+		}
+		return nullptr;
+	}
+	*pModule = nullptr;
+	return nullptr;
+}
+
+/**
+ * Resolves addresses within the functions of many modules through an AddressIndex and by walking the symbol tables,
+ * then fixes the modules and checks what the index can still resolve.
+ */
+bool TestAddressIndex() {
+	for (u32 i = 0; i < TEST_ADDRINDEX_FUNCTIONS; i++) {
+		snprintf(g_BenchNames[i], sizeof(g_BenchNames[i]), "AddrFunc%d", i);
+		g_BenchNamePtrs[i] = g_BenchNames[i];
+	}
+	TestEnvironment env("RPMTestsAddrIndex", TEST_BENCH_HEAPSIZE);
+	rpm::mgr::ModuleManager& mgr = env.Mgr;
+
+	//One index follows all loads, the other indexes the modules that are already loaded when it is created
+	rpm::mgr::AddressIndex retained(&mgr, true);
+	rpm::mgr::AddressIndex* plain = nullptr;
+	rpm::Module* modules[TEST_ADDRINDEX_MODULES];
+	for (u32 i = 0; i < TEST_ADDRINDEX_MODULES; i++) {
+		//The modules are never linked, so they can all export the same names
+		TestModuleDesc desc = { TEST_ADDRINDEX_FUNCTIONS * sizeof(u32), 0, g_BenchNamePtrs, TEST_ADDRINDEX_FUNCTIONS, nullptr, 0, 0 };
+		modules[i] = env.Load(&desc);
+		mgr.StartModule(modules[i], rpm::FixLevel::NONE);
+		if (i == TEST_ADDRINDEX_MODULES / 2) {
+			plain = new(malloc(sizeof(rpm::mgr::AddressIndex))) rpm::mgr::AddressIndex(&mgr, false);
+		}
+	}
+	bool result = retained.GetModuleCount() == TEST_ADDRINDEX_MODULES && plain->GetModuleCount() == TEST_ADDRINDEX_MODULES;
+
+	//Random addresses within the functions, resolved once per round by each method
+	static u8* addresses[TEST_ADDRINDEX_LOOKUPS];
+	static u16 moduleIndices[TEST_ADDRINDEX_LOOKUPS];
+	static u16 names[TEST_ADDRINDEX_LOOKUPS];
+	static rpm::Symbol* linearSymbols[TEST_ADDRINDEX_LOOKUPS];
+	static rpm::mgr::AddressInfo infos[TEST_ADDRINDEX_LOOKUPS];
+	u32 seed = 1;
+	for (u32 i = 0; i < TEST_ADDRINDEX_LOOKUPS; i++) {
+		seed = seed * 1103515245 + 12345;
+		moduleIndices[i] = (seed >> 8) % TEST_ADDRINDEX_MODULES;
+		names[i] = (seed >> 20) % TEST_ADDRINDEX_FUNCTIONS;
+		addresses[i] = static_cast<u8*>(modules[moduleIndices[i]]->GetProcAddress(g_BenchNamePtrs[names[i]])) + 2;
+	}
+	long long linearTime = 0;
+	long long indexTime = 0;
+	for (u32 round = 0; round < TEST_BENCH_ROUNDS; round++) {
+		rpm::Module* module;
+		auto start = std::chrono::steady_clock::now();
+		for (u32 i = 0; i < TEST_ADDRINDEX_LOOKUPS; i++) {
+			linearSymbols[i] = TestLinearAddressLookup(modules, TEST_ADDRINDEX_MODULES, addresses[i], &module);
+		}
+		auto mid = std::chrono::steady_clock::now();
+		for (u32 i = 0; i < TEST_ADDRINDEX_LOOKUPS; i++) {
+			retained.Lookup(addresses[i], &infos[i]);
+		}
+		auto end = std::chrono::steady_clock::now();
+		linearTime += std::chrono::duration_cast<std::chrono::nanoseconds>(mid - start).count();
+		indexTime += std::chrono::duration_cast<std::chrono::nanoseconds>(end - mid).count();
+	}
+	for (u32 i = 0; i < TEST_ADDRINDEX_LOOKUPS; i++) {
+		rpm::Module* module = modules[moduleIndices[i]];
+		rpm::mgr::AddressInfo* info = &infos[i];
+		result &= linearSymbols[i] && linearSymbols[i] == info->Symbol;
+		result &= info->Module == module && info->Function == addresses[i] - 2 && info->FunctionOffset == 2;
+		result &= info->Name && !strcmp(info->Name, g_BenchNamePtrs[names[i]]) && info->NameHash == rpm::Util::HashName(g_BenchNamePtrs[names[i]]);
+	}
+	rpm::mgr::AddressInfo info;
+	result &= !retained.Lookup(&info, &info);
+
+	//Exports-only fixing drops the strings, fixing everything drops the symbols
+	rpm::Module* exportsOnly = modules[0];
+	rpm::Module* stripped = modules[1];
+	u8* exportsOnlyFunc = static_cast<u8*>(exportsOnly->GetProcAddress(g_BenchNamePtrs[3]));
+	u8* strippedFunc = static_cast<u8*>(stripped->GetProcAddress(g_BenchNamePtrs[5]));
+	mgr.FixModule(exportsOnly, rpm::FixLevel::EXPORTS_ONLY);
+	mgr.FixModule(stripped, rpm::FixLevel::ALL_NONCODE);
+	result &= retained.Lookup(exportsOnlyFunc, &info) && info.Function == exportsOnlyFunc && info.Symbol && !info.Name;
+	result &= info.Symbol && exportsOnly->GetSymbolAddressAbsolute(info.Symbol) == exportsOnlyFunc;
+	result &= retained.Lookup(strippedFunc + 1, &info) && info.Module == stripped && info.Function == strippedFunc && info.FunctionOffset == 1;
+	result &= !info.Symbol && info.NameHash == rpm::Util::HashName(g_BenchNamePtrs[5]);
+	result &= plain->Lookup(strippedFunc + 1, &info) && info.Module == stripped && !info.Function && info.CodeOffset == strippedFunc + 1 - stripped->GetCode();
+
+	for (u32 i = 0; i < TEST_ADDRINDEX_MODULES; i++) {
+		mgr.UnloadModule(modules[i]);
+	}
+	result &= retained.GetModuleCount() == 0 && plain->GetModuleCount() == 0;
+	rpm::mgr::ManagerMemoryStats mgrStats;
+	mgr.GetMemoryStats(&mgrStats);
+	result &= mgrStats.InUse == 0;
+
+	printf("Address index: symbol walk %lld ns, index %lld ns (average of %d rounds, %d lookups in %d modules of %d functions).\n",
+		linearTime / TEST_BENCH_ROUNDS, indexTime / TEST_BENCH_ROUNDS, TEST_BENCH_ROUNDS, TEST_ADDRINDEX_LOOKUPS,
+		TEST_ADDRINDEX_MODULES, TEST_ADDRINDEX_FUNCTIONS);
+	TestReport("Address index", result);
+	free(plain);
+	return result;
+}
+
+#ifdef __linux__
+
+/**
+ * Checks the pointer table and the rest of the code of a module loaded by TestModuleSources against the file.
+ */
+static bool TestCheckSourceModule(rpm::Module* module, const TestModuleDesc* desc, const u8* fileCode) {
+	if (!module) {
+		return false;
+	}
+	u32* slots = reinterpret_cast<u32*>(module->GetCode());
+	rpm::Module::SymbolSection* symbols = module->GetSymbols();
+	for (u32 i = 0; i < desc->PointerTableSize; i++) {
+		if (slots[i] != static_cast<u32>(reinterpret_cast<size_t>(module->GetProcAddress(module->GetString(symbols->Symbols[i % desc->ExportCount].Name))))) {
+			return false;
+		}
+	}
+	size_t tableSize = desc->PointerTableSize * sizeof(u32);
+	return memcmp(module->GetCode() + tableSize, fileCode + tableSize, desc->CodeSize - tableSize) == 0;
+}
+
+/**
+ * Loads a module with a large code segment from a file with ReadFile, a FileReadSource and a FileMapSource, and compares the load times.
+ */
+bool TestModuleSources() {
+	const char* exports[] = { "SourceExportA", "SourceExportB", "SourceExportC", "SourceExportD" };
+	TestModuleDesc desc = { TEST_SOURCE_CODESIZE, 0x1000, exports, NELEMS(exports), nullptr, 0, 256 };
+	char path[] = "/tmp/rpmsourceXXXXXX";
+	void* heapMem = AllocTestHeapMemory(TEST_SOURCE_HEAPSIZE);
+	bool result = true;
+	long long readFileTime = 0;
+	long long readSourceTime = 0;
+	long long mapSourceTime = 0;
+
+	u8* fileCode = static_cast<u8*>(malloc(desc.CodeSize));
+	int fd = mkstemp(path);
+	{
+		exl::heap::HeapArea heap("RPMTestsSourceFile", heapMem, TEST_SOURCE_HEAPSIZE);
+		size_t fileSize;
+		void* file = BuildTestModule(&heap, &desc, &fileSize);
+		memcpy(fileCode, static_cast<u8*>(file) + TestAlign(sizeof(TestModuleHeader)), desc.CodeSize);
+		result &= fd >= 0 && write(fd, file, fileSize) == (ssize_t)fileSize;
+		heap.Free(file);
+	}
+	if (fd >= 0) {
+		close(fd);
+	}
+
+	for (u32 round = 0; round < TEST_BENCH_ROUNDS && result; round++) {
+		exl::heap::HeapArea heap("RPMTestsSource", heapMem, TEST_SOURCE_HEAPSIZE);
+		rpm::mgr::ModuleManager mgr(&heap);
+
+		auto start = std::chrono::steady_clock::now();
+		rpm::Module* module = mgr.LoadModule(ReadFile(path, &heap));
+		if (module) {
+			mgr.StartModule(module, rpm::FixLevel::NONE);
+		}
+		auto end = std::chrono::steady_clock::now();
+		readFileTime += std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+		result &= TestCheckSourceModule(module, &desc, fileCode);
+		if (module) {
+			mgr.UnloadModule(module);
+		}
+
+		start = std::chrono::steady_clock::now();
+		rpm::mgr::FileReadSource readSource;
+		module = readSource.Open(path) ? mgr.LoadModule(&readSource, rpm::init::RPM_LOADFLAG_NONE) : nullptr;
+		if (module) {
+			mgr.StartModule(module, rpm::FixLevel::NONE);
+		}
+		end = std::chrono::steady_clock::now();
+		readSourceTime += std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+		result &= TestCheckSourceModule(module, &desc, fileCode) && !module->IsExternalImage();
+		if (module) {
+			mgr.UnloadModule(module);
+		}
+
+		start = std::chrono::steady_clock::now();
+		rpm::mgr::FileMapSource mapSource;
+		module = mapSource.Open(path) ? mgr.LoadModule(&mapSource, rpm::init::RPM_LOADFLAG_NONE) : nullptr;
+		if (module) {
+			mgr.StartModule(module, rpm::FixLevel::NONE);
+		}
+		end = std::chrono::steady_clock::now();
+		mapSourceTime += std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+		result &= TestCheckSourceModule(module, &desc, fileCode) && module->IsExternalImage();
+		if (module) {
+			mgr.UnloadModule(module);
+		}
+		mapSource.UnmapImage();
+
+		rpm::mgr::ManagerMemoryStats stats;
+		mgr.GetMemoryStats(&stats);
+		result &= stats.InUse == 0;
+	}
+	unlink(path);
+
+	printf("Module sources: ReadFile %lld us, pread %lld us, mmap %lld us (average of %d loads, %d KB of code).\n",
+		readFileTime / TEST_BENCH_ROUNDS, readSourceTime / TEST_BENCH_ROUNDS, mapSourceTime / TEST_BENCH_ROUNDS,
+		TEST_BENCH_ROUNDS, desc.CodeSize / 1024);
+	TestReport("Module sources", result);
+
+	free(fileCode);
+	FreeTestHeapMemory(heapMem, TEST_SOURCE_HEAPSIZE);
+	return result;
+}
+
+#endif
+
+/**
+ * Tests that run on synthetic modules built by BuildTestModule.
+ *
+ * @return True if all tests passed.
+ */
+bool RunSyntheticTests() {
+	bool result = true;
+	const char* exports[] = { "TestExportA", "TestExportB", "TestExportC", "TestExportD" };
+	TestModuleDesc desc = { 0x100, 0x40, exports, NELEMS(exports), nullptr, 0, 32 };
+
+	printf("Testing incremental loading of a synthetic module...\n");
+	result &= TestIncrementalLoad(BuildTestModuleFromDesc, &desc);
+
+	printf("Testing deferred start...\n");
+	result &= TestDeferredStart();
+
+	printf("Testing snapshot restore...\n");
+	result &= TestSnapshotRestore();
+
+	printf("Testing module instances...\n");
+	result &= TestModuleInstances();
+
+	printf("Testing fix masks...\n");
+	result &= TestFixMask();
+
+	printf("Testing exports-only fixing...\n");
+	result &= TestExportsOnlyFix();
+
+	printf("Testing ordinal imports...\n");
+	result &= TestOrdinalImports();
+
+	printf("Testing relinking...\n");
+	result &= TestRelinking();
+
+	printf("Testing module names...\n");
+	result &= TestModuleNames();
+
+	printf("Testing relative control sections...\n");
+	result &= TestRelativeControl();
+
+	printf("Testing overlays...\n");
+	result &= TestOverlays();
+
+	printf("Testing memory statistics...\n");
+	result &= TestMemoryStats();
+
+	printf("Testing work memory arenas...\n");
+	result &= TestWorkArena();
+
+	#ifdef RPM_TRACE
+	printf("Testing loader trace...\n");
+	result &= TestTrace();
+	#endif
+
+	printf("Benchmarking import cache...\n");
+	result &= TestImportCacheBenchmark();
+
+	printf("Benchmarking import columns...\n");
+	result &= TestImportColumnBenchmark();
+
+	printf("Benchmarking vtable relocation...\n");
+	result &= TestRelocationBenchmark();
+
+	printf("Benchmarking proc binding...\n");
+	result &= TestProcBinding();
+
+	printf("Benchmarking hot reload...\n");
+	result &= TestHotReload();
+
+	printf("Benchmarking address index...\n");
+	result &= TestAddressIndex();
+
+	#ifdef __linux__
+	printf("Benchmarking module sources...\n");
+	result &= TestModuleSources();
+	#endif
+
+	#ifdef TEST_CONCURRENT
+	printf("Running concurrent stress test...\n");
+	result &= TestConcurrentStress();
+
+	printf("Testing pipelined loading...\n");
+	result &= TestPipelineLoad();
+	#endif
+
+	return result;
+}
+
+/**
+ * Tests on the module files of a local project, skipped if they are not present.
+ */
+void RunFileTests() {
 	void* memMgrHeap = malloc(MEMORY_MGR_HEAPSIZE);
 
 	exl::heap::HeapArea* memMgr = new(malloc(sizeof(exl::heap::HeapArea))) exl::heap::HeapArea("RPMTests", memMgrHeap, MEMORY_MGR_HEAPSIZE);
 	rpm::mgr::ModuleManager* modMgr = new(memMgr) rpm::mgr::ModuleManager(memMgr);
 
-	void* testModule = ReadFile("D:/_REWorkspace/CTRMapProjects/PMC/vfs/data/lib/ExtLib.Media.Cinepak.dll", memMgr);
+	void* testModule = ReadFile(TEST_MODULE_PATH, memMgr);
+
+	if (!testModule) {
+		printf("Test module not found, skipping file tests.\n");
+		free(memMgrHeap);
+		free(memMgr);
+		return;
+	}
 
 	rpm::Module* mod = modMgr->LoadModule(testModule);
 
@@ -84,7 +2317,7 @@ int main(void) {
 		Dump(testModule, mod);
 	}
 
-	void* testDependency = ReadFile("D:/_REWorkspace/CTRMapProjects/PMC/vfs/data/patches/NitroKernel.dll", memMgr);
+	void* testDependency = ReadFile(TEST_DEPENDENCY_PATH, memMgr);
 	rpm::Module* depMod = modMgr->LoadModule(testDependency);
 
 	printf("Starting module 1\n");
@@ -103,4 +2336,17 @@ int main(void) {
 
 	free(memMgrHeap);
 	free(memMgr);
+
+	printf("Testing incremental loading...\n");
+	TestIncrementalLoad(ReadTestModuleFile, TEST_MODULE_PATH);
+}
+
+/**
+ * Runs the file tests and the synthetic tests. Passing "synthetic" runs only the latter, which need no module files.
+ */
+int main(int argc, char** argv) {
+	if (argc < 2 || strcmp(argv[1], "synthetic") != 0) {
+		RunFileTests();
+	}
+	return RunSyntheticTests() ? 0 : 1;
 }
\ No newline at end of file
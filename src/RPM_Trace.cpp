@@ -0,0 +1,84 @@
+#ifndef __RPM_TRACE_CPP
+#define __RPM_TRACE_CPP
+
+#include "RPM_Types.h"
+#include "RPM_Trace.h"
+#include "RPM_Util.h"
+#include "RPM_Version.h"
+
+namespace rpm {
+	namespace mgr {
+		static const char* const TRACE_EVENT_NAMES[] = {
+			"Load",
+			"Link",
+			"Relocate",
+			"Listener",
+			"StaticInitializers",
+			"StaticDestructors",
+			"DllMain",
+			"Fix",
+			"Unload"
+		};
+
+		TraceBuffer::TraceBuffer(void* storage, size_t storageSize, TraceClock clock, u64 tickFrequency) {
+			RPM_ASSERT(storage);
+			RPM_ASSERT(clock);
+			RPM_ASSERT(storageSize >= sizeof(Header) + sizeof(TraceEvent));
+			m_Data = static_cast<Header*>(storage);
+			m_Clock = clock;
+			m_Data->Magic = TRACE_MAGIC;
+			m_Data->Version = LIBRPM_VERSION;
+			m_Data->Capacity = (storageSize - sizeof(Header)) / sizeof(TraceEvent);
+			m_Data->EventSize = sizeof(TraceEvent);
+			m_Data->TickFrequency = tickFrequency;
+			Clear();
+		}
+
+		void TraceBuffer::Clear() {
+			m_Data->Count = 0;
+		}
+
+		void TraceBuffer::Record(TraceEventType type, TracePhase phase, rpm::Module* module, const void* other, u32 arg) {
+			TraceEvent* e = &GetEvents()[m_Data->Count % m_Data->Capacity];
+			e->Timestamp = m_Clock();
+			e->Module = reinterpret_cast<size_t>(module);
+			e->Other = reinterpret_cast<size_t>(other);
+			e->Arg = arg;
+			e->Type = type;
+			e->Phase = phase;
+			e->Reserved = 0;
+			m_Data->Count++;
+		}
+
+		bool TraceBuffer::WriteChromeTrace(const void* raw, size_t rawSize, FILE* out) {
+			const Header* header = static_cast<const Header*>(raw);
+			if (rawSize < sizeof(Header) || header->Magic != TRACE_MAGIC || header->Version != LIBRPM_VERSION || header->EventSize != sizeof(TraceEvent)) {
+				return false;
+			}
+			if (!header->Capacity || header->Capacity > (rawSize - sizeof(Header)) / sizeof(TraceEvent) || !header->TickFrequency) {
+				return false;
+			}
+			const TraceEvent* events = reinterpret_cast<const TraceEvent*>(header + 1);
+			u64 first = header->Count > header->Capacity ? header->Count - header->Capacity : 0;
+			fprintf(out, "{\"traceEvents\":[");
+			for (u64 i = first; i < header->Count; i++) {
+				const TraceEvent* e = &events[i % header->Capacity];
+				const char* name = e->Type < TRACE_EVENT_TYPE_COUNT ? TRACE_EVENT_NAMES[e->Type] : "Unknown";
+				double ts = static_cast<double>(e->Timestamp) * 1000000.0 / static_cast<double>(header->TickFrequency);
+				fprintf(out, "%s\n{\"name\":\"%s\",\"cat\":\"rpm\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":1,\"args\":{\"module\":\"0x%llx\",\"other\":\"0x%llx\",\"arg\":%u}}",
+					i == first ? "" : ",",
+					name,
+					e->Phase == TRACE_BEGIN ? 'B' : 'E',
+					ts,
+					static_cast<unsigned long long>(e->Module),
+					static_cast<unsigned long long>(e->Other),
+					e->Arg
+				);
+			}
+			fprintf(out, "\n]}\n");
+			return true;
+		}
+	}
+}
+
+#endif
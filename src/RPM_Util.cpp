@@ -62,6 +62,120 @@ namespace rpm {
 		}
 	}
 
+	/**
+	 * @brief Resolves the target of an RPM_REL_TGTTYPE_OFFSET relocation like GetSymbolAddressAbsolute, or returns 0 if it should not be written.
+	 */
+	static INLINE u32 ResolveOffsetTarget(Module::SymbolSection* ssec, u32 codeBase, u16 symbNo) {
+		if (symbNo >= ssec->SymbolCount) {
+			RELOC_DEBUG_PRINTF("Failure to resolve relocation symbol no. %d\n", symbNo);
+			return 0;
+		}
+		Symbol* sym = &ssec->Symbols[symbNo];
+		if (sym->Attr & SymbolAttr::RPM_SYMATTR_IMPORT) {
+			return 0;
+		}
+		u32 target = sym->Addr.RawAddress;
+		if (!(sym->Attr & SymbolAttr::RPM_SYMATTR_GLOBAL)) {
+			target += codeBase;
+		}
+		if (sym->Type == RPM_SYMTYPE_FUNCTION_THM) {
+			target++;
+		}
+		return target;
+	}
+
+	u32 Util::DoOffsetRelocationRun(u8* code, Module* m, Relocation* rels, u32 maxCount) {
+		Module::SymbolSection* ssec = m->GetSymbols();
+		u32 startOffset = rels->Target.Offset;
+		if (!ssec || (startOffset & 3) || rels->Target.RelProcType != RPM_REL_TGTTYPE_OFFSET) {
+			return 0;
+		}
+
+		u32 count = 1;
+		while (count < maxCount
+			&& rels[count].Target.RelProcType == RPM_REL_TGTTYPE_OFFSET
+			&& rels[count].Target.Offset == startOffset + count * sizeof(u32)) {
+			count++;
+		}
+
+		u32 codeBase = static_cast<u32>(reinterpret_cast<size_t>(code));
+		u32* dest = reinterpret_cast<u32*>(code + startOffset);
+		u32 i = 0;
+		u32 t0, t1, t2, t3;
+		for (; i + 4 <= count; i += 4) {
+			t0 = ResolveOffsetTarget(ssec, codeBase, rels[i + 0].Source.SymbNo);
+			t1 = ResolveOffsetTarget(ssec, codeBase, rels[i + 1].Source.SymbNo);
+			t2 = ResolveOffsetTarget(ssec, codeBase, rels[i + 2].Source.SymbNo);
+			t3 = ResolveOffsetTarget(ssec, codeBase, rels[i + 3].Source.SymbNo);
+			//Unresolvable words are left untouched, same as DoRelocation
+			if (t0) { dest[i + 0] = t0; }
+			if (t1) { dest[i + 1] = t1; }
+			if (t2) { dest[i + 2] = t2; }
+			if (t3) { dest[i + 3] = t3; }
+		}
+		for (; i < count; i++) {
+			t0 = ResolveOffsetTarget(ssec, codeBase, rels[i].Source.SymbNo);
+			if (t0) {
+				dest[i] = t0;
+			}
+		}
+		return count;
+	}
+
+	void Util::SortRelocationsBySymbol(Relocation* rels, u32 count) {
+		u32 i = 1;
+		while (i < count && rels[i - 1].Source.SymbNo <= rels[i].Source.SymbNo) {
+			i++;
+		}
+		if (i >= count) {
+			return;
+		}
+		//Heap sort, as the tables can be long and no memory is available to sort them into
+		for (u32 start = count >> 1; start-- > 0;) {
+			SiftDownRelocation(rels, start, count);
+		}
+		for (u32 end = count - 1; end > 0; end--) {
+			Relocation top = rels[0];
+			rels[0] = rels[end];
+			rels[end] = top;
+			SiftDownRelocation(rels, 0, end);
+		}
+	}
+
+	void Util::SiftDownRelocation(Relocation* rels, u32 root, u32 count) {
+		while (true) {
+			u32 child = root * 2 + 1;
+			if (child >= count) {
+				return;
+			}
+			if (child + 1 < count && rels[child].Source.SymbNo < rels[child + 1].Source.SymbNo) {
+				child++;
+			}
+			if (rels[root].Source.SymbNo >= rels[child].Source.SymbNo) {
+				return;
+			}
+			Relocation tmp = rels[root];
+			rels[root] = rels[child];
+			rels[child] = tmp;
+			root = child;
+		}
+	}
+
+	u32 Util::LowerBoundRelocationSymbol(u16 symbNo, const Relocation* rels, u32 count) {
+		u32 start = 0;
+		u32 end = count;
+		while (start < end) {
+			u32 mid = start + ((end - start) >> 1);
+			if (rels[mid].Source.SymbNo < symbNo) {
+				start = mid + 1;
+			}
+			else {
+				end = mid;
+			}
+		}
+		return start;
+	}
+
 	RPM_NAMEHASH Util::HashName(const char* name) {
 		if (!name) {
 			return 0;
@@ -79,6 +193,16 @@ namespace rpm {
 		return hash;
 	}
 
+	u32 Util::HashData(const void* data, size_t size, u32 hash) {
+		const u8* bytes = static_cast<const u8*>(data);
+		while (size) {
+			hash = (hash ^ *bytes) * 16777619;
+			bytes++;
+			size--;
+		}
+		return hash;
+	}
+
 	u32 Util::BinarySearchExportTable(RPM_NAMEHASH key, const RPM_NAMEHASH* array, size_t arraySize) {
 		u32 start = 0;
 		u32 end = arraySize;